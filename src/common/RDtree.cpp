@@ -74,6 +74,7 @@ RDtree::RDtree(float(*distFunc)(void *, void *), void(*delFunc)(void *))
    this->delFunc  = delFunc;
    root           = NULL;
    stkMem         = STKMEM_QUANTUM;
+   distanceCount  = 0;
 }
 
 
@@ -85,6 +86,7 @@ RDtree::RDtree(float radius, float(*distFunc)(void *, void *),
    this->delFunc  = delFunc;
    root           = NULL;
    stkMem         = STKMEM_QUANTUM;
+   distanceCount  = 0;
 }
 
 
@@ -164,13 +166,13 @@ void RDtree::insert(RDnode *current, RDnode *node)
    }
 
    /* add pattern to first acceptable branch */
-   dcn = distFunc(current->pattern, node->pattern);
+   dcn = distance(current->pattern, node->pattern);
    while (1)
    {
       for (p = current->childlist; p != NULL; p = p->sibnext)
       {
          /* check relative distances */
-         dnn = distFunc(p->pattern, node->pattern);
+         dnn = distance(p->pattern, node->pattern);
          if (dnn <= (p->distance * RADIUS))
          {
             /* change current fragment */
@@ -205,7 +207,7 @@ void RDtree::insert(RDnode *current, RDnode *node)
     */
    for (p = current->childlist; p != node && p != NULL; )
    {
-      dnn = distFunc(p->pattern, node->pattern);
+      dnn = distance(p->pattern, node->pattern);
 
       /* if should be linked to new pattern */
       if (dnn <= (node->distance * RADIUS))
@@ -276,12 +278,12 @@ void RDtree::remove(void *pattern)
    {
       return;
    }
-   d = distFunc(current->pattern, pattern);
+   d = distance(current->pattern, pattern);
    while (d > 0.0f)
    {
       for (node = current->childlist; node != NULL; node = node->sibnext)
       {
-         d = distFunc(node->pattern, pattern);
+         d = distance(node->pattern, pattern);
          if (d <= (node->distance * RADIUS))
          {
             if (d > 0.0f)
@@ -424,7 +426,7 @@ RDtree::RDsearch *RDtree::search(void *pattern, int maxFind, int maxSearch)
 void RDtree::search(struct SrchCtl *srchCtl, RDtree::RDnode *srchNode)
 {
    int            numSearch, stkIdx;
-   struct SrchStk *stkp, *stkp2;
+   struct SrchStk *stkp;
    RDnode         *p;
    RDsearch       *sw, *sw2, *bsw, *bsw2;
    RDsearch       *swcut;
@@ -444,7 +446,7 @@ void RDtree::search(struct SrchCtl *srchCtl, RDtree::RDnode *srchNode)
    stkp                     = &(srchCtl->srchStk[srchCtl->srchStkIdx]);
    stkp->currsrch           = getSrchWork(srchCtl);
    stkp->currsrch->node     = root;
-   stkp->currsrch->distance = distFunc(stkp->currsrch->node->pattern, srchNode->pattern);
+   stkp->currsrch->distance = distance(stkp->currsrch->node->pattern, srchNode->pattern);
    stkp->currsrch->state    = DISTDONE;
    foundPatt(srchCtl, stkp->currsrch, &numFind, &swcut);
    numSearch++;
@@ -516,7 +518,7 @@ void RDtree::search(struct SrchCtl *srchCtl, RDtree::RDnode *srchNode)
                /* compute distance? */
                if (sw->state == DISTPENDING)
                {
-                  sw->distance = distFunc(sw->node->pattern, srchNode->pattern);
+                  sw->distance = distance(sw->node->pattern, srchNode->pattern);
                   if ((sw->workdist = sw->distance -
                                       (sw->node->distance * RADIUS)) < 0.0f)
                   {
@@ -592,10 +594,8 @@ void RDtree::search(struct SrchCtl *srchCtl, RDtree::RDnode *srchNode)
          else
          {
             /* set new best distance for branch */
-            for (stkp2 = stkp; stkp2 >= srchCtl->srchStk; stkp2--)
-            {
-               stkp2->currsrch->workdist = stkp->child->workdist;
-            }
+            /* (shallower levels set their own as the loop reaches them) */
+            stkp->currsrch->workdist = stkp->child->workdist;
          }
       }
 
@@ -919,6 +919,93 @@ void RDtree::saveChildren(FILE *fp, RDnode *parent,
 }
 
 
+/* export tree nodes in preorder */
+void RDtree::exportNodes(vector<int>& childCounts, vector<void *>& patterns,
+                         vector<void *>& clients, vector<float>& distances)
+{
+   childCounts.clear();
+   patterns.clear();
+   clients.clear();
+   distances.clear();
+   if (root != NULL)
+   {
+      exportNode(root, childCounts, patterns, clients, distances);
+   }
+}
+
+
+/* export node and its descendants */
+void RDtree::exportNode(RDnode *node, vector<int>& childCounts,
+                        vector<void *>& patterns, vector<void *>& clients,
+                        vector<float>& distances)
+{
+   int    i, n;
+   RDnode *p;
+
+   i = (int)childCounts.size();
+   childCounts.push_back(0);
+   patterns.push_back(node->pattern);
+   clients.push_back(node->client);
+   distances.push_back(node->distance);
+   for (p = node->childlist, n = 0; p != NULL; p = p->sibnext, n++)
+   {
+      exportNode(p, childCounts, patterns, clients, distances);
+   }
+   childCounts[i] = n;
+}
+
+
+/* import tree nodes exported in preorder */
+void RDtree::importNodes(vector<int>& childCounts, vector<void *>& patterns,
+                         vector<void *>& clients, vector<float>& distances)
+{
+   int index;
+
+   deleteSubtree(root);
+   root = NULL;
+   if (childCounts.size() > 0)
+   {
+      index = 0;
+      root  = importNode(index, childCounts, patterns, clients, distances);
+   }
+}
+
+
+/* import node and its descendants */
+RDtree::RDnode *RDtree::importNode(int& index, vector<int>& childCounts,
+                                   vector<void *>& patterns, vector<void *>& clients,
+                                   vector<float>& distances)
+{
+   int    i, n;
+   RDnode *node, *p, *p2;
+
+   node           = new RDnode();
+   assert(node != NULL);
+   node->pattern  = patterns[index];
+   node->client   = clients[index];
+   node->distance = distances[index];
+   n = childCounts[index];
+   index++;
+   p2 = NULL;
+   for (i = 0; i < n; i++)
+   {
+      p = importNode(index, childCounts, patterns, clients, distances);
+      if (i == 0)
+      {
+         node->childlist = p;
+      }
+      node->childlast = p;
+      if (p2 != NULL)
+      {
+         p2->sibnext = p;
+         p->sibback  = p2;
+      }
+      p2 = p;
+   }
+   return(node);
+}
+
+
 // Print tree.
 bool RDtree::print(char *filename, void (*printPatt)(void *pattern, FILE *fp))
 {
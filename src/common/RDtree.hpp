@@ -138,10 +138,20 @@ public:
    void save(FILE * fp, void (*savePatt)(void *pattern, FILE *fp),
              void (*saveClient)(void *client, FILE *fp) = NULL);
 
+   // Export and import tree as arrays of nodes in preorder:
+   // child counts, patterns, clients and distances.
+   void exportNodes(vector<int>& childCounts, vector<void *>& patterns,
+                    vector<void *>& clients, vector<float>& distances);
+   void importNodes(vector<int>& childCounts, vector<void *>& patterns,
+                    vector<void *>& clients, vector<float>& distances);
+
    // Print.
    bool print(char *filename, void (*printPatt)(void *pattern, FILE *fp));
    void print(void (*printPatt)(void *pattern, FILE *fp), FILE * fp = stdout);
 
+   // Number of pattern distance evaluations.
+   unsigned long long distanceCount;
+
 private:
 
    // Tree root.
@@ -149,6 +159,11 @@ private:
 
    // Pattern distance function.
    float (*distFunc)(void *pattern0, void *pattern1);
+   inline float distance(void *pattern0, void *pattern1)
+   {
+      distanceCount++;
+      return(distFunc(pattern0, pattern1));
+   }
 
    // Pattern delete function.
    void (*delFunc)(void *pattern);
@@ -210,6 +225,12 @@ private:
    void saveChildren(FILE * fp, RDnode * parent,
                      void (*savePatt)(void *pattern, FILE *fp),
                      void (*saveClient)(void *client, FILE *fp));
+   void exportNode(RDnode * node, vector<int>& childCounts,
+                   vector<void *>& patterns, vector<void *>& clients,
+                   vector<float>& distances);
+   RDnode *importNode(int& index, vector<int>& childCounts,
+                      vector<void *>& patterns, vector<void *>& clients,
+                      vector<float>& distances);
    void printNode(FILE * fp, RDnode * node, int level,
                   void (*printPatt)(void *pattern, FILE *fp));
 };
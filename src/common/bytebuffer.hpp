@@ -0,0 +1,178 @@
+// Byte buffer.
+// Accumulates binary data in memory for bulk writing, and parses
+// binary data read in bulk, in place of per-value file I/O.
+// Data can also be parsed in place from memory it does not own,
+// such as a received frame.
+// Values are stored in native byte order.
+
+#ifndef __BYTEBUFFER__
+#define __BYTEBUFFER__
+
+#include "common.h"
+
+class ByteBuffer
+{
+public:
+
+   vector<unsigned char> bytes;
+   size_t                position;
+   bool                  failed;
+
+   // Constructor.
+   ByteBuffer()
+   {
+      position = 0;
+      failed   = false;
+      view     = NULL;
+      viewSize = 0;
+   }
+
+
+   // Clear.
+   void clear()
+   {
+      bytes.clear();
+      position = 0;
+      failed   = false;
+      view     = NULL;
+      viewSize = 0;
+   }
+
+
+   // Parse data in place without copying.
+   // The data must outlive its use by the buffer.
+   void wrap(const void *data, size_t size)
+   {
+      clear();
+      view     = (const unsigned char *)data;
+      viewSize = size;
+   }
+
+
+   // Size in bytes.
+   size_t size() { return(view != NULL ? viewSize : bytes.size()); }
+
+   // Append data.
+   void put(const void *data, size_t size)
+   {
+      assert(view == NULL);
+      if (size > 0)
+      {
+         size_t n = bytes.size();
+         bytes.resize(n + size);
+         memcpy(&bytes[n], data, size);
+      }
+   }
+
+
+   // Append value.
+   template<class T> void put(T value)
+   {
+      put(&value, sizeof(T));
+   }
+
+
+   // Extract data, failing past the end.
+   bool get(void *data, size_t size)
+   {
+      if (failed || (size > this->size() - position))
+      {
+         failed = true;
+         memset(data, 0, size);
+         return(false);
+      }
+      if (size > 0)
+      {
+         memcpy(data, (view != NULL ? view : &bytes[0]) + position, size);
+         position += size;
+      }
+      return(true);
+   }
+
+
+   // Extract value.
+   template<class T> T get()
+   {
+      T value;
+
+      get(&value, sizeof(T));
+      return(value);
+   }
+
+
+   // Extract into value.
+   template<class T> bool get(T& value)
+   {
+      return(get(&value, sizeof(T)));
+   }
+
+
+   // Extract count, failing if it exceeds the remaining data
+   // at the given minimum size per item.
+   int getCount(size_t itemSize = 1)
+   {
+      int count = get<int>();
+
+      if ((count < 0) ||
+          ((size_t)count * itemSize > size() - position))
+      {
+         failed = true;
+         return(0);
+      }
+      return(count);
+   }
+
+
+   // Write to file as one block: size then data.
+   bool write(FILE *fp)
+   {
+      unsigned long long n = (unsigned long long)bytes.size();
+
+      if (fwrite(&n, sizeof(n), 1, fp) != 1)
+      {
+         return(false);
+      }
+      if ((n > 0) && (fwrite(&bytes[0], 1, (size_t)n, fp) != (size_t)n))
+      {
+         return(false);
+      }
+      return(true);
+   }
+
+
+   // Read block written by write.
+   // Storage grows as data arrives so a corrupt size fails at end of file.
+   bool read(FILE *fp)
+   {
+      unsigned long long n;
+      size_t             m, k;
+
+      clear();
+      if (fread(&n, sizeof(n), 1, fp) != 1)
+      {
+         return(false);
+      }
+      while ((unsigned long long)bytes.size() < n)
+      {
+         m = bytes.size();
+         k = (size_t)(n - m < (unsigned long long)CHUNK_SIZE ? n - m :
+                      (unsigned long long)CHUNK_SIZE);
+         bytes.resize(m + k);
+         if (fread(&bytes[m], 1, k, fp) != k)
+         {
+            bytes.clear();
+            return(false);
+         }
+      }
+      return(true);
+   }
+
+
+private:
+
+   enum { CHUNK_SIZE=1 << 20 };
+
+   const unsigned char *view;
+   size_t              viewSize;
+};
+#endif
@@ -0,0 +1,117 @@
+// Event ring.
+// Records fixed-size events in a circular buffer that keeps
+// the most recent events. Writers claim slots with an atomic
+// counter and never block, so events can be recorded from
+// several threads at once. A slot's sequence number is written
+// last; events read while being written may be inconsistent,
+// so read when writers are quiet.
+
+#ifndef __EVENTRING__
+#define __EVENTRING__
+
+#include "common.h"
+#include <atomic>
+#include <chrono>
+
+class EventRing
+{
+public:
+
+   // Event.
+   struct Event
+   {
+      unsigned long long sequence;    // Recording order, from 1.
+      unsigned long long time;        // Nanoseconds.
+      unsigned long long clock;
+      unsigned long long id;
+      double             value;
+      int                type;
+      int                arg;
+   };
+
+   // Constructor.
+   // The size is rounded up to a power of two.
+   EventRing(int size)
+   {
+      int n;
+
+      for (n = 1; n < size; n <<= 1)
+      {
+      }
+      events = new Event[n];
+      assert(events != NULL);
+      mask = n - 1;
+      clear();
+   }
+
+
+   // Destructor.
+   ~EventRing()
+   {
+      delete [] events;
+   }
+
+
+   // Clear.
+   void clear()
+   {
+      for (int i = 0; i <= (int)mask; i++)
+      {
+         events[i].sequence = 0;
+      }
+      next = 0;
+   }
+
+
+   // Capacity.
+   int size() { return((int)mask + 1); }
+
+   // Number of events recorded, including those overwritten.
+   unsigned long long count() { return(next.load()); }
+
+   // Record event.
+   inline void record(int type, int arg, unsigned long long clock,
+                      unsigned long long id, double value)
+   {
+      unsigned long long i = next.fetch_add(1, std::memory_order_relaxed);
+      Event&             e = events[i & mask];
+
+      e.time = (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch()).count();
+      e.clock = clock;
+      e.id    = id;
+      e.value = value;
+      e.type  = type;
+      e.arg   = arg;
+      std::atomic_thread_fence(std::memory_order_release);
+      e.sequence = i + 1;
+   }
+
+
+   // Get retained events, oldest first.
+   void get(vector<Event>& out)
+   {
+      unsigned long long i, n;
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      out.clear();
+      n = next.load();
+      i = (n > mask + 1) ? n - (mask + 1) : 0;
+      for ( ; i < n; i++)
+      {
+         Event& e = events[i & mask];
+         if (e.sequence == i + 1)
+         {
+            out.push_back(e);
+         }
+      }
+   }
+
+
+private:
+
+   Event                           *events;
+   unsigned long long              mask;
+   std::atomic<unsigned long long> next;
+};
+#endif
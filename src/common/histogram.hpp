@@ -0,0 +1,161 @@
+// Histogram.
+// Records non-negative integer values, such as latencies in
+// nanoseconds, in log-linear buckets: values below 64 are exact,
+// and each larger power of two is divided into 32 buckets, giving
+// about 3% precision at any magnitude with a fixed, small table.
+// Values of 2^40 and more are counted in the last bucket.
+
+#ifndef __HISTOGRAM__
+#define __HISTOGRAM__
+
+#include "common.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+class Histogram
+{
+public:
+
+   enum { SUB_BITS=5, SUB_BUCKETS=(1 << SUB_BITS), MAX_BITS=40,
+          NUM_BUCKETS=((MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS) };
+
+   // Constructor.
+   Histogram()
+   {
+      clear();
+   }
+
+
+   // Clear.
+   void clear()
+   {
+      for (int i = 0; i < NUM_BUCKETS; i++)
+      {
+         counts[i] = 0;
+      }
+      count = 0;
+      sum   = 0;
+      max   = 0;
+   }
+
+
+   // Record value.
+   inline void record(unsigned long long value)
+   {
+      counts[bucket(value)]++;
+      count++;
+      sum += value;
+      if (value > max)
+      {
+         max = value;
+      }
+   }
+
+
+   // Number of values.
+   unsigned long long getCount() { return(count); }
+
+   // Sum of values.
+   unsigned long long getSum() { return(sum); }
+
+   // Maximum value.
+   unsigned long long getMax() { return(max); }
+
+   // Mean value.
+   double getMean()
+   {
+      return(count > 0 ? (double)sum / (double)count : 0.0);
+   }
+
+
+   // Value at quantile (0-1): the highest value equivalent
+   // to the value of that rank, bounded by the maximum.
+   unsigned long long getQuantile(double quantile)
+   {
+      int                i;
+      unsigned long long rank, n, value;
+
+      if (count == 0)
+      {
+         return(0);
+      }
+      rank = (unsigned long long)ceil(quantile * (double)count);
+      if (rank < 1)
+      {
+         rank = 1;
+      }
+      for (i = 0, n = 0; i < NUM_BUCKETS - 1; i++)
+      {
+         n += counts[i];
+         if (n >= rank)
+         {
+            break;
+         }
+      }
+      value = bucketLimit(i);
+      return(value < max ? value : max);
+   }
+
+
+   // Add another histogram.
+   void add(Histogram& histogram)
+   {
+      for (int i = 0; i < NUM_BUCKETS; i++)
+      {
+         counts[i] += histogram.counts[i];
+      }
+      count += histogram.count;
+      sum   += histogram.sum;
+      if (histogram.max > max)
+      {
+         max = histogram.max;
+      }
+   }
+
+
+private:
+
+   unsigned long long counts[NUM_BUCKETS];
+   unsigned long long count;
+   unsigned long long sum;
+   unsigned long long max;
+
+   // Bucket index of value.
+   static inline int bucket(unsigned long long value)
+   {
+      int shift;
+
+      if (value < (unsigned long long)(2 * SUB_BUCKETS))
+      {
+         return((int)value);
+      }
+      if (value >> MAX_BITS)
+      {
+         return(NUM_BUCKETS - 1);
+      }
+#ifdef _MSC_VER
+      unsigned long msb;
+      _BitScanReverse64(&msb, value);
+      shift = (int)msb - SUB_BITS;
+#else
+      shift = (63 - __builtin_clzll(value)) - SUB_BITS;
+#endif
+      return((shift * SUB_BUCKETS) + (int)(value >> shift));
+   }
+
+
+   // Highest value in bucket.
+   static unsigned long long bucketLimit(int index)
+   {
+      int shift;
+
+      if (index < 2 * SUB_BUCKETS)
+      {
+         return((unsigned long long)index);
+      }
+      shift = (index / SUB_BUCKETS) - 1;
+      return(((unsigned long long)(index - (shift * SUB_BUCKETS) + 1) << shift) - 1);
+   }
+};
+#endif
@@ -112,6 +112,11 @@ RANDOM Random::genrand_int32(void)
    RANDOM        y;
    static RANDOM mag01[2] = { 0x0UL, RAND_MATRIX_A };
 
+   if (generator == PHILOX)
+   {
+      return(philox_int32());
+   }
+
    /* mag01[x] = x * RAND_MATRIX_A  for x=0,1 */
 
    if (mti >= RAND_N)                             /* generate N words at one time */
@@ -199,36 +204,96 @@ double Random::genrand_res53(void)
 
 /* Load and save added by TEP: */
 
+/* Philox state follows a PHILOX_MTI marker. */
+
 /* load state from file pointer */
 void Random::load_genrand(FILE *fp)
 {
-   for (int i = 0; i < RAND_N; i++)
+   int    i, index;
+   RANDOM key[2], counter[4];
+
+   for (i = 0; i < RAND_N; i++)
    {
       FREAD_LONG(&mt[i], fp);
    }
    FREAD_INT(&mti, fp);
+   if (mti == PHILOX_MTI)
+   {
+      mti = RAND_N + 1;
+      for (i = 0; i < 2; i++)
+      {
+         FREAD_LONG(&key[i], fp);
+      }
+      for (i = 0; i < 4; i++)
+      {
+         FREAD_LONG(&counter[i], fp);
+      }
+      FREAD_INT(&index, fp);
+      RAND_SET_PHILOX(key, counter, index);
+   }
+   else
+   {
+      generator = MERSENNE_TWISTER;
+   }
 }
 
 
 /* save state to file pointer */
 void Random::save_genrand(FILE *fp)
 {
-   for (int i = 0; i < RAND_N; i++)
+   int i, j;
+
+   for (i = 0; i < RAND_N; i++)
    {
       FWRITE_LONG(&mt[i], fp);
    }
-   FWRITE_INT(&mti, fp);
+   if (generator == PHILOX)
+   {
+      j = PHILOX_MTI;
+      FWRITE_INT(&j, fp);
+      for (i = 0; i < 2; i++)
+      {
+         FWRITE_LONG(&philoxKey[i], fp);
+      }
+      for (i = 0; i < 4; i++)
+      {
+         FWRITE_LONG(&philoxCounter[i], fp);
+      }
+      FWRITE_INT(&philoxIndex, fp);
+   }
+   else
+   {
+      FWRITE_INT(&mti, fp);
+   }
 }
 
 
 // Save random state.
 void Random::push_genrand()
 {
+   int    i;
    RANDOM *mtp;
 
+   if (generator == PHILOX)
+   {
+      mtp = new RANDOM[PHILOX_STATE_SIZE];
+      assert(mtp != NULL);
+      for (i = 0; i < 2; i++)
+      {
+         mtp[i] = philoxKey[i];
+      }
+      for (i = 0; i < 4; i++)
+      {
+         mtp[i + 2] = philoxCounter[i];
+      }
+      mtp[6] = (RANDOM)philoxIndex;
+      smt.push(mtp);
+      smti.push(PHILOX_MTI);
+      return;
+   }
    mtp = new RANDOM[RAND_N];
    assert(mtp != NULL);
-   for (int i = 0; i < RAND_N; i++)
+   for (i = 0; i < RAND_N; i++)
    {
       mtp[i] = mt[i];
    }
@@ -245,23 +310,197 @@ void Random::pop_genrand()
    assert(smt.size() > 0);
    mtp = smt.top();
    smt.pop();
-   for (int i = 0; i < RAND_N; i++)
+   if (smti.top() == PHILOX_MTI)
    {
-      mt[i] = mtp[i];
+      RAND_SET_PHILOX(&mtp[0], &mtp[2], (int)mtp[6]);
+   }
+   else
+   {
+      for (int i = 0; i < RAND_N; i++)
+      {
+         mt[i] = mtp[i];
+      }
+      mti       = smti.top();
+      generator = MERSENNE_TWISTER;
    }
-   delete mtp;
-   mti = smti.top();
+   delete [] mtp;
    smti.pop();
 }
 
 
+/*
+ * Philox4x32-10 counter-based generator:
+ * J. Salmon, M. Moraes, R. Dror and D. Shaw,
+ * Parallel Random Numbers: As Easy as 1, 2, 3, SC11, 2011.
+ */
+
+// Initialize Philox key and counter.
+void Random::init_philox(RANDOM seed, RANDOM stream)
+{
+   philoxKey[0]     = seed & 0xffffffffUL;
+   philoxKey[1]     = ((seed >> 16) >> 16) & 0xffffffffUL;
+   philoxCounter[0] = philoxCounter[1] = 0;
+   philoxCounter[2] = stream & 0xffffffffUL;
+   philoxCounter[3] = ((stream >> 16) >> 16) & 0xffffffffUL;
+   for (int i = 0; i < 4; i++)
+   {
+      philoxBlock[i] = 0;
+   }
+   philoxIndex = 4;
+}
+
+
+// Generate Philox block for counter.
+void Random::philox_block(RANDOM counter[4], RANDOM block[4])
+{
+   int                i;
+   unsigned long long p0, p1;
+   RANDOM             k0, k1, c0, c1, c2, c3;
+
+   k0 = philoxKey[0];
+   k1 = philoxKey[1];
+   c0 = counter[0];
+   c1 = counter[1];
+   c2 = counter[2];
+   c3 = counter[3];
+   for (i = 0; i < PHILOX_ROUNDS; i++)
+   {
+      if (i > 0)
+      {
+         k0 = (k0 + PHILOX_W0) & 0xffffffffUL;
+         k1 = (k1 + PHILOX_W1) & 0xffffffffUL;
+      }
+      p0 = (unsigned long long)PHILOX_M0 * (unsigned long long)c0;
+      p1 = (unsigned long long)PHILOX_M1 * (unsigned long long)c2;
+      c0 = ((RANDOM)(p1 >> 32) ^ c1 ^ k0) & 0xffffffffUL;
+      c1 = (RANDOM)(p1 & 0xffffffffULL);
+      c2 = ((RANDOM)(p0 >> 32) ^ c3 ^ k1) & 0xffffffffUL;
+      c3 = (RANDOM)(p0 & 0xffffffffULL);
+   }
+   block[0] = c0;
+   block[1] = c1;
+   block[2] = c2;
+   block[3] = c3;
+}
+
+
+// Generate Philox random number.
+RANDOM Random::philox_int32(void)
+{
+   RANDOM y;
+
+   if (philoxIndex >= 4)
+   {
+      philox_block(philoxCounter, philoxBlock);
+      philoxCounter[0] = (philoxCounter[0] + 1) & 0xffffffffUL;
+      if (philoxCounter[0] == 0)
+      {
+         philoxCounter[1] = (philoxCounter[1] + 1) & 0xffffffffUL;
+      }
+      philoxIndex = 0;
+   }
+   y = philoxBlock[philoxIndex++];
+
+   // Prevent return of INVALID_RANDOM
+   if (y == INVALID_RANDOM)
+   {
+      y = 0x7fffffffUL;
+   }
+   return(y);
+}
+
+
 // Seed random numbers.
 void Random::SRAND(RANDOM seed)
 {
+   generator = MERSENNE_TWISTER;
    init_genrand(seed);
 }
 
 
+// Seed Philox random numbers for a stream.
+void Random::SRAND_PHILOX(RANDOM seed, RANDOM stream)
+{
+   generator = PHILOX;
+   init_philox(seed, stream);
+}
+
+
+// Split off stream into given random object.
+void Random::RAND_SPLIT(RANDOM stream, Random& random)
+{
+   RANDOM key[2], counter[4], block[4];
+
+   if (generator == PHILOX)
+   {
+      // Key from the last block of this stream, which is never output.
+      counter[0] = counter[1] = 0xffffffffUL;
+      counter[2] = philoxCounter[2];
+      counter[3] = philoxCounter[3];
+      philox_block(counter, block);
+      key[0] = block[0];
+      key[1] = block[1];
+   }
+   else
+   {
+      key[0] = genrand_int32();
+      key[1] = genrand_int32();
+   }
+   random.RAND_CLEAR();
+   random.init_philox(0, stream);
+   random.philoxKey[0] = key[0];
+   random.philoxKey[1] = key[1];
+   random.generator    = PHILOX;
+}
+
+
+// Get Philox state.
+void Random::RAND_GET_PHILOX(RANDOM key[2], RANDOM counter[4], int& index)
+{
+   int i;
+
+   for (i = 0; i < 2; i++)
+   {
+      key[i] = philoxKey[i];
+   }
+   for (i = 0; i < 4; i++)
+   {
+      counter[i] = philoxCounter[i];
+   }
+   index = philoxIndex;
+}
+
+
+// Set Philox state.
+void Random::RAND_SET_PHILOX(RANDOM key[2], RANDOM counter[4], int index)
+{
+   int    i;
+   RANDOM c[4];
+
+   for (i = 0; i < 2; i++)
+   {
+      philoxKey[i] = key[i] & 0xffffffffUL;
+   }
+   for (i = 0; i < 4; i++)
+   {
+      philoxCounter[i] = c[i] = counter[i] & 0xffffffffUL;
+   }
+   philoxIndex = ((index >= 0) && (index < 4)) ? index : 4;
+   generator   = PHILOX;
+
+   // Regenerate the current block.
+   if (philoxIndex < 4)
+   {
+      if (c[0] == 0)
+      {
+         c[1] = (c[1] - 1) & 0xffffffffUL;
+      }
+      c[0] = (c[0] - 1) & 0xffffffffUL;
+      philox_block(c, philoxBlock);
+   }
+}
+
+
 // Get random number
 RANDOM Random::RAND()
 {
@@ -356,7 +595,7 @@ void Random::RAND_CLONE(Random& random)
    stack<RANDOM *> smt2;
    stack<int>      smti2;
    RANDOM          *mtp, *mtp2;
-   RANDOM          r;
+   int             r, n;
 
    random.RAND_CLEAR();
    for (int i = 0; i < RAND_N; i++)
@@ -364,6 +603,17 @@ void Random::RAND_CLONE(Random& random)
       random.mt[i] = mt[i];
    }
    random.mti = mti;
+   for (int i = 0; i < 2; i++)
+   {
+      random.philoxKey[i] = philoxKey[i];
+   }
+   for (int i = 0; i < 4; i++)
+   {
+      random.philoxCounter[i] = philoxCounter[i];
+      random.philoxBlock[i]   = philoxBlock[i];
+   }
+   random.philoxIndex = philoxIndex;
+   random.generator   = generator;
 
    while (smt.size() > 0)
    {
@@ -380,14 +630,15 @@ void Random::RAND_CLONE(Random& random)
       mtp = smt2.top();
       smt2.pop();
       smt.push(mtp);
-      mtp2 = new RANDOM[RAND_N];
+      r    = smti2.top();
+      n    = (r == PHILOX_MTI) ? PHILOX_STATE_SIZE : RAND_N;
+      mtp2 = new RANDOM[n];
       assert(mtp2 != NULL);
-      for (int i = 0; i < RAND_N; i++)
+      for (int i = 0; i < n; i++)
       {
          mtp2[i] = mtp[i];
       }
       random.smt.push(mtp2);
-      r = smti2.top();
       smti2.pop();
       smti.push(r);
       random.smti.push(r);
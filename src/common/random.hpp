@@ -22,16 +22,41 @@ typedef double          PROBABILITY;
 /* least significant r bits */
 #define RAND_LOWER_MASK    0x7fffffffUL
 
+// Philox4x32-10 parameters.
+#define PHILOX_ROUNDS      10
+#define PHILOX_M0          0xD2511F53UL
+#define PHILOX_M1          0xCD9E8D57UL
+#define PHILOX_W0          0x9E3779B9UL
+#define PHILOX_W1          0xBB67AE85UL
+#define PHILOX_STATE_SIZE    7
+
 // Random numbers.
+// The generator is Mersenne Twister, or on request Philox4x32-10,
+// a counter-based generator: its output is a function of a 64 bit
+// key and a 128 bit counter of block number and stream, so streams
+// can be split off in constant time, each reproducible on its own.
 class Random
 {
 public:
 
+   // Generators.
+   enum GENERATOR { MERSENNE_TWISTER=0, PHILOX=1 };
+   int generator;
+
    // The array for the state vector.
    // mti==RAND_N+1 means mt[RAND_N] is not initialized.
+   // mti==PHILOX_MTI marks Philox state in saves and on the stack.
+   enum { PHILOX_MTI=(-1) };
    RANDOM mt[RAND_N];
    int    mti;
 
+   // Philox key and counter: block number, then stream,
+   // low words first, and the current block of output.
+   RANDOM philoxKey[2];
+   RANDOM philoxCounter[4];
+   RANDOM philoxBlock[4];
+   int    philoxIndex;
+
    // Save/restore random state on stack.
    stack<RANDOM *> smt;
    stack<int>      smti;
@@ -39,13 +64,17 @@ public:
    // Constructors.
    Random()
    {
-      mti = RAND_N + 1;
+      generator = MERSENNE_TWISTER;
+      mti       = RAND_N + 1;
+      init_philox(0, 0);
    }
 
 
    Random(RANDOM seed)
    {
-      mti = RAND_N + 1;
+      generator = MERSENNE_TWISTER;
+      mti       = RAND_N + 1;
+      init_philox(0, 0);
       SRAND(seed);
    }
 
@@ -60,6 +89,19 @@ public:
    // Seed random numbers.
    void SRAND(RANDOM seed);
 
+   // Seed Philox random numbers for a stream.
+   void SRAND_PHILOX(RANDOM seed, RANDOM stream = 0);
+
+   // Split off stream into given random object.
+   // Splits of the same stream are identical. A Philox generator
+   // derives the key of its splits from its key and stream;
+   // Mersenne Twister draws it.
+   void RAND_SPLIT(RANDOM stream, Random& random);
+
+   // Get/set Philox state: key, counter and output index.
+   void RAND_GET_PHILOX(RANDOM key[2], RANDOM counter[4], int& index);
+   void RAND_SET_PHILOX(RANDOM key[2], RANDOM counter[4], int index);
+
    // Get random number
    RANDOM RAND();
 
@@ -110,6 +152,15 @@ private:
    /* generates a random number on [0,0xffffffff]-interval */
    RANDOM genrand_int32(void);
 
+   // Initialize Philox key and counter.
+   void init_philox(RANDOM seed, RANDOM stream);
+
+   // Generate Philox block for counter.
+   void philox_block(RANDOM counter[4], RANDOM block[4]);
+
+   // Generate Philox random number.
+   RANDOM philox_int32(void);
+
    /* generates a random number on [0,0x7fffffff]-interval */
    long genrand_int31(void);
 
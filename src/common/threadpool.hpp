@@ -0,0 +1,162 @@
+// Thread pool.
+// Runs batches of indexed tasks across a fixed set of threads.
+// The calling thread takes part in each batch as worker 0.
+
+#ifndef __THREADPOOL__
+#define __THREADPOOL__
+
+#include "common.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class ThreadPool
+{
+public:
+
+   // Task: performs task index using worker's private resources.
+   typedef void (*TASK)(void *context, int index, int worker);
+
+   // Constructor.
+   ThreadPool(int numThreads)
+   {
+      assert(numThreads >= 1);
+      this->numThreads = numThreads;
+      task             = NULL;
+      context          = NULL;
+      numTasks         = 0;
+      numWorkers       = 0;
+      nextTask         = 0;
+      active           = 0;
+      batch            = 0;
+      stop             = false;
+      for (int i = 1; i < numThreads; i++)
+      {
+         std::thread *thread = new std::thread(&ThreadPool::work, this, i);
+         assert(thread != NULL);
+         threads.push_back(thread);
+      }
+   }
+
+
+   // Destructor.
+   ~ThreadPool()
+   {
+      {
+         std::lock_guard<std::mutex> lock(poolMutex);
+         stop = true;
+      }
+      wakeup.notify_all();
+      for (int i = 0; i < (int)threads.size(); i++)
+      {
+         threads[i]->join();
+         delete threads[i];
+      }
+      threads.clear();
+   }
+
+
+   // Number of threads, including the caller.
+   int size() { return(numThreads); }
+
+   // Run tasks 0 to numTasks-1 on up to numWorkers threads
+   // (0 = all), returning when all are done. The assignment of
+   // tasks to workers varies from run to run.
+   void run(TASK task, void *context, int numTasks, int numWorkers = 0)
+   {
+      int i;
+
+      if ((numWorkers <= 0) || (numWorkers > numThreads))
+      {
+         numWorkers = numThreads;
+      }
+      if ((numWorkers == 1) || (numTasks <= 1))
+      {
+         for (i = 0; i < numTasks; i++)
+         {
+            task(context, i, 0);
+         }
+         return;
+      }
+      {
+         std::lock_guard<std::mutex> lock(poolMutex);
+         this->task       = task;
+         this->context    = context;
+         this->numTasks   = numTasks;
+         this->numWorkers = numWorkers;
+         nextTask         = 0;
+         active           = numWorkers - 1;
+         batch++;
+      }
+      wakeup.notify_all();
+      perform(0);
+      std::unique_lock<std::mutex> lock(poolMutex);
+      while (active > 0)
+      {
+         done.wait(lock);
+      }
+   }
+
+
+private:
+
+   int                     numThreads;
+   vector<std::thread *>   threads;
+   TASK                    task;
+   void                    *context;
+   int                     numTasks;
+   int                     numWorkers;
+   std::atomic<int>        nextTask;
+   int                     active;
+   unsigned long long      batch;
+   bool                    stop;
+   std::mutex              poolMutex;
+   std::condition_variable wakeup;
+   std::condition_variable done;
+
+   // Perform tasks until none remain.
+   void perform(int worker)
+   {
+      int i;
+
+      while ((i = nextTask.fetch_add(1)) < numTasks)
+      {
+         task(context, i, worker);
+      }
+   }
+
+
+   // Worker thread.
+   void work(int worker)
+   {
+      unsigned long long seen = 0;
+
+      std::unique_lock<std::mutex> lock(poolMutex);
+      while (true)
+      {
+         while (!stop && (batch == seen))
+         {
+            wakeup.wait(lock);
+         }
+         if (stop)
+         {
+            return;
+         }
+         seen = batch;
+         if (worker >= numWorkers)
+         {
+            continue;
+         }
+         lock.unlock();
+         perform(worker);
+         lock.lock();
+         active--;
+         if (active == 0)
+         {
+            done.notify_one();
+         }
+      }
+   }
+};
+#endif
@@ -5,6 +5,7 @@ package mona;
 import java.util.*;
 import java.io.*;
 import java.lang.reflect.*;
+import java.nio.*;
 
 public class Mona
 {
@@ -135,6 +136,39 @@ public class Mona
    }
 
 
+   // Cycle a batch of monas in one native call.
+   // Sensors, needs and response potentials are packed by mona in
+   // reference order, each mona taking its own number of values.
+   // Needs are set before the cycle unless NaN; the response and the
+   // response potentials are written after it. Needs and potentials
+   // may be null. Returns false, cycling none, if a reference is
+   // invalid or a buffer is too small.
+   // Direct buffers are used in place from their start and must be
+   // in native byte order. Arrays are pinned for the batch, which
+   // holds off garbage collection until it returns.
+   public static boolean cycleBatch(int[] references, ByteBuffer sensors,
+                                    ByteBuffer needs, ByteBuffer responses,
+                                    ByteBuffer potentials)
+   {
+      return(cycleBatchDirect(references, sensors, needs, responses, potentials));
+   }
+
+
+   public static boolean cycleBatch(int[] references, float[] sensors,
+                                    double[] needs, int[] responses,
+                                    double[] potentials)
+   {
+      return(cycleBatchArrays(references, sensors, needs, responses, potentials));
+   }
+
+
+   // Get reference for batch cycling.
+   public int getReference()
+   {
+      return(monaReference);
+   }
+
+
    // Add response.
    public int addResponse()
    {
@@ -330,6 +364,14 @@ public class Mona
 
    private native int cycle(int reference, float[] sensors);
 
+   private static native boolean cycleBatchDirect(int[] references, ByteBuffer sensors,
+                                                  ByteBuffer needs, ByteBuffer responses,
+                                                  ByteBuffer potentials);
+
+   private static native boolean cycleBatchArrays(int[] references, float[] sensors,
+                                                  double[] needs, int[] responses,
+                                                  double[] potentials);
+
    private native int addResponse(int reference);
 
    private native double getResponsePotential(int reference, int response);
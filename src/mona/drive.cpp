@@ -7,11 +7,13 @@
 void
 Mona::drive()
 {
-   int      i;
-   Neuron   *neuron;
-   Receptor *receptor;
-   Motor    *motor;
-   Mediator *mediator;
+   int         i, j, count, numWorkers;
+   MOTIVE      idleMotive;
+   Neuron      *neuron;
+   Receptor    *receptor;
+   Motor       *motor;
+   Mediator    *mediator;
+   DriveWorker *worker;
 
    list<Mediator *>::iterator mediatorItr;
    MotiveAccum                motiveAccum;
@@ -40,24 +42,32 @@ Mona::drive()
 #endif
 
    // Initialize drive.
+   driveNeurons.clear();
    for (i = 0; i < (int)receptors.size(); i++)
    {
       neuron = (Neuron *)receptors[i];
-      neuron->initDrive(needs);
+      neuron->initDrive();
+      neuron->driveIndex = (int)driveNeurons.size();
+      driveNeurons.push_back(neuron);
    }
    for (i = 0; i < (int)motors.size(); i++)
    {
       neuron = (Neuron *)motors[i];
-      neuron->initDrive(needs);
+      neuron->initDrive();
+      neuron->driveIndex = (int)driveNeurons.size();
+      driveNeurons.push_back(neuron);
    }
    for (mediatorItr = mediators.begin();
         mediatorItr != mediators.end(); mediatorItr++)
    {
       neuron = (Neuron *)(*mediatorItr);
-      neuron->initDrive(needs);
+      neuron->initDrive();
+      neuron->driveIndex = (int)driveNeurons.size();
+      driveNeurons.push_back(neuron);
    }
 
-   // Drive.
+   // Collect goal sources.
+   driveSources.clear();
    for (i = 0; i < (int)receptors.size(); i++)
    {
       receptor = receptors[i];
@@ -67,13 +77,7 @@ Mona::drive()
          motiveAccum.accumGoals(receptor->goals);
          if (motiveAccum.getValue() != 0.0)
          {
-            motiveAccum.init(needs);
-            clearMotiveWork();
-#ifdef MONA_TRACKING
-            motiveAccum.drivers.clear();
-#endif
-            receptor->drive(motiveAccum);
-            setMotives();
+            driveSources.push_back(receptor);
          }
       }
    }
@@ -87,14 +91,7 @@ Mona::drive()
          motiveAccum.accumGoals(motor->goals);
          if (motiveAccum.getValue() != 0.0)
          {
-            motiveAccum.init(needs);
-            motiveAccum.init(needs);
-            clearMotiveWork();
-#ifdef MONA_TRACKING
-            motiveAccum.drivers.clear();
-#endif
-            motor->drive(motiveAccum);
-            setMotives();
+            driveSources.push_back(motor);
          }
       }
    }
@@ -112,37 +109,190 @@ Mona::drive()
             motiveAccum.accumGoals(mediator->goals);
             if (motiveAccum.getValue() != 0.0)
             {
-               motiveAccum.init(needs);
-               clearMotiveWork();
+               driveSources.push_back(mediator);
+            }
+         }
+      }
+   }
+   driveSourceEdges.resize(driveSources.size());
+   driveSourceDroppedMotive.resize(driveSources.size());
+
+   // Prepare workers.
+   numWorkers = DRIVE_THREADS;
+   if (numWorkers > (int)driveSources.size())
+   {
+      numWorkers = (int)driveSources.size();
+   }
+   if ((numWorkers < 1) || (MAX_DRIVE_EDGES >= 0))
+   {
+      numWorkers = 1;
+   }
+#ifdef MONA_TRACE
+   if (traceDrive)
+   {
+      numWorkers = 1;
+   }
+#endif
 #ifdef MONA_TRACKING
-               motiveAccum.drivers.clear();
+   numWorkers = 1;
 #endif
-               mediator->drive(motiveAccum);
-               setMotives();
+   while ((int)driveWorkers.size() < numWorkers)
+   {
+      worker = new DriveWorker();
+      assert(worker != NULL);
+      driveWorkers.push_back(worker);
+   }
+   for (i = 0; i < numWorkers; i++)
+   {
+      driveWorkers[i]->init(needs, (int)driveNeurons.size());
+   }
+
+   // Drive.
+   if (numWorkers == 1)
+   {
+      for (i = 0; i < (int)driveSources.size(); i++)
+      {
+         driveSource(driveWorkers[0], i);
+      }
+   }
+   else
+   {
+      // Validate cached goal value subsumption before sharing.
+      for (mediatorItr = mediators.begin();
+           mediatorItr != mediators.end(); mediatorItr++)
+      {
+         (*mediatorItr)->goalValueSubsumed();
+      }
+      getThreadPool(numWorkers)->run(driveTask, (void *)this,
+                                     (int)driveSources.size(), numWorkers);
+   }
+
+   // Set motives to the maximum driven by any source.
+   // A neuron not reached by a source has the motive of an
+   // empty accumulator from it.
+   motiveAccum.init(needs);
+   idleMotive = motiveAccum.getValue();
+   needs.clear();
+   for (i = 0; i < (int)driveNeurons.size(); i++)
+   {
+      neuron = driveNeurons[i];
+      count  = 0;
+      for (j = 0; j < numWorkers; j++)
+      {
+         worker = driveWorkers[j];
+         if (worker->motiveCounts[i] > 0)
+         {
+            count += worker->motiveCounts[i];
+            if (!neuron->motiveValid || (neuron->motive < worker->motives[i]))
+            {
+               neuron->motiveValid = true;
+               neuron->motive      = worker->motives[i];
             }
          }
       }
+      if (count < (int)driveSources.size())
+      {
+         if (!neuron->motiveValid || (neuron->motive < idleMotive))
+         {
+            neuron->motiveValid = true;
+            neuron->motive      = idleMotive;
+         }
+      }
    }
-   needs.clear();
+
+   // Total traversal statistics in source order.
+   driveEdges    = 0;
+   droppedMotive = 0.0;
+   for (i = 0; i < (int)driveSources.size(); i++)
+   {
+      driveEdges    += driveSourceEdges[i];
+      droppedMotive += driveSourceDroppedMotive[i];
+   }
+   driveEdgesTraversed += driveEdges;
 
    // Finalize motives.
    finalizeMotives();
 }
 
 
+// Drive motive from a goal source and accumulate the
+// resulting motives in the worker.
+void
+Mona::driveSource(DriveWorker *worker, int sourceIndex)
+{
+   int     i, j;
+   MOTIVE  m, dropped;
+   COUNTER edges;
+
+#ifdef MONA_TRACKING
+   for (i = 0; i < (int)driveNeurons.size(); i++)
+   {
+      driveNeurons[i]->tracker.motiveWorkPaths.clear();
+   }
+   worker->seed.drivers.clear();
+#endif
+   edges   = worker->edges;
+   dropped = worker->droppedMotive;
+   driveMotive(worker, driveSources[sourceIndex]);
+   driveSourceEdges[sourceIndex]         = worker->edges - edges;
+   driveSourceDroppedMotive[sourceIndex] = worker->droppedMotive - dropped;
+
+   // Keep greater motives and reset work.
+   for (i = 0; i < (int)worker->visits.size(); i++)
+   {
+      j = worker->visits[i];
+      m = worker->motiveWork[j].getValue();
+      if ((worker->motiveCounts[j] == 0) || (worker->motives[j] < m))
+      {
+         worker->motives[j] = m;
+      }
+      worker->motiveCounts[j]++;
+      worker->motiveWork[j].reset();
+      worker->motiveWorkValid[j] = false;
+   }
+   worker->visits.clear();
+
+#ifdef MONA_TRACKING
+   for (i = 0; i < (int)driveNeurons.size(); i++)
+   {
+      driveNeurons[i]->accumMotiveTracking();
+   }
+#endif
+}
+
+
+// Drive task for thread pool.
+void
+Mona::driveTask(void *mona, int sourceIndex, int worker)
+{
+   Mona *m = (Mona *)mona;
+
+   m->driveSource(m->driveWorkers[worker], sourceIndex);
+}
+
+
 // Is goal value subsumed by component?
+// The result is cached until the goal values of the mediator
+// or its components change.
 bool
 Mona::Mediator::goalValueSubsumed()
 {
    int    i;
    NEED   goalValue;
-   Neuron *cause      = this->cause;
-   Neuron *response   = this->response;
-   Neuron *effect     = this->effect;
-   bool   *goalBlocks = new bool[mona->numNeeds];
+   Neuron *cause    = this->cause;
+   Neuron *response = this->response;
+   Neuron *effect   = this->effect;
 
-   assert(goalBlocks != NULL);
+   vector<bool>& goalBlocks = mona->goalBlocks;
 
+   if (goalSubsumedValid)
+   {
+      return(goalSubsumed);
+   }
+   if ((int)goalBlocks.size() != mona->numNeeds)
+   {
+      goalBlocks.resize(mona->numNeeds);
+   }
    for (i = 0; i < mona->numNeeds; i++)
    {
       goalBlocks[i] = false;
@@ -193,21 +343,43 @@ Mona::Mediator::goalValueSubsumed()
          effect = NULL;
       }
    }
-   delete [] goalBlocks;
    if (effect != NULL)
    {
-      return(true);
+      goalSubsumed = true;
    }
    else
    {
-      return(false);
+      goalSubsumed = false;
+   }
+   goalSubsumedValid = true;
+   return(goalSubsumed);
+}
+
+
+// Invalidate goal value subsumption of this neuron, if a mediator,
+// and of the mediators it is a component of.
+void
+Mona::Neuron::invalidateGoalSubsumption()
+{
+   if (mona->deferGoalSubsumption)
+   {
+      goalSubsumptionDeferred = true;
+      return;
+   }
+   if (type == MEDIATOR)
+   {
+      ((Mediator *)this)->goalSubsumedValid = false;
+   }
+   for (int i = 0; i < (int)notifyList.size(); i++)
+   {
+      notifyList[i]->mediator->invalidateGoalSubsumption();
    }
 }
 
 
 // Initialize neuron drive.
 void
-Mona::Neuron::initDrive(VALUE_SET& needs)
+Mona::Neuron::initDrive()
 {
    int           i;
    ENABLEMENT    up, down, e, ce, re, ee;
@@ -216,8 +388,6 @@ Mona::Neuron::initDrive(VALUE_SET& needs)
 
    motive      = 0.0;
    motiveValid = false;
-   motiveWork.init(needs);
-   motiveWorkValid = false;
 #ifdef MONA_TRACKING
    tracker.motivePaths.clear();
    tracker.motiveWorkPaths.clear();
@@ -291,94 +461,6 @@ Mona::Neuron::initDrive(VALUE_SET& needs)
 }
 
 
-// Clear motive working accumulators.
-void
-Mona::clearMotiveWork()
-{
-   int    i;
-   Neuron *neuron;
-
-   list<Mediator *>::iterator mediatorItr;
-
-   for (i = 0; i < (int)receptors.size(); i++)
-   {
-      neuron = (Neuron *)receptors[i];
-      neuron->clearMotiveWork();
-   }
-   for (i = 0; i < (int)motors.size(); i++)
-   {
-      neuron = (Neuron *)motors[i];
-      neuron->clearMotiveWork();
-   }
-   for (mediatorItr = mediators.begin();
-        mediatorItr != mediators.end(); mediatorItr++)
-   {
-      neuron = (Neuron *)(*mediatorItr);
-      neuron->clearMotiveWork();
-   }
-}
-
-
-// Clear motive working accumulators.
-void
-Mona::Neuron::clearMotiveWork()
-{
-   motiveWork.reset();
-   motiveWorkValid = false;
-#ifdef MONA_TRACKING
-   tracker.motiveWorkPaths.clear();
-#endif
-}
-
-
-// Set motives.
-void
-Mona::setMotives()
-{
-   int    i;
-   Neuron *neuron;
-
-   list<Mediator *>::iterator mediatorItr;
-
-   for (i = 0; i < (int)receptors.size(); i++)
-   {
-      neuron = (Neuron *)receptors[i];
-      neuron->setMotive();
-   }
-   for (i = 0; i < (int)motors.size(); i++)
-   {
-      neuron = (Neuron *)motors[i];
-      neuron->setMotive();
-   }
-   for (mediatorItr = mediators.begin();
-        mediatorItr != mediators.end(); mediatorItr++)
-   {
-      neuron = (Neuron *)(*mediatorItr);
-      neuron->setMotive();
-   }
-}
-
-
-// Set neuron motive.
-void
-Mona::Neuron::setMotive()
-{
-   MOTIVE m;
-
-   m = motiveWork.getValue();
-   if (!motiveValid || (motive < m))
-   {
-      motiveValid = true;
-      motive      = m;
-   }
-
-#ifdef MONA_TRACKING
-   // Accumulate motive tracking.
-   accumMotiveTracking();
-#endif
-}
-
-
 #ifdef MONA_TRACKING
 // Accumulate motive tracking.
 void
@@ -463,184 +545,212 @@ Mona::Neuron::finalizeMotive()
 }
 
 
-// Neuron drive.
+// Drive motive from a goal source through the network.
+// The traversal is depth-first, visiting destinations in the
+// order: cause, response and effect events, subset receptors,
+// then parent mediators. A work stack replaces recursion so
+// that the depth of the network does not bound the stack.
 void
-Mona::Neuron::drive(MotiveAccum motiveAccum)
+Mona::driveMotive(DriveWorker *worker, Neuron *neuron)
 {
-   int         i;
-   Mediator    *mediator;
-   Receptor    *receptor;
-   MOTIVE      m;
-   WEIGHT      w;
-   MotiveAccum accumWork;
-
-   // Prevent looping.
-   if (!motiveAccum.addPath(this))
-   {
-      return;
-   }
+   int      i, j;
+   Mediator *mediator;
+   Receptor *receptor;
+   MOTIVE   m;
+   WEIGHT   w, a;
+   bool     cause, source;
 
-   // Accumulate need change due to goal value.
-   if ((type != MEDIATOR) || !((Mediator *)this)->goalValueSubsumed())
-   {
-      motiveAccum.accumGoals(goals);
-   }
+   a = 1.0 - DRIVE_ATTENUATION;
 
-   // Accumulate motive.
-   // Store greater motive except for attenuated "pain".
-   m = motiveAccum.getValue();
-   if (!motiveWorkValid ||
-       ((m >= NEARLY_ZERO) && ((m - motiveWork.getValue()) > NEARLY_ZERO)))
-   {
-      motiveWorkValid = true;
-      motiveWork.loadNeeds(motiveAccum);
-   }
-#ifndef MONA_TRACKING
-   else
-   {
-      return;
-   }
-#else
-   // Track motive.
-   if (!trackMotive(motiveAccum, accumWork))
-   {
-      return;
-   }
-#endif
+   vector<DriveFrame>& stack     = worker->stack;
+   MotiveAccum&        driveAccum = worker->accum;
 
-#ifdef MONA_TRACE
-   if (mona->traceDrive)
+   // Stack source.
+   if (stack.size() == 0)
    {
-      printf("Drive %llu, motive=%f\n", id, m);
+      stack.resize(1);
    }
+   stack[0].neuron = neuron;
+   stack[0].cause  = false;
+   stack[0].motiveAccum.config(worker->seed, 1.0);
+#ifdef MONA_TRACKING
+   stack[0].motiveAccum.drivers = worker->seed.drivers;
 #endif
+   worker->depth = 1;
 
-   switch (type)
+   for (source = true; worker->depth > 0; source = false)
    {
-   // Distribute motive to component events.
-   case MEDIATOR:
-      mediator = (Mediator *)this;
+      // Pop work, subject to edge budget.
+      worker->depth--;
+      if (!source)
+      {
+         if ((MAX_DRIVE_EDGES >= 0) && (worker->edges >= (COUNTER)MAX_DRIVE_EDGES))
+         {
+            for (i = 0; i <= worker->depth; i++)
+            {
+               worker->droppedMotive += fabs(stack[i].motiveAccum.getValue());
+            }
+            worker->depth = 0;
+            break;
+         }
+         worker->edges++;
+      }
+      neuron     = stack[worker->depth].neuron;
+      cause      = stack[worker->depth].cause;
+      driveAccum = stack[worker->depth].motiveAccum;
 
-      // Drive motive to cause event.
-      if ((w = mediator->driveWeights[mediator->cause]) > NEARLY_ZERO)
+      // Driving a mediator cause bypasses the mediator.
+      if (!cause)
       {
-         accumWork.config(motiveAccum, w * (1.0 - mona->DRIVE_ATTENUATION));
-         mediator->cause->drive(accumWork);
+         // Prevent looping.
+         if (!driveAccum.addPath(neuron))
+         {
+            continue;
+         }
+
+         // Accumulate need change due to goal value.
+         if ((neuron->type != MEDIATOR) || !((Mediator *)neuron)->goalValueSubsumed())
+         {
+            driveAccum.accumGoals(neuron->goals);
+         }
       }
 
-      // Drive motive to response event.
-      if (mediator->response != NULL)
+      // Accumulate motive.
+      // Store greater motive except for attenuated "pain".
+      m = driveAccum.getValue();
+      j = neuron->driveIndex;
+      if (!worker->motiveWorkValid[j] ||
+          ((m >= NEARLY_ZERO) && ((m - worker->motiveWork[j].getValue()) > NEARLY_ZERO)))
       {
-         if ((w = mediator->driveWeights[mediator->response]) > NEARLY_ZERO)
+         if (!worker->motiveWorkValid[j])
          {
-            accumWork.config(motiveAccum, w * (1.0 - mona->DRIVE_ATTENUATION));
-            mediator->response->drive(accumWork);
+            worker->motiveWorkValid[j] = true;
+            worker->visits.push_back(j);
          }
+         worker->motiveWork[j].loadNeeds(driveAccum);
       }
+#ifndef MONA_TRACKING
+      else
+      {
+         continue;
+      }
+#else
+      // Track motive.
+      worker->accumWork.drivers.clear();
+      if (!neuron->trackMotive(driveAccum, worker->accumWork))
+      {
+         continue;
+      }
+#endif
 
-      // Drive motive to effect event.
-      if ((w = mediator->driveWeights[mediator->effect]) > NEARLY_ZERO)
+      traceEvent(DRIVE_EVENT, cause ? 1 : 0, neuron->id, m);
+
+#ifdef MONA_TRACE
+      if (traceDrive)
       {
-         accumWork.config(motiveAccum, w * (1.0 - mona->DRIVE_ATTENUATION));
-         mediator->effect->drive(accumWork);
+         if (cause)
+         {
+            printf("Drive cause %llu, motive=%f\n", neuron->id, m);
+         }
+         else
+         {
+            printf("Drive %llu, motive=%f\n", neuron->id, m);
+         }
       }
-      break;
+#endif
 
-   // Receptor drives motive to subset receptors.
-   case RECEPTOR:
-      receptor = (Receptor *)this;
-      for (i = 0; i < (int)receptor->subSensorModes.size(); i++)
+      // Drive terminates on motor neurons.
+      if (neuron->type == MOTOR)
       {
-         accumWork.config(motiveAccum, 1.0);
-         receptor->subSensorModes[i]->drive(accumWork);
+         continue;
       }
-      break;
 
-   // Drive terminates on motor neurons.
-   case MOTOR:
-      return;
-   }
+      // Stack destinations in reverse of visiting order.
+      // Drive motive to parent mediators.
+      for (i = (int)neuron->notifyList.size() - 1; i >= 0; i--)
+      {
+         mediator = neuron->notifyList[i]->mediator;
+         if ((w = neuron->getDriveWeight(mediator)) > NEARLY_ZERO)
+         {
+            pushDrive(worker, mediator, true, w * a);
+         }
+      }
 
-   // Drive motive to parent mediators.
-   for (i = 0; i < (int)notifyList.size(); i++)
-   {
-      mediator = notifyList[i]->mediator;
-      if ((w = driveWeights[mediator]) > NEARLY_ZERO)
+      switch (neuron->type)
       {
-         w *= (1.0 - mona->DRIVE_ATTENUATION);
-         accumWork.config(motiveAccum, w);
-         mediator->driveCause(accumWork);
+      // Distribute motive to component events.
+      case MEDIATOR:
+         mediator = (Mediator *)neuron;
+
+         // Drive motive to effect event.
+         if (!cause)
+         {
+            if ((w = mediator->getDriveWeight(mediator->effect)) > NEARLY_ZERO)
+            {
+               pushDrive(worker, mediator->effect, false, w * a);
+            }
+         }
+
+         // Drive motive to response event.
+         if (mediator->response != NULL)
+         {
+            if ((w = mediator->getDriveWeight(mediator->response)) > NEARLY_ZERO)
+            {
+               pushDrive(worker, mediator->response, false, w * a);
+            }
+         }
+
+         // Drive motive to cause event.
+         if ((w = mediator->getDriveWeight(mediator->cause)) > NEARLY_ZERO)
+         {
+            pushDrive(worker, mediator->cause, false, w * a);
+         }
+         break;
+
+      // Receptor drives motive to subset receptors.
+      case RECEPTOR:
+         receptor = (Receptor *)neuron;
+         for (i = (int)receptor->subSensorModes.size() - 1; i >= 0; i--)
+         {
+            pushDrive(worker, receptor->subSensorModes[i], false, 1.0);
+         }
+         break;
+
+      case MOTOR:
+         break;
       }
    }
 }
 
 
-// Drive mediator cause.
+// Stack drive work configured from the worker drive accumulator.
+// Contributions below the motive epsilon are dropped.
 void
-Mona::Mediator::driveCause(MotiveAccum motiveAccum)
+Mona::pushDrive(DriveWorker *worker, Neuron *neuron, bool cause, WEIGHT weight)
 {
-   int         i;
-   Mediator    *mediator;
-   MOTIVE      m;
-   WEIGHT      w;
-   MotiveAccum accumWork;
-
-   // Accumulate motive.
-   // Store greater motive except for attenuated "pain".
-   m = motiveAccum.getValue();
-   if (!motiveWorkValid ||
-       ((m >= NEARLY_ZERO) && ((m - motiveWork.getValue()) > NEARLY_ZERO)))
-   {
-      motiveWorkValid = true;
-      motiveWork.loadNeeds(motiveAccum);
-   }
-#ifndef MONA_TRACKING
-   else
-   {
-      return;
-   }
-#else
-   // Track motive.
-   if (!trackMotive(motiveAccum, accumWork))
-   {
-      return;
-   }
-#endif
-
-#ifdef MONA_TRACE
-   if (mona->traceDrive)
-   {
-      printf("Drive cause %llu, motive=%f\n", id, m);
-   }
-#endif
-
-   // Drive motive to cause event.
-   if ((w = driveWeights[cause]) > NEARLY_ZERO)
-   {
-      accumWork.config(motiveAccum, w * (1.0 - mona->DRIVE_ATTENUATION));
-      cause->drive(accumWork);
-   }
+   MOTIVE m;
 
-   // Drive motive to response event.
-   if (response != NULL)
+   if (worker->depth == (int)worker->stack.size())
    {
-      if ((w = driveWeights[response]) > NEARLY_ZERO)
-      {
-         accumWork.config(motiveAccum, w * (1.0 - mona->DRIVE_ATTENUATION));
-         response->drive(accumWork);
-      }
+      worker->stack.resize(worker->depth + 1);
    }
-
-   // Drive motive to parent mediators.
-   for (i = 0; i < (int)notifyList.size(); i++)
+   DriveFrame& frame = worker->stack[worker->depth];
+   frame.motiveAccum.config(worker->accum, weight);
+   if (DRIVE_MOTIVE_EPSILON > 0.0)
    {
-      mediator = notifyList[i]->mediator;
-      if ((w = driveWeights[mediator]) > NEARLY_ZERO)
+      m = fabs(frame.motiveAccum.getValue());
+      if (m < DRIVE_MOTIVE_EPSILON)
       {
-         accumWork.config(motiveAccum, w * (1.0 - mona->DRIVE_ATTENUATION));
-         mediator->driveCause(accumWork);
+         worker->droppedMotive += m;
+         return;
       }
    }
+#ifdef MONA_TRACKING
+   frame.motiveAccum.drivers = worker->accumWork.drivers;
+#endif
+   frame.neuron = neuron;
+   frame.cause  = cause;
+   worker->depth++;
 }
 
 
@@ -23,12 +23,26 @@ Mona::enable()
    }
 #endif
 
+   // Enable in parallel?
+#ifndef MONA_TRACKING
+   if ((ENABLE_THREADS > 1) && ((int)mediators.size() > ENABLE_TASK_SIZE))
+   {
+#ifdef MONA_TRACE
+      if (!traceEnable)
+#endif
+      {
+         enableParallel(ENABLE_THREADS);
+         return;
+      }
+   }
+#endif
+
    // Clear mediators.
    for (mediatorItr = mediators.begin();
         mediatorItr != mediators.end(); mediatorItr++)
    {
       mediator = *mediatorItr;
-      mediator->firingStrength = 0.0;
+      mediator->setFiringStrength(0.0);
       mediator->responseEnablings.clearNewInSet();
       mediator->effectEnablings.clearNewInSet();
    }
@@ -121,11 +135,324 @@ Mona::enable()
 }
 
 
+// Order deferred enablement results by serial notification order.
+static bool
+causeFiringOrder(const pair<int, struct Mona::FiringNotify>& a,
+                 const pair<int, struct Mona::FiringNotify>& b)
+{
+   return(a.first < b.first);
+}
+
+
+static bool
+generalizationEventOrder(const pair<int, Mona::GeneralizationEvent *>& a,
+                         const pair<int, Mona::GeneralizationEvent *>& b)
+{
+   return(a.first < b.first);
+}
+
+
+// Parallel enablement processing.
+// Performs the steps of serial enablement, each across the thread pool.
+// Effect firing proceeds a level at a time: a mediator is notified
+// by its effect, which is a receptor or a lower level mediator.
+// Effective enablement is updated from the highest level down.
+// Each mediator is changed only by its own thread; goal value
+// subsumption invalidation and the cause firings and generalization
+// events that serial enablement appends to shared lists are deferred
+// and merged in serial notification order.
+void
+Mona::enableParallel(int numWorkers)
+{
+   int           i, j, k, n, level;
+   Receptor      *receptor;
+   Mediator      *mediator;
+   EnableWorker  *worker;
+   struct Notify *notify;
+
+   list<Mediator *>::iterator                          mediatorItr;
+   vector<Mediator *>                                  stack;
+   vector<pair<int, struct FiringNotify> >             causeFiringMerge;
+   vector<pair<int, GeneralizationEvent *> >           generalizationMerge;
+
+   // Prepare workers.
+   while ((int)enableWorkers.size() < numWorkers)
+   {
+      worker = new EnableWorker();
+      assert(worker != NULL);
+      enableWorkers.push_back(worker);
+   }
+   for (i = 0; i < numWorkers; i++)
+   {
+      enableWorkers[i]->clear();
+   }
+
+   // Group mediators by level.
+   enableMediators.clear();
+   for (i = 0; i < (int)enableLevels.size(); i++)
+   {
+      enableLevels[i].clear();
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      mediator = *mediatorItr;
+      enableMediators.push_back(mediator);
+      if (mediator->level >= (int)enableLevels.size())
+      {
+         enableLevels.resize(mediator->level + 1);
+      }
+      enableLevels[mediator->level].push_back(mediator);
+      mediator->enableOrder = -1;
+   }
+
+   // Number mediators in serial effect notification order:
+   // depth-first from receptors through parent mediators.
+   n = 0;
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      receptor = receptors[i];
+      for (j = 0; j < (int)receptor->notifyList.size(); j++)
+      {
+         notify = receptor->notifyList[j];
+         if (notify->eventType != EFFECT_EVENT)
+         {
+            continue;
+         }
+         stack.push_back(notify->mediator);
+         while (stack.size() > 0)
+         {
+            mediator = stack.back();
+            stack.pop_back();
+            mediator->enableOrder = n++;
+            for (k = (int)mediator->notifyList.size() - 1; k >= 0; k--)
+            {
+               notify = mediator->notifyList[k];
+               if (notify->eventType == EFFECT_EVENT)
+               {
+                  stack.push_back(notify->mediator);
+               }
+            }
+         }
+      }
+   }
+
+   deferGoalSubsumption = true;
+
+   // Clear mediators and notify of response firing events.
+   runEnableStep(CLEAR_STEP, &enableMediators,
+                 (int)enableMediators.size(), numWorkers);
+
+   // Notify mediators of effect firing events by level.
+   for (level = 0; level < (int)enableLevels.size(); level++)
+   {
+      runEnableStep(EFFECT_STEP, &enableLevels[level],
+                    (int)enableLevels[level].size(), numWorkers);
+   }
+
+   // Merge deferred cause firings and generalization events.
+   for (i = 0; i < numWorkers; i++)
+   {
+      worker = enableWorkers[i];
+      causeFiringMerge.insert(causeFiringMerge.end(),
+                              worker->causeFirings.begin(), worker->causeFirings.end());
+      generalizationMerge.insert(generalizationMerge.end(),
+                                 worker->generalizationEvents.begin(),
+                                 worker->generalizationEvents.end());
+      worker->clear();
+   }
+   stable_sort(causeFiringMerge.begin(), causeFiringMerge.end(), causeFiringOrder);
+   stable_sort(generalizationMerge.begin(), generalizationMerge.end(),
+               generalizationEventOrder);
+   enableCauseFirings.clear();
+   for (i = 0; i < (int)causeFiringMerge.size(); i++)
+   {
+      enableCauseFirings.push_back(causeFiringMerge[i].second);
+   }
+   for (i = 0; i < (int)generalizationMerge.size(); i++)
+   {
+      generalizationEvents.push_back(generalizationMerge[i].second);
+   }
+
+   // Notify mediators of cause receptor firing events.
+   runEnableStep(CAUSE_STEP, &enableMediators,
+                 (int)enableMediators.size(), numWorkers);
+
+   // Notify mediators of remaining cause firing events.
+   // A mediator has at most one cause firing per cycle.
+   runEnableStep(DEFERRED_CAUSE_STEP, NULL,
+                 (int)enableCauseFirings.size(), numWorkers);
+   enableCauseFirings.clear();
+   causeFirings.clear();
+
+   // Retire timed-out enablings.
+   runEnableStep(RETIRE_STEP, &enableMediators,
+                 (int)enableMediators.size(), numWorkers);
+
+   // Update effective enablements.
+   for (level = (int)enableLevels.size() - 1; level >= 0; level--)
+   {
+      runEnableStep(EFFECTIVE_ENABLEMENT_STEP, &enableLevels[level],
+                    (int)enableLevels[level].size(), numWorkers);
+   }
+
+   // Invalidate goal value subsumption for changed goal values.
+   deferGoalSubsumption = false;
+   for (i = 0; i < (int)enableMediators.size(); i++)
+   {
+      mediator = enableMediators[i];
+      if (mediator->goalSubsumptionDeferred)
+      {
+         mediator->goalSubsumptionDeferred = false;
+         mediator->invalidateGoalSubsumption();
+      }
+   }
+}
+
+
+// Run parallel enablement step over items in tasks of ENABLE_TASK_SIZE.
+void
+Mona::runEnableStep(ENABLE_STEP step, vector<Mediator *> *mediators,
+                    int numItems, int numWorkers)
+{
+   int numTasks;
+
+   if (numItems == 0)
+   {
+      return;
+   }
+   enableStep  = step;
+   enableTasks = mediators;
+   numTasks    = (numItems + ENABLE_TASK_SIZE - 1) / ENABLE_TASK_SIZE;
+   getThreadPool(numWorkers)->run(enableTask, (void *)this, numTasks, numWorkers);
+   enableTasks = NULL;
+}
+
+
+// Parallel enablement task.
+void
+Mona::enableTask(void *mona, int task, int worker)
+{
+   int                 i, j, begin, end;
+   Mona                *m = (Mona *)mona;
+   Mediator            *mediator, *effect;
+   Neuron              *cause;
+   EnableWorker        *enableWorker;
+   WEIGHT              strength;
+   struct Notify       *notify;
+   struct FiringNotify causeFiring;
+
+   enableWorker = m->enableWorkers[worker];
+   begin        = task * ENABLE_TASK_SIZE;
+   end          = begin + ENABLE_TASK_SIZE;
+   if (m->enableStep == DEFERRED_CAUSE_STEP)
+   {
+      if (end > (int)m->enableCauseFirings.size())
+      {
+         end = (int)m->enableCauseFirings.size();
+      }
+      for (i = begin; i < end; i++)
+      {
+         causeFiring = m->enableCauseFirings[i];
+         causeFiring.notify->mediator->causeFiring(causeFiring.notifyStrength,
+                                                   causeFiring.causeBegin);
+      }
+      return;
+   }
+   if (end > (int)m->enableTasks->size())
+   {
+      end = (int)m->enableTasks->size();
+   }
+   for (i = begin; i < end; i++)
+   {
+      mediator = (*m->enableTasks)[i];
+      switch (m->enableStep)
+      {
+      case CLEAR_STEP:
+         mediator->setFiringStrength(0.0);
+         mediator->responseEnablings.clearNewInSet();
+         mediator->effectEnablings.clearNewInSet();
+         mediator->effectNotified = false;
+         if (mediator->response != NULL)
+         {
+            mediator->responseFiring(mediator->response->firingStrength);
+         }
+         break;
+
+      case EFFECT_STEP:
+         if (mediator->effect->type == RECEPTOR)
+         {
+            strength = mediator->effect->firingStrength;
+         }
+         else if (mediator->effect->type == MEDIATOR)
+         {
+            effect = (Mediator *)mediator->effect;
+            if (!effect->effectNotified)
+            {
+               break;
+            }
+            strength = effect->effectStrength;
+         }
+         else
+         {
+            break;
+         }
+         mediator->effectNotified = true;
+         mediator->effectStrength = mediator->fireEffect(strength, enableWorker->events);
+         for (j = 0; j < (int)enableWorker->events.size(); j++)
+         {
+            enableWorker->generalizationEvents.push_back(
+               pair<int, GeneralizationEvent *>(mediator->enableOrder, enableWorker->events[j]));
+         }
+         enableWorker->events.clear();
+
+         // Record cause notifications.
+         if (mediator->effectStrength > 0.0)
+         {
+            for (j = 0; j < (int)mediator->notifyList.size(); j++)
+            {
+               notify = mediator->notifyList[j];
+               if (notify->eventType != EFFECT_EVENT)
+               {
+                  causeFiring.notify         = notify;
+                  causeFiring.notifyStrength = mediator->effectStrength;
+                  causeFiring.causeBegin     = mediator->causeBegin;
+                  enableWorker->causeFirings.push_back(
+                     pair<int, struct FiringNotify>(mediator->enableOrder, causeFiring));
+               }
+            }
+         }
+         break;
+
+      case CAUSE_STEP:
+         cause = mediator->cause;
+         if ((cause->type == RECEPTOR) && (cause->firingStrength > 0.0))
+         {
+            mediator->causeFiring(cause->firingStrength, m->eventClock);
+         }
+         break;
+
+      case RETIRE_STEP:
+         mediator->retireEnablings();
+         mediator->effectiveEnablementValid = false;
+         break;
+
+      case EFFECTIVE_ENABLEMENT_STEP:
+         mediator->updateEffectiveEnablement();
+         break;
+
+      default:
+         break;
+      }
+   }
+}
+
+
 // Firing of mediator cause event.
 void
 Mona::Mediator::causeFiring(WEIGHT notifyStrength, TIME causeBegin)
 {
-   int        i;
+   int        i, created;
    Enabling   *enabling;
    ENABLEMENT delta, enablement2;
 
@@ -140,8 +467,11 @@ Mona::Mediator::causeFiring(WEIGHT notifyStrength, TIME causeBegin)
       return;
    }
    baseEnablement -= delta;
+   dirty           = true;
+   mona->traceEvent(ENABLE_EVENT, CAUSE_EVENT, id, delta);
 
    // Distribute enablement to next neuron.
+   created = 0;
    for (i = 0; i < (int)mona->effectEventIntervalWeights[level].size(); i++)
    {
       enablement2 = delta * mona->effectEventIntervalWeights[level][i];
@@ -149,6 +479,7 @@ Mona::Mediator::causeFiring(WEIGHT notifyStrength, TIME causeBegin)
       {
          enabling = new Enabling(enablement2, motive, 0, i, causeBegin);
          assert(enabling != NULL);
+         created++;
          enabling->setNeeds(mona->homeostats);
          if (response != NULL)
          {
@@ -166,6 +497,10 @@ Mona::Mediator::causeFiring(WEIGHT notifyStrength, TIME causeBegin)
          }
       }
    }
+   if (created > 0)
+   {
+      mona->enablingsCreated.fetch_add(created, std::memory_order_relaxed);
+   }
 }
 
 
@@ -179,6 +514,10 @@ Mona::Mediator::responseFiring(WEIGHT notifyStrength)
    ENABLEMENT                 enablement;
 
    // Transfer enablings to effect event.
+   if (responseEnablings.enablings.size() > 0)
+   {
+      dirty = true;
+   }
    for (enablingItr = responseEnablings.enablings.begin();
         enablingItr != responseEnablings.enablings.end(); enablingItr++)
    {
@@ -193,6 +532,7 @@ Mona::Mediator::responseFiring(WEIGHT notifyStrength)
          enabling2->motive = motive;
          enabling2->age    = 1;
          effectEnablings.insert(enabling2);
+         mona->traceEvent(ENABLE_EVENT, RESPONSE_EVENT, id, enablement);
 #ifdef MONA_TRACKING
          effect->tracker.enable = true;
 #endif
@@ -205,17 +545,53 @@ Mona::Mediator::responseFiring(WEIGHT notifyStrength)
 void
 Mona::Mediator::effectFiring(WEIGHT notifyStrength)
 {
-   int      i;
-   Enabling *enabling;
-
-   list<Enabling *>::iterator enablingItr;
-   ENABLEMENT                 e, enablement;
+   int                 i;
    WEIGHT              strength;
    struct Notify       *notify;
    Mediator            *mediator;
    struct FiringNotify causeFiring;
-   vector<WEIGHT>      fireWeights, expireWeights;
-   bool                parentContext;
+
+   // Update for firing.
+   strength = fireEffect(notifyStrength, mona->generalizationEvents);
+
+   // Notify parent mediators.
+   for (i = 0; i < (int)notifyList.size(); i++)
+   {
+      notify   = notifyList[i];
+      mediator = notify->mediator;
+      if (notify->eventType == EFFECT_EVENT)
+      {
+         mediator->effectFiring(strength);
+      }
+      else if (strength > 0.0)
+      {
+         // Record cause notification.
+         causeFiring.notify         = notify;
+         causeFiring.notifyStrength = strength;
+         causeFiring.causeBegin     = causeBegin;
+         mona->causeFirings.push_back(causeFiring);
+      }
+   }
+}
+
+
+// Update mediator for firing of effect event.
+// Only this mediator is changed; generalization events are
+// appended to the given list.
+// Returns the firing strength to notify parent mediators with.
+Mona::WEIGHT
+Mona::Mediator::fireEffect(WEIGHT notifyStrength,
+                           vector<GeneralizationEvent *>& generalizationEvents)
+{
+   int      i, expired;
+   Enabling *enabling;
+
+   list<Enabling *>::iterator enablingItr;
+   ENABLEMENT                 e, enablement;
+   struct Notify              *notify;
+   Mediator                   *mediator;
+   vector<WEIGHT>             fireWeights, expireWeights;
+   bool                       parentContext;
 
    // If parent enabling context active, then parent's
    // enablement will be updated instead of current mediator.
@@ -235,9 +611,15 @@ Mona::Mediator::effectFiring(WEIGHT notifyStrength)
    }
 
    // Accumulate effect enablement.
+   if ((causeBegin != INVALID_TIME) || (firingStrength != 0.0) ||
+       (effectEnablings.enablings.size() > 0))
+   {
+      dirty = true;
+   }
    causeBegin     = INVALID_TIME;
    enablement     = getEnablement();
    firingStrength = 0.0;
+   expired        = 0;
    for (enablingItr = effectEnablings.enablings.begin();
         enablingItr != effectEnablings.enablings.end(); enablingItr++)
    {
@@ -283,14 +665,19 @@ Mona::Mediator::effectFiring(WEIGHT notifyStrength)
          {
             GeneralizationEvent *event = new GeneralizationEvent(this, enabling->value);
             assert(event != NULL);
-            mona->generalizationEvents.push_back(event);
+            generalizationEvents.push_back(event);
          }
 
          // Restore enablement.
          baseEnablement += enabling->value;
          enabling->value = 0.0;
+         expired++;
       }
    }
+   if (expired > 0)
+   {
+      mona->enablingsExpired.fetch_add(expired, std::memory_order_relaxed);
+   }
 
    // Update enablement and utility for firing enablings.
    for (i = 0; i < (int)fireWeights.size(); i++)
@@ -318,26 +705,12 @@ Mona::Mediator::effectFiring(WEIGHT notifyStrength)
       tracker.fire = true;
    }
 #endif
-
-   // Notify parent mediators.
-   strength = firingStrength / enablement;
-   for (i = 0; i < (int)notifyList.size(); i++)
+   if (firingStrength > 0.0)
    {
-      notify   = notifyList[i];
-      mediator = notify->mediator;
-      if (notify->eventType == EFFECT_EVENT)
-      {
-         mediator->effectFiring(strength);
-      }
-      else if (strength > 0.0)
-      {
-         // Record cause notification.
-         causeFiring.notify         = notify;
-         causeFiring.notifyStrength = strength;
-         causeFiring.causeBegin     = causeBegin;
-         mona->causeFirings.push_back(causeFiring);
-      }
+      mona->traceEvent(FIRE_EVENT, MEDIATOR, id, firingStrength);
    }
+
+   return(firingStrength / enablement);
 }
 
 
@@ -355,11 +728,7 @@ Mona::Mediator::getEnablement()
 void
 Mona::Mediator::updateEnablement(EVENT_OUTCOME outcome, WEIGHT updateWeight)
 {
-   ENABLEMENT e1, e2;
-   double     r;
-   Enabling   *enabling;
-
-   list<Enabling *>::iterator enablingItr;
+   ENABLEMENT e1;
 
    // Instinct enablement cannot be updated.
    if (instinct)
@@ -368,7 +737,7 @@ Mona::Mediator::updateEnablement(EVENT_OUTCOME outcome, WEIGHT updateWeight)
    }
 
    // Compute new enablement.
-   e1 = e2 = getEnablement();
+   e1 = getEnablement();
    if (outcome == FIRE)
    {
       if (updateWeight > 0.0)
@@ -395,16 +764,32 @@ Mona::Mediator::updateEnablement(EVENT_OUTCOME outcome, WEIGHT updateWeight)
    {
       e1 = 1.0;
    }
+   setEnablement(e1);
+}
+
+
+// Set enablement, scaling the enablings in proportion.
+void
+Mona::Mediator::setEnablement(ENABLEMENT enablement)
+{
+   ENABLEMENT e;
+   double     r;
+   Enabling   *enabling;
+
+   list<Enabling *>::iterator enablingItr;
+
+   dirty = true;
 
    // Get scaling ratio of new to old enablement.
-   if (e2 <= NEARLY_ZERO)
+   e = getEnablement();
+   if (e <= NEARLY_ZERO)
    {
-      baseEnablement = e1;
+      baseEnablement = enablement;
       r = 0.0;
    }
    else
    {
-      r = e1 / e2;
+      r = enablement / e;
       baseEnablement *= r;
    }
 
@@ -484,6 +869,11 @@ Mona::Mediator::retireEnablings(bool force)
    list<Enabling *>::iterator enablingItr;
 
    // Age and retire response enablings.
+   if ((responseEnablings.enablings.size() > 0) ||
+       (effectEnablings.enablings.size() > 0))
+   {
+      dirty = true;
+   }
    for (enablingItr = responseEnablings.enablings.begin();
         enablingItr != responseEnablings.enablings.end(); )
    {
@@ -584,6 +974,7 @@ Mona::expireResponseEnablings(RESPONSE expiringResponse)
                expireWeights.push_back(enabling->value / enablement);
                mediator->baseEnablement += enabling->value;
                enabling->value           = 0.0;
+               mediator->dirty           = true;
             }
          }
 
@@ -591,6 +982,7 @@ Mona::expireResponseEnablings(RESPONSE expiringResponse)
          {
             mediator->updateEnablement(EXPIRE, expireWeights[i]);
          }
+         enablingsExpired += expireWeights.size();
 
          for (i = 0; i < (int)mediator->notifyList.size(); i++)
          {
@@ -626,6 +1018,7 @@ Mona::expireMediatorEnablings(Mediator *mediator)
          expireWeights.push_back(enabling->value / enablement);
          mediator->baseEnablement += enabling->value;
          enabling->value           = 0.0;
+         mediator->dirty           = true;
       }
    }
 
@@ -633,6 +1026,7 @@ Mona::expireMediatorEnablings(Mediator *mediator)
    {
       mediator->updateEnablement(EXPIRE, expireWeights[i]);
    }
+   enablingsExpired += expireWeights.size();
 
    for (int i = 0; i < (int)mediator->notifyList.size(); i++)
    {
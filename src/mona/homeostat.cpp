@@ -14,6 +14,7 @@ Homeostat::Homeostat()
    periodicNeed = 0.0;
    frequency    = 0;
    freqTimer    = 0;
+   goalsIndexed = false;
 }
 
 
@@ -26,6 +27,7 @@ Homeostat::Homeostat(int needIndex, Mona *mona)
    periodicNeed    = 0.0;
    frequency       = 0;
    freqTimer       = 0;
+   goalsIndexed    = false;
 }
 
 
@@ -119,7 +121,8 @@ int Homeostat::addGoal(vector<SENSOR>& sensors, SENSOR_MODE sensorMode,
       goal.goalValue = goalValue;
       goal.enabled   = true;
       goals.push_back(goal);
-      goalIndex = (int)goals.size() - 1;
+      goalIndex    = (int)goals.size() - 1;
+      goalsIndexed = false;
    }
    return(goalIndex);
 }
@@ -260,6 +263,7 @@ bool Homeostat::removeGoal(int goalIndex)
 
    // Remove entry.
    goals.erase(goals.begin() + goalIndex);
+   goalsIndexed = false;
 
    return(true);
 }
@@ -285,7 +289,8 @@ void Homeostat::removeNeuron(void *neuron)
                ((Mona::Motor *)goals[i].motor)->goals.setValue(needIndex, 0.0);
             }
             goals.erase(goals.begin() + i);
-            done = false;
+            goalsIndexed = false;
+            done         = false;
             break;
          }
       }
@@ -293,19 +298,73 @@ void Homeostat::removeNeuron(void *neuron)
 }
 
 
+// Index goals for matching.
+void Homeostat::indexGoals()
+{
+   receptorGoals.clear();
+   distanceGoals.clear();
+   for (int i = 0; i < (int)goals.size(); i++)
+   {
+      if ((goals[i].receptor != NULL) &&
+          (mona->sensorModes[goals[i].sensorMode]->resolution <= 0.0f))
+      {
+         receptorGoals[goals[i].receptor].push_back(i);
+      }
+      else
+      {
+         distanceGoals.push_back(i);
+      }
+   }
+   goalsIndexed = true;
+}
+
+
 // Update homeostat based on sensors.
+// Candidate goals are found through the receptors fired for the
+// sensor modes, then confirmed by distance, so matching costs the
+// number of fired receptors and candidates. Goals are applied in
+// goal order.
 void Homeostat::sensorsUpdate()
 {
-   int i;
+   int         i, j;
+   SENSOR_MODE sensorMode;
 
-   vector<SENSOR> sensors;
+   map<void *, vector<int> >::iterator receptorGoalsItr;
+
+   if (!goalsIndexed)
+   {
+      indexGoals();
+   }
+   matchedGoals.clear();
+   for (i = 0; i < (int)mona->senseReceptors.size(); i++)
+   {
+      if ((mona->senseReceptors[i] != NULL) &&
+          ((receptorGoalsItr = receptorGoals.find((void *)mona->senseReceptors[i]))
+           != receptorGoals.end()))
+      {
+         vector<int>& indexes = receptorGoalsItr->second;
+         for (j = 0; j < (int)indexes.size(); j++)
+         {
+            matchedGoals.push_back(indexes[j]);
+         }
+      }
+   }
+   for (i = 0; i < (int)distanceGoals.size(); i++)
+   {
+      matchedGoals.push_back(distanceGoals[i]);
+   }
+   if (matchedGoals.size() > 1)
+   {
+      sort(matchedGoals.begin(), matchedGoals.end());
+   }
 
    // Update the need value when sensors match.
-   for (i = 0; i < (int)goals.size(); i++)
+   for (j = 0; j < (int)matchedGoals.size(); j++)
    {
-      mona->applySensorMode(mona->sensors, sensors, goals[i].sensorMode);
-      if (Mona::Receptor::sensorDistance(&goals[i].sensors, &sensors)
-          <= mona->sensorModes[goals[i].sensorMode]->resolution)
+      i          = matchedGoals[j];
+      sensorMode = goals[i].sensorMode;
+      if (mona->sensorModeDistance(goals[i].sensors, mona->sensors, sensorMode)
+          <= mona->sensorModes[sensorMode]->resolution)
       {
          if (goals[i].response != NULL_RESPONSE)
          {
@@ -415,6 +474,7 @@ void Homeostat::load(FILE *fp)
       FREAD_BOOL(&g.enabled, fp);
       goals.push_back(g);
    }
+   goalsIndexed = false;
 }
 
 
@@ -52,6 +52,19 @@ public:
    int          freqTimer;
    vector<Goal> goals;
 
+   // Goal matching index.
+   // With zero resolution a goal's receptor has the goal sensors
+   // as its centroid, so the goal can match only when its receptor
+   // fires: such goals are found by receptor. Goals of sensor modes
+   // having a positive resolution, or lacking a receptor, are matched
+   // by distance. The index is rebuilt after the goals change.
+   map<void *, vector<int> > receptorGoals;
+   vector<int>               distanceGoals;
+   vector<int>               matchedGoals;
+   bool                      goalsIndexed;
+   void indexGoals();
+   inline void invalidateGoalIndex() { goalsIndexed = false; }
+
    // Constructors.
    Homeostat();
    Homeostat(int needIndex, Mona *mona);
@@ -126,7 +139,8 @@ public:
    // Remove neuron from goals.
    void removeNeuron(void *neuron);
 
-   // Update homeostat based on sensors.
+   // Update homeostat based on sensors and the receptors
+   // fired for them.
    void sensorsUpdate();
 
    // Update homeostat based on response.
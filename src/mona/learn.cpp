@@ -103,32 +103,120 @@ Mona::learn()
       }
    }
 
+   // Create mediators in background?
+   if (LEARN_ASYNC)
+   {
+#ifdef MONA_TRACE
+      if (!traceLearn)
+#endif
+      {
+         if (learningTask == NULL)
+         {
+            learningTask = new LearningTask(this);
+            assert(learningTask != NULL);
+         }
+
+         // Hand the learning events to the worker. The lists are
+         // swapped, not copied: the network does not touch them until
+         // finishLearning swaps them back with the candidates' events.
+         learningTask->learningEvents.resize(learningEvents.size());
+         learningTask->learningEvents.swap(learningEvents);
+         learningTask->generalizationEvents.swap(generalizationEvents);
+         learningTask->eventClock = eventClock;
+         learningTask->needs.alloc(numNeeds);
+         for (i = 0; i < numNeeds; i++)
+         {
+            learningTask->needs.set(i, homeostats[i]->getNeed());
+         }
+         if (random.generator == Random::PHILOX)
+         {
+            // The task draws from its own stream.
+            random.RAND_SPLIT((RANDOM)eventClock, learningTask->random);
+         }
+         else
+         {
+            learningTask->random.SRAND(random.RAND());
+         }
+         learningTask->start();
+
+         // Increment event clock.
+         eventClock++;
+         return;
+      }
+   }
+
+   // Create new mediators.
+   createMediators();
+
+   // Delete excess mediators.
+   deleteExcessMediators();
+
+   // Increment event clock.
+   eventClock++;
+}
+
+
+// Create new mediators based on potential effect events and
+// generalization events, for the network or a background task.
+void
+Mona::createMediators(LearningTask *task)
+{
+   int           i;
+   TIME          clock;
+   LearningEvent *learningEvent;
+
+   list<LearningEvent *>::iterator learningEventItr;
+   vector<list<LearningEvent *> >  *events;
+   vector<GeneralizationEvent *>   *generalizations;
+
+   if (task == NULL)
+   {
+      events          = &learningEvents;
+      generalizations = &generalizationEvents;
+      clock           = eventClock;
+   }
+   else
+   {
+      events          = &task->learningEvents;
+      generalizations = &task->generalizationEvents;
+      clock           = task->eventClock;
+   }
+
    // Create new mediators based on potential effect events.
-   for (i = 0; i < (int)learningEvents.size(); i++)
+   for (i = 0; i < (int)events->size(); i++)
    {
-      for (learningEventItr = learningEvents[i].begin();
-           learningEventItr != learningEvents[i].end(); learningEventItr++)
+      for (learningEventItr = (*events)[i].begin();
+           learningEventItr != (*events)[i].end(); learningEventItr++)
       {
          learningEvent = *learningEventItr;
-         if ((learningEvent->end == eventClock) &&
+         if ((learningEvent->end == clock) &&
              ((learningEvent->neuron->type == MEDIATOR) ||
               ((learningEvent->neuron->type == RECEPTOR) &&
                (((Receptor *)learningEvent->neuron)->sensorMode == 0))))
          {
-            createMediator(learningEvent);
+            createMediator(learningEvent, task);
          }
       }
    }
 
    // Create mediators with generalized receptor effects.
-   for (i = 0; i < (int)generalizationEvents.size(); i++)
+   for (i = 0; i < (int)generalizations->size(); i++)
    {
-      generalizeMediator(generalizationEvents[i]);
-      delete generalizationEvents[i];
+      generalizeMediator((*generalizations)[i], task);
+      delete (*generalizations)[i];
    }
-   generalizationEvents.clear();
+   generalizations->clear();
+}
+
+
+// Delete excess mediators:
+// those beyond MAX_MEDIATORS, then those exceeding MAX_MEMORY_BYTES,
+// checked against the running estimate as each deletion updates it.
+void
+Mona::deleteExcessMediators()
+{
+   Mediator *mediator;
 
-   // Delete excess mediators.
    while ((int)mediators.size() > MAX_MEDIATORS)
    {
       if ((mediator = getWorstMediator()) == NULL)
@@ -136,29 +224,128 @@ Mona::learn()
          break;
       }
       deleteNeuron(mediator);
+      mediatorsEvicted++;
+   }
+   if (MAX_MEMORY_BYTES > 0)
+   {
+      while (memoryEstimate > MAX_MEMORY_BYTES)
+      {
+         if ((mediator = getWorstMediator()) == NULL)
+         {
+            break;
+         }
+         deleteNeuron(mediator);
+         mediatorsEvicted++;
+      }
    }
+}
 
-   // Increment event clock.
-   eventClock++;
+
+// Finish background learning:
+// wait for the worker and commit its mediators to the network.
+void
+Mona::finishLearning()
+{
+   int           i;
+   Mediator      *mediator;
+   LearningEvent *learningEvent;
+
+   vector<Mediator *>              rejects;
+   list<LearningEvent *>::iterator learningEventItr;
+
+   if ((learningTask == NULL) || !learningTask->pending)
+   {
+      return;
+   }
+   learningTask->wait();
+
+   // Take back the learning events, now followed by those of
+   // the candidates in creation order.
+   learningEvents.swap(learningTask->learningEvents);
+   for (i = 0; i < (int)learningTask->candidates.size(); i++)
+   {
+      mediator = learningTask->candidates[i].mediator;
+
+      // Reject if built on a rejected candidate or a duplicate.
+      if (((mediator->cause->type == MEDIATOR) && (mediator->cause->id == NULL_ID)) ||
+          ((mediator->effect->type == MEDIATOR) && (mediator->effect->id == NULL_ID)) ||
+          isDuplicateMediator(mediator))
+      {
+         rejects.push_back(mediator);
+         duplicateMediators++;
+
+         // Discard its learning event, near the end of its list.
+         if ((learningEvent = learningTask->candidates[i].learningEvent) != NULL)
+         {
+            list<LearningEvent *>& events = learningEvents[mediator->level + 1];
+            for (learningEventItr = events.end(); learningEventItr != events.begin(); )
+            {
+               learningEventItr--;
+               if (*learningEventItr == learningEvent)
+               {
+                  events.erase(learningEventItr);
+                  break;
+               }
+            }
+            delete learningEvent;
+         }
+         continue;
+      }
+
+      // Add to network.
+      mediator->id = idDispenser;
+      idDispenser++;
+      mediator->creationTime = learningTask->eventClock;
+      mediators.push_back(mediator);
+      mediatorsCreated++;
+      mediator->addNotify(CAUSE_EVENT, mediator->cause);
+      if (mediator->response != NULL)
+      {
+         mediator->addNotify(RESPONSE_EVENT, mediator->response);
+      }
+      mediator->addNotify(EFFECT_EVENT, mediator->effect);
+      mediator->updateGoalValue(learningTask->candidates[i].needs);
+      traceEvent(MEDIATOR_CREATE_EVENT, mediator->level, mediator->id, INITIAL_ENABLEMENT);
+
+#ifdef MONA_TRACE
+      if (traceLearn)
+      {
+         printf("Commit mediator:\n");
+         mediator->print();
+      }
+#endif
+   }
+   learningTask->candidates.clear();
+   for (i = (int)rejects.size() - 1; i >= 0; i--)
+   {
+      delete rejects[i];
+   }
+   learningTask->clear();
+
+   // Delete excess mediators.
+   deleteExcessMediators();
 }
 
 
 // Create new mediators for given effect.
 void
-Mona::createMediator(LearningEvent *effectEvent)
+Mona::createMediator(LearningEvent *effectEvent, LearningTask *task)
 {
    int           i, level;
    bool          effectRespEq, causeRespEq;
-   LearningEvent *causeEvent, *responseEvent, *learningEvent;
+   LearningEvent *causeEvent, *responseEvent;
 
    list<LearningEvent *>::iterator causeEventItr,
                                    responseEventItr;
    vector<LearningEvent *>    tmpVector;
    Mediator                   *mediator;
-   list<Mediator *>::iterator mediatorItr;
    vector<LearningEvent *>    candidates;
    PROBABILITY                accumProb, chooseProb, p;
 
+   vector<list<LearningEvent *> >& events =
+      (task == NULL ? learningEvents : task->learningEvents);
+   Random& randomizer = (task == NULL ? random : task->random);
+
    // Check event firing strength.
    if (effectEvent->firingStrength <= NEARLY_ZERO)
    {
@@ -189,8 +376,8 @@ Mona::createMediator(LearningEvent *effectEvent)
          effectRespEq = false;
       }
    }
-   for (causeEventItr = learningEvents[level].begin();
-        causeEventItr != learningEvents[level].end(); causeEventItr++)
+   for (causeEventItr = events[level].begin();
+        causeEventItr != events[level].end(); causeEventItr++)
    {
       causeEvent = *causeEventItr;
       if (causeEvent->firingStrength <= NEARLY_ZERO)
@@ -229,7 +416,7 @@ Mona::createMediator(LearningEvent *effectEvent)
    while (true)
    {
       // Make a weighted probabilistic pick of a candidate.
-      chooseProb = random.RAND_INTERVAL(0.0, accumProb);
+      chooseProb = randomizer.RAND_INTERVAL(0.0, accumProb);
       for (i = 0, p = 0.0; i < (int)candidates.size(); i++)
       {
          if (candidates[i] == NULL)
@@ -251,7 +438,7 @@ Mona::createMediator(LearningEvent *effectEvent)
       candidates[i] = NULL;
 
       // Make a probabilistic decision to create mediator.
-      if (!random.RAND_CHANCE(effectEvent->probability *
+      if (!randomizer.RAND_CHANCE(effectEvent->probability *
                               causeEvent->probability))
       {
          continue;
@@ -263,11 +450,11 @@ Mona::createMediator(LearningEvent *effectEvent)
       if ((level < MIN_RESPONSE_UNEQUIPPED_MEDIATOR_LEVEL) ||
           (effectRespEq &&
            (level <= MAX_RESPONSE_EQUIPPED_MEDIATOR_LEVEL) &&
-           random.RAND_BOOL()))
+           randomizer.RAND_BOOL()))
       {
          tmpVector.clear();
-         for (responseEventItr = learningEvents[0].begin();
-              responseEventItr != learningEvents[0].end(); responseEventItr++)
+         for (responseEventItr = events[0].begin();
+              responseEventItr != events[0].end(); responseEventItr++)
          {
             responseEvent = *responseEventItr;
             if ((responseEvent->neuron->type == MOTOR) &&
@@ -281,39 +468,21 @@ Mona::createMediator(LearningEvent *effectEvent)
          {
             continue;
          }
-         responseEvent = tmpVector[random.RAND_CHOICE((int)tmpVector.size())];
+         responseEvent = tmpVector[randomizer.RAND_CHOICE((int)tmpVector.size())];
       }
 
       // Create the mediator.
-      mediator = newMediator(INITIAL_ENABLEMENT);
-      mediator->addEvent(CAUSE_EVENT, causeEvent->neuron);
-      if (responseEvent != NULL)
-      {
-         mediator->addEvent(RESPONSE_EVENT, responseEvent->neuron);
-      }
-      mediator->addEvent(EFFECT_EVENT, effectEvent->neuron);
-      mediator->updateGoalValue(causeEvent->needs);
-
-      // Duplicate?
-      if (isDuplicateMediator(mediator))
+      mediator = makeMediator(causeEvent->neuron,
+                              (responseEvent != NULL ? responseEvent->neuron : NULL),
+                              effectEvent->neuron, causeEvent->needs, causeEvent->begin,
+                              causeEvent->firingStrength * effectEvent->firingStrength, task);
+      if (mediator == NULL)
       {
-         deleteNeuron(mediator);
          continue;
       }
 
-      // Make new mediator available for learning.
-      if ((mediator->level + 1) < (int)learningEvents.size())
-      {
-         mediator->causeBegin     = causeEvent->begin;
-         mediator->firingStrength = causeEvent->firingStrength *
-                                    effectEvent->firingStrength;
-         learningEvent = new LearningEvent(mediator);
-         assert(learningEvent != NULL);
-         learningEvents[mediator->level + 1].push_back(learningEvent);
-      }
-
 #ifdef MONA_TRACE
-      if (traceLearn)
+      if (traceLearn && (task == NULL))
       {
          printf("Create mediator:\n");
          mediator->print();
@@ -325,9 +494,9 @@ Mona::createMediator(LearningEvent *effectEvent)
 
 // Create generalized mediators.
 void
-Mona::generalizeMediator(GeneralizationEvent *generalizationEvent)
+Mona::generalizeMediator(GeneralizationEvent *generalizationEvent, LearningTask *task)
 {
-   LearningEvent *candidateEvent, *learningEvent;
+   LearningEvent *candidateEvent;
 
    list<LearningEvent *>::iterator candidateEventItr;
    Receptor                *effectReceptor, *candidateReceptor;
@@ -336,10 +505,15 @@ Mona::generalizeMediator(GeneralizationEvent *generalizationEvent)
    PROBABILITY             accumProb, chooseProb, p;
    int i;
 
+   list<LearningEvent *>& events =
+      (task == NULL ? learningEvents[0] : task->learningEvents[0]);
+   Random& randomizer = (task == NULL ? random : task->random);
+   TIME    clock      = (task == NULL ? eventClock : task->eventClock);
+
    // Find effect event candidates.
    accumProb = 0.0;
-   for (candidateEventItr = learningEvents[0].begin();
-        candidateEventItr != learningEvents[0].end(); candidateEventItr++)
+   for (candidateEventItr = events.begin();
+        candidateEventItr != events.end(); candidateEventItr++)
    {
       candidateEvent = *candidateEventItr;
       if (candidateEvent->firingStrength <= NEARLY_ZERO)
@@ -350,7 +524,7 @@ Mona::generalizeMediator(GeneralizationEvent *generalizationEvent)
       {
          continue;
       }
-      if (candidateEvent->end != eventClock)
+      if (candidateEvent->end != clock)
       {
          continue;
       }
@@ -374,7 +548,7 @@ Mona::generalizeMediator(GeneralizationEvent *generalizationEvent)
    while (true)
    {
       // Make a weighted probabilistic pick of a candidate.
-      chooseProb = random.RAND_INTERVAL(0.0, accumProb);
+      chooseProb = randomizer.RAND_INTERVAL(0.0, accumProb);
       for (i = 0, p = 0.0; i < (int)candidates.size(); i++)
       {
          if (candidates[i] == NULL)
@@ -396,47 +570,109 @@ Mona::generalizeMediator(GeneralizationEvent *generalizationEvent)
       candidates[i]  = NULL;
 
       // Make a probabilistic decision to create mediator.
-      if (!random.RAND_CHANCE(generalizationEvent->enabling))
+      if (!randomizer.RAND_CHANCE(generalizationEvent->enabling))
       {
          continue;
       }
 
       // Create the mediator.
+      mediator = makeMediator(generalizationEvent->mediator->cause,
+                              generalizationEvent->mediator->response,
+                              candidateEvent->neuron, generalizationEvent->needs,
+                              generalizationEvent->begin,
+                              generalizationEvent->enabling * candidateEvent->firingStrength,
+                              task);
+      if (mediator == NULL)
+      {
+         continue;
+      }
+
+#ifdef MONA_TRACE
+      if (traceLearn && (task == NULL))
+      {
+         printf("Create generalized mediator:\n");
+         mediator->print();
+      }
+#endif
+   }
+}
+
+
+// Make mediator from events.
+// Without a task the mediator is added to the network, and
+// a duplicate is deleted, returning NULL. For a background task the
+// mediator is a detached candidate to be committed by finishLearning.
+Mona::Mediator *
+Mona::makeMediator(Neuron *cause, Neuron *response, Neuron *effect,
+                   VALUE_SET& needs, TIME causeBegin, WEIGHT firingStrength,
+                   LearningTask *task)
+{
+   Mediator      *mediator;
+   LearningEvent *learningEvent;
+
+   struct LearningTask::Candidate candidate;
+
+   if (task == NULL)
+   {
       mediator = newMediator(INITIAL_ENABLEMENT);
-      mediator->addEvent(CAUSE_EVENT, generalizationEvent->mediator->cause);
-      if (generalizationEvent->mediator->response != NULL)
+      mediator->addEvent(CAUSE_EVENT, cause);
+      if (response != NULL)
       {
-         mediator->addEvent(RESPONSE_EVENT, generalizationEvent->mediator->response);
+         mediator->addEvent(RESPONSE_EVENT, response);
       }
-      mediator->addEvent(EFFECT_EVENT, candidateEvent->neuron);
-      mediator->updateGoalValue(generalizationEvent->needs);
+      mediator->addEvent(EFFECT_EVENT, effect);
+      mediator->updateGoalValue(needs);
+      traceEvent(MEDIATOR_CREATE_EVENT, mediator->level, mediator->id, INITIAL_ENABLEMENT);
 
       // Duplicate?
       if (isDuplicateMediator(mediator))
       {
          deleteNeuron(mediator);
-         continue;
+         duplicateMediators++;
+         return(NULL);
+      }
+      mediatorsCreated++;
+   }
+   else
+   {
+      mediator = new Mediator(INITIAL_ENABLEMENT, this);
+      assert(mediator != NULL);
+      mediator->setEvent(CAUSE_EVENT, cause);
+      if (response != NULL)
+      {
+         mediator->setEvent(RESPONSE_EVENT, response);
       }
+      mediator->setEvent(EFFECT_EVENT, effect);
+   }
 
-      // Make new mediator available for learning.
-      if ((mediator->level + 1) < (int)learningEvents.size())
+   // Make new mediator available for learning.
+   learningEvent = NULL;
+   if ((mediator->level + 1) <
+       (int)(task == NULL ? learningEvents.size() : task->learningEvents.size()))
+   {
+      mediator->causeBegin     = causeBegin;
+      mediator->firingStrength = firingStrength;
+      if (task == NULL)
       {
-         mediator->causeBegin     = generalizationEvent->begin;
-         mediator->firingStrength = generalizationEvent->enabling *
-                                    candidateEvent->firingStrength;
          learningEvent = new LearningEvent(mediator);
          assert(learningEvent != NULL);
          learningEvents[mediator->level + 1].push_back(learningEvent);
       }
-
-#ifdef MONA_TRACE
-      if (traceLearn)
+      else
       {
-         printf("Create generalized mediator:\n");
-         mediator->print();
+         learningEvent = new LearningEvent(mediator, task->eventClock, task->needs);
+         assert(learningEvent != NULL);
+         task->learningEvents[mediator->level + 1].push_back(learningEvent);
       }
-#endif
    }
+   if (task != NULL)
+   {
+      candidate.mediator      = mediator;
+      candidate.needs         = needs;
+      candidate.learningEvent = learningEvent;
+      task->candidates.push_back(candidate);
+   }
+   return(mediator);
 }
 
 
@@ -533,11 +769,18 @@ void Mona::clearWorkingMemory()
    LearningEvent                   *learningEvent;
    list<LearningEvent *>::iterator learningEventItr;
 
+   // Commit background learning.
+   finishLearning();
+
+   if (recordFile != NULL)
+   {
+      recordInput(CLEAR_WORKING_MEMORY_RECORD, 0);
+   }
    for (i = 0; i < (int)receptors.size(); i++)
    {
       receptor = receptors[i];
-      receptor->firingStrength = 0.0;
-      receptor->motive         = 0.0;
+      receptor->setFiringStrength(0.0);
+      receptor->motive = 0.0;
 #ifdef MONA_TRACKING
       receptor->tracker.clear();
 #endif
@@ -545,8 +788,8 @@ void Mona::clearWorkingMemory()
    for (i = 0; i < (int)motors.size(); i++)
    {
       motor = motors[i];
-      motor->firingStrength = 0.0;
-      motor->motive         = 0.0;
+      motor->setFiringStrength(0.0);
+      motor->motive = 0.0;
 #ifdef MONA_TRACKING
       motor->tracker.clear();
 #endif
@@ -555,8 +798,8 @@ void Mona::clearWorkingMemory()
         mediatorItr != mediators.end(); mediatorItr++)
    {
       mediator = *mediatorItr;
-      mediator->firingStrength = 0.0;
-      mediator->motive         = 0.0;
+      mediator->setFiringStrength(0.0);
+      mediator->motive = 0.0;
       mediator->retireEnablings(true);
 #ifdef MONA_TRACKING
       mediator->tracker.clear();
@@ -579,12 +822,21 @@ void Mona::clearWorkingMemory()
 void Mona::clearLongTermMemory()
 {
    Mediator *mediator;
+   FILE     *fp;
 
    list<Mediator *>           tmpMediators;
    list<Mediator *>::iterator mediatorItr;
 
-   // Must also clear working memory.
+   if (recordFile != NULL)
+   {
+      recordInput(CLEAR_LONG_TERM_MEMORY_RECORD, 0);
+   }
+
+   // Must also clear working memory, recorded as part of this.
+   fp         = recordFile;
+   recordFile = NULL;
    clearWorkingMemory();
+   recordFile = fp;
 
    // Delete all non-instinct mediators.
    for (mediatorItr = mediators.begin();
@@ -6,7 +6,8 @@
  * Usage: mona [<input timeout (secs)>]
  *
  * Interaction is through standard input/output.
- * Can use with common/socker.cpp to create a simple network service.
+ * Can use with common/socker.cpp to create a simple network service,
+ * or see server.cpp to host many networks in one process.
  *
  * Set the primary parameters:
  * parameters: <number of sensors> <number of responses> <number of needs>
@@ -60,6 +61,44 @@
  * To save to a file:
  * file: save <file name>
  *
+ * To save changes since the last save or checkpoint:
+ * file: save_delta <file name>
+ *
+ * To apply saved changes to the loaded network:
+ * file: load_delta <file name>
+ *
+ * To record inputs and responses for replay with mona_replay:
+ * file: record <file name>
+ *
+ * To stop recording:
+ * file: record_stop
+ *
+ * To write metrics in Prometheus text format every given number of cycles
+ * (0 = stop):
+ * file: metrics <file name> <number of cycles>
+ *
+ * To print latency and activity statistics:
+ * stats
+ *
+ * To trace events for decoding with mona_trace:
+ * trace: on | off | dump <file name>
+ *
+ * To switch to binary frames, which carry many cycles per frame,
+ * following the newline after the command:
+ * binary
+ * Each frame is its length in bytes, not counting the length itself,
+ * as a 32-bit unsigned integer, then a frame type byte and the fields
+ * of the type, all in native byte order:
+ * 0 (text): return to text commands.
+ * 1 (cycleN): needs flag byte, cycle count (32-bit integer), then for
+ *   each cycle its need values as 64-bit floats if flagged (NaN leaves
+ *   a need unchanged) and its sensor values as 32-bit floats.
+ *   (output:) a cycleN frame with the cycle count and the responses
+ *   as 32-bit integers.
+ * 2 (need): need number (32-bit integer), need value (64-bit float).
+ * 3 (response): override response (32-bit integer), 2147483647 for null.
+ * Only cycleN frames are answered.
+ *
  * To dump neural network to log:
  * dump
  *
@@ -75,6 +114,8 @@
 #ifdef WIN32
 #include <windows.h>
 #include <process.h>
+#include <io.h>
+#include <fcntl.h>
 #else
 #include <unistd.h>
 #include <ctype.h>
@@ -94,9 +135,21 @@
 #define FILEIO                                    10
 #define LOG                                       11
 #define DUMP                                      12
-#define HELP                                      13
-#define QUIT                                      14
-#define UNKNOWN                                   15
+#define TRACE_EVENTS                              13
+#define STATS                                     14
+#define BINARY                                    15
+#define HELP                                      16
+#define QUIT                                      17
+#define UNKNOWN                                   18
+
+// Binary frame types.
+#define TEXT_FRAME                                0
+#define CYCLE_FRAME                               1
+#define NEED_FRAME                                2
+#define RESPONSE_FRAME                            3
+
+// Maximum binary frame size.
+#define MAX_FRAME_SIZE                            (1 << 28)
 
 // Input timeout.
 int timeout = -1;
@@ -129,11 +182,9 @@ void inputError(char *msg)
 }
 
 
-// Get command
-int getCommand()
+// Start input timeout.
+void startTimeout()
 {
-   char command[50];
-
 #ifdef WIN32
    if (timeout > 0)
    {
@@ -145,11 +196,12 @@ int getCommand()
       alarm(timeout);
    }
 #endif
-   if (scanf("%49s", command) != 1)
-   {
-      inputError((char *)"Error reading command");
-      exit(1);
-   }
+}
+
+
+// Stop input timeout.
+void stopTimeout()
+{
 #ifdef WIN32
    if (timeout > 0)
    {
@@ -161,6 +213,21 @@ int getCommand()
       alarm(0);
    }
 #endif
+}
+
+
+// Get command
+int getCommand()
+{
+   char command[50];
+
+   startTimeout();
+   if (scanf("%49s", command) != 1)
+   {
+      inputError((char *)"Error reading command");
+      exit(1);
+   }
+   stopTimeout();
    switch (tolower(command[0]))
    {
    case 'p':
@@ -170,6 +237,10 @@ int getCommand()
       return(ADD_SENSOR_MODE);
 
    case 's':
+      if (strncmp(command, "stats", 5) == 0)
+      {
+         return(STATS);
+      }
       return(SET_NUM_EFFECT_EVENT_INTERVALS);
 
    case 'i':
@@ -193,6 +264,9 @@ int getCommand()
    case 'e':
       return(ERASE);
 
+   case 'b':
+      return(BINARY);
+
    case 'f':
       return(FILEIO);
 
@@ -202,6 +276,9 @@ int getCommand()
    case 'd':
       return(DUMP);
 
+   case 't':
+      return(TRACE_EVENTS);
+
    case 'h':
       return(HELP);
 
@@ -214,6 +291,179 @@ int getCommand()
 }
 
 
+// Read binary frame, returning its type.
+int readFrame(vector<unsigned char>& frame, ByteBuffer& buffer)
+{
+   unsigned int size;
+
+   startTimeout();
+   if ((fread(&size, sizeof(size), 1, stdin) != 1) ||
+       (size == 0) || (size > MAX_FRAME_SIZE))
+   {
+      inputError((char *)"Error reading frame");
+      exit(1);
+   }
+   frame.resize(size);
+   if (fread(&frame[0], 1, size, stdin) != size)
+   {
+      inputError((char *)"Error reading frame");
+      exit(1);
+   }
+   stopTimeout();
+   buffer.wrap(&frame[0], size);
+   return(buffer.get<unsigned char>());
+}
+
+
+// Run binary frames until a text frame.
+void runFrames(Mona *mona)
+{
+   int           i, j, count, response;
+   unsigned int  size;
+   unsigned char needsFlag;
+   size_t        cycleSize;
+   Mona::NEED    need;
+   ByteBuffer    buffer, output;
+
+   vector<unsigned char> frame;
+   vector<Mona::SENSOR>  sensors(mona->numSensors);
+
+   while (true)
+   {
+      switch (readFrame(frame, buffer))
+      {
+      case TEXT_FRAME:
+         if (logfp != NULL)
+         {
+            fprintf(logfp, "text\n");
+            fflush(logfp);
+         }
+         return;
+
+      case CYCLE_FRAME:
+         needsFlag = buffer.get<unsigned char>();
+         cycleSize = mona->numSensors * sizeof(float);
+         if (needsFlag)
+         {
+            cycleSize += mona->numNeeds * sizeof(double);
+         }
+         count = buffer.getCount(cycleSize);
+         if (buffer.failed || (buffer.position + (size_t)count * cycleSize != buffer.size()))
+         {
+            inputError((char *)"Invalid cycleN frame");
+            exit(1);
+         }
+         size = (unsigned int)(sizeof(unsigned char) + sizeof(int) + count * sizeof(int));
+         output.clear();
+         output.put(size);
+         output.put((unsigned char)CYCLE_FRAME);
+         output.put(count);
+         for (i = 0; i < count; i++)
+         {
+            if (needsFlag)
+            {
+               for (j = 0; j < mona->numNeeds; j++)
+               {
+                  need = buffer.get<double>();
+
+                  // Not NaN.
+                  if (need == need)
+                  {
+                     mona->setNeed(j, need);
+                  }
+               }
+            }
+            for (j = 0; j < mona->numSensors; j++)
+            {
+               sensors[j] = buffer.get<float>();
+            }
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "cycle: ");
+               for (j = 0; j < mona->numSensors; j++)
+               {
+                  fprintf(logfp, "%f ", sensors[j]);
+               }
+               fprintf(logfp, "\n");
+            }
+            response = mona->cycle(sensors);
+            if (mona->responseOverride != Mona::NULL_RESPONSE)
+            {
+               mona->clearResponseOverride();
+            }
+            output.put(response);
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "response=%d\n", response);
+               fflush(logfp);
+            }
+         }
+         if (fwrite(&output.bytes[0], 1, output.size(), stdout) != output.size())
+         {
+            exit(1);
+         }
+         fflush(stdout);
+         break;
+
+      case NEED_FRAME:
+         i    = buffer.get<int>();
+         need = buffer.get<double>();
+         if (buffer.failed || (buffer.position != buffer.size()))
+         {
+            inputError((char *)"Invalid need frame");
+            exit(1);
+         }
+         if (logfp != NULL)
+         {
+            fprintf(logfp, "need: %d %f\n", i, need);
+            fflush(logfp);
+         }
+         if ((i < 0) || (i >= mona->numNeeds))
+         {
+            fprintf(stderr, "Invalid need\n");
+            fflush(stderr);
+            exit(1);
+         }
+         mona->setNeed(i, need);
+         break;
+
+      case RESPONSE_FRAME:
+         response = buffer.get<int>();
+         if (buffer.failed || (buffer.position != buffer.size()))
+         {
+            inputError((char *)"Invalid response frame");
+            exit(1);
+         }
+         if (logfp != NULL)
+         {
+            fprintf(logfp, "override response=%d\n", response);
+            fflush(logfp);
+         }
+         if ((response < 0) ||
+             ((response >= mona->numResponses) && (response != Mona::NULL_RESPONSE)))
+         {
+            fprintf(stderr, "Invalid response\n");
+            fflush(stderr);
+            exit(1);
+         }
+         if (response == Mona::NULL_RESPONSE)
+         {
+            mona->clearResponseOverride();
+         }
+         else
+         {
+            mona->overrideResponse(response);
+         }
+         break;
+
+      default:
+         inputError((char *)"Invalid frame type");
+         exit(1);
+      }
+   }
+}
+
+
 int main(int argc, char *argv[])
 {
    int    i, j, n, r;
@@ -643,8 +893,10 @@ int main(int argc, char *argv[])
             fflush(logfp);
          }
          response = mona->cycle(sensors);
-         mona->responseOverride          = Mona::NULL_RESPONSE;
-         mona->responseOverridePotential = -1.0;
+         if (mona->responseOverride != Mona::NULL_RESPONSE)
+         {
+            mona->clearResponseOverride();
+         }
          printf("%d\n", response);
          fflush(stdout);
          if (logfp != NULL)
@@ -694,7 +946,14 @@ int main(int argc, char *argv[])
             fflush(stderr);
             exit(1);
          }
-         mona->responseOverride = response;
+         if (response == Mona::NULL_RESPONSE)
+         {
+            mona->clearResponseOverride();
+         }
+         else
+         {
+            mona->overrideResponse(response);
+         }
          break;
 
       case ERASE:
@@ -767,6 +1026,81 @@ int main(int argc, char *argv[])
             }
             mona->save(buf);
          }
+         else if ((strcmp(buf, "save_delta") == 0) || (strcmp(buf, "load_delta") == 0))
+         {
+            bool saveDelta = (strcmp(buf, "save_delta") == 0);
+            if (scanf("%49s", buf) != 1)
+            {
+               inputError((char *)"Error reading file delta command");
+               exit(1);
+            }
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "file: %s %s\n", saveDelta ? "save_delta" : "load_delta", buf);
+               fflush(logfp);
+            }
+            if (mona == NULL)
+            {
+               break;
+            }
+            if (saveDelta)
+            {
+               mona->saveDelta(buf);
+            }
+            else
+            {
+               mona->loadDelta(buf);
+            }
+         }
+         else if (strcmp(buf, "record") == 0)
+         {
+            if (scanf("%49s", buf) != 1)
+            {
+               inputError((char *)"Error reading file record command");
+               exit(1);
+            }
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "file: record %s\n", buf);
+               fflush(logfp);
+            }
+            if (mona == NULL)
+            {
+               break;
+            }
+            mona->startRecording(buf);
+         }
+         else if (strcmp(buf, "record_stop") == 0)
+         {
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "file: record_stop\n");
+               fflush(logfp);
+            }
+            if (mona == NULL)
+            {
+               break;
+            }
+            mona->stopRecording();
+         }
+         else if (strcmp(buf, "metrics") == 0)
+         {
+            if ((scanf("%49s", buf) != 1) || (scanf("%d", &n) != 1))
+            {
+               inputError((char *)"Error reading file metrics command");
+               exit(1);
+            }
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "file: metrics %s %d\n", buf, n);
+               fflush(logfp);
+            }
+            if (mona == NULL)
+            {
+               break;
+            }
+            mona->setMetricsFile(buf, n);
+         }
          else
          {
             fprintf(stderr, "Invalid file command\n");
@@ -820,6 +1154,94 @@ int main(int argc, char *argv[])
          }
          break;
 
+      case STATS:
+         if (logfp != NULL)
+         {
+            fprintf(logfp, "stats\n");
+            fflush(logfp);
+         }
+         if (mona != NULL)
+         {
+            mona->printStats(stdout);
+         }
+         fflush(stdout);
+         break;
+
+      case TRACE_EVENTS:
+         if (scanf("%49s", buf) != 1)
+         {
+            inputError((char *)"Error reading trace command");
+            exit(1);
+         }
+         if (strcmp(buf, "dump") == 0)
+         {
+            if (scanf("%49s", buf) != 1)
+            {
+               inputError((char *)"Error reading trace dump command");
+               exit(1);
+            }
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "trace: dump %s\n", buf);
+               fflush(logfp);
+            }
+            if (mona != NULL)
+            {
+               mona->dumpEventTrace(buf);
+            }
+         }
+         else if (strcmp(buf, "on") == 0)
+         {
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "trace: on\n");
+               fflush(logfp);
+            }
+            if ((mona != NULL) && (mona->eventTrace == NULL))
+            {
+               mona->startEventTrace();
+            }
+         }
+         else
+         {
+            if (logfp != NULL)
+            {
+               fprintf(logfp, "trace: off\n");
+               fflush(logfp);
+            }
+            if (mona != NULL)
+            {
+               mona->stopEventTrace();
+            }
+         }
+         break;
+
+      case BINARY:
+         // Frames follow the end of the line.
+         while (((i = getchar()) != EOF) && (i != '\n'))
+         {
+         }
+         if (logfp != NULL)
+         {
+            fprintf(logfp, "binary\n");
+            fflush(logfp);
+         }
+         if (mona == NULL)
+         {
+            inputError((char *)"Binary frames require a network");
+            exit(1);
+         }
+#ifdef WIN32
+         _setmode(_fileno(stdin), _O_BINARY);
+         _setmode(_fileno(stdout), _O_BINARY);
+#endif
+         runFrames(mona);
+#ifdef WIN32
+         _setmode(_fileno(stdin), _O_TEXT);
+         _setmode(_fileno(stdout), _O_TEXT);
+#endif
+         break;
+
       case HELP:
          printf("Commands:\n");
          printf("[p]arameters: <number of sensors> <number of responses> <number of needs>\n");
@@ -836,6 +1258,11 @@ int main(int argc, char *argv[])
          printf("[e]rase: stm (short term memory) | ltm (long term memory)\n");
          printf("[f]ile: load <file name>\n");
          printf("[f]ile: save <file name>\n");
+         printf("[f]ile: save_delta <file name>\n");
+         printf("[f]ile: load_delta <file name>\n");
+         printf("[f]ile: record <file name>\n");
+         printf("[f]ile: record_stop\n");
+         printf("[f]ile: metrics <file name> <number of cycles>\n");
          printf("[l]ogging on | off");
 #ifdef WIN32
          printf(" (file: mona%d.log)\n", _getpid());
@@ -843,6 +1270,9 @@ int main(int argc, char *argv[])
          printf(" (file: /tmp/mona%d.log)\n", getpid());
 #endif
          printf("[d]ump (neural network to log)\n");
+         printf("[t]race: on | off | dump <file name>\n");
+         printf("stats\n");
+         printf("[b]inary (switch to binary frames)\n");
          printf("[h]elp\n");
          printf("[q]uit\n");
          fflush(stdout);
@@ -864,6 +1294,11 @@ int main(int argc, char *argv[])
             fprintf(logfp, "[e]rase: stm (short term memory) | ltm (long term memory)\n");
             fprintf(logfp, "[f]ile: load <file name>\n");
             fprintf(logfp, "[f]ile: save <file name>\n");
+            fprintf(logfp, "[f]ile: save_delta <file name>\n");
+            fprintf(logfp, "[f]ile: load_delta <file name>\n");
+            fprintf(logfp, "[f]ile: record <file name>\n");
+            fprintf(logfp, "[f]ile: record_stop\n");
+            fprintf(logfp, "[f]ile: metrics <file name> <number of cycles>\n");
             fprintf(logfp, "[l]ogging on | off");
 #ifdef WIN32
             fprintf(logfp, " (to file: mona%d.log)\n", _getpid());
@@ -871,6 +1306,9 @@ int main(int argc, char *argv[])
             fprintf(logfp, " (to file: /tmp/mona%d.log)\n", getpid());
 #endif
             fprintf(logfp, "[d]ump (neural network to log)\n");
+            fprintf(logfp, "[t]race: on | off | dump <file name>\n");
+            fprintf(logfp, "stats\n");
+            fprintf(logfp, "[b]inary (switch to binary frames)\n");
             fprintf(logfp, "[h]elp\n");
             fprintf(logfp, "[q]uit\n");
             fflush(logfp);
@@ -0,0 +1,285 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona network merge test.
+ *
+ * Usage: mona_mergetest
+ *      [-cycles <number of training cycles>]
+ *      [-workers <number of worker networks>]
+ *      [-directory <scratch directory>]
+ *
+ * Trains worker clones of a base network on different world seeds,
+ * merges them into a copy of the base, then checks that the merged
+ * network keeps working: it respects MAX_MEDIATORS, cycles and goes on
+ * learning, and a save and load of it behaves identically to a clone.
+ * Also checks that merging a clone into itself keeps its size, that a
+ * fresh network imports everything, and that an incompatible merge
+ * fails. Exits with status 1 on failure.
+ */
+
+#include "mona.hpp"
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_mergetest\n",
+   (char *)"      [-cycles <number of training cycles>]\n",
+   (char *)"      [-workers <number of worker networks>]\n",
+   (char *)"      [-directory <scratch directory>]\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+// Network dimensions.
+#define NUM_SENSORS      11
+#define NUM_RESPONSES    6
+#define NUM_NEEDS        2
+#define MEDIATOR_LIMIT   500
+
+// World states.
+#define NUM_STATES       12
+
+// Set sensors for world state.
+void sense(int state, vector<Mona::SENSOR>& sensors)
+{
+   int i;
+
+   for (i = 0; i < 3; i++)
+   {
+      sensors[i] = (Mona::SENSOR)((state >> i) & 1);
+   }
+   for ( ; i < 6; i++)
+   {
+      sensors[i] = (((state + i) % 4) == 0) ? 1.0f : 0.0f;
+   }
+   for ( ; i < NUM_SENSORS; i++)
+   {
+      sensors[i] = (((state * 7 + i) % 5) < 2) ? 1.0f : 0.0f;
+   }
+}
+
+
+// Run network in world.
+// Training overrides some responses to explore.
+// Returns the responses.
+vector<int> run(Mona *mona, int cycles, RANDOM seed, bool train)
+{
+   int    i, state;
+   Random random(seed);
+
+   vector<Mona::SENSOR> sensors(NUM_SENSORS);
+   vector<int>          responses;
+   state = 0;
+   for (i = 0; i < cycles; i++)
+   {
+      state = (state + (mona->response % 3) +
+               (random.RAND_CHOICE(4) == 0 ? random.RAND_CHOICE(5) : 0)) % NUM_STATES;
+      sense(state, sensors);
+      if ((i % 97) == 0)
+      {
+         mona->setNeed(0, 1.0);
+      }
+      if ((i % 131) == 0)
+      {
+         mona->setNeed(1, 1.0);
+      }
+      if (train && ((i % 13) == 5))
+      {
+         mona->overrideResponse(random.RAND_CHOICE(NUM_RESPONSES));
+      }
+      responses.push_back(mona->cycle(sensors));
+   }
+   return(responses);
+}
+
+
+// Create base network.
+Mona *createNetwork()
+{
+   int  i;
+   Mona *mona;
+
+   mona = new Mona();
+   assert(mona != NULL);
+   mona->MAX_MEDIATORS = MEDIATOR_LIMIT;
+   mona->initNet(NUM_SENSORS, NUM_RESPONSES, NUM_NEEDS, 4517);
+   vector<bool> mask(NUM_SENSORS, true);
+   mona->addSensorMode(mask);
+   for (i = 0; i < NUM_SENSORS; i++)
+   {
+      mask[i] = (i < 3);
+   }
+   mona->addSensorMode(mask);
+   for (i = 0; i < NUM_SENSORS; i++)
+   {
+      mask[i] = (i >= 3);
+   }
+   mona->addSensorMode(mask);
+   vector<Mona::SENSOR> goal(NUM_SENSORS);
+   sense(3, goal);
+   mona->addGoal(0, goal, 0, 0.5);
+   sense(7, goal);
+   mona->addGoal(1, goal, 2, 0.5);
+   return(mona);
+}
+
+
+int main(int argc, char *argv[])
+{
+   int  i, cycles, numWorkers, numReceptors, numMediators;
+   char *directory;
+   char filename[BUFSIZ];
+   bool pass;
+   Mona *base, *mona, *merged, *loaded;
+
+   vector<Mona *> workers;
+
+   cycles     = 1500;
+   numWorkers = 3;
+   directory  = (char *)".";
+   for (i = 1; i < argc; i++)
+   {
+      if (((strcmp(argv[i], "-cycles") == 0) ||
+           (strcmp(argv[i], "-workers") == 0)) &&
+          (i + 1 < argc) && (atoi(argv[i + 1]) > 0))
+      {
+         if (strcmp(argv[i], "-cycles") == 0)
+         {
+            cycles = atoi(argv[i + 1]);
+         }
+         else
+         {
+            numWorkers = atoi(argv[i + 1]);
+         }
+         i++;
+         continue;
+      }
+      if ((strcmp(argv[i], "-directory") == 0) && (i + 1 < argc))
+      {
+         i++;
+         directory = argv[i];
+         continue;
+      }
+      printUsage();
+      exit(1);
+   }
+   pass = true;
+
+   // Pretrain base network.
+   base = createNetwork();
+   run(base, 200, 1, true);
+
+   // Merging a clone into itself keeps its size.
+   mona         = base->clone();
+   numReceptors = (int)mona->receptors.size();
+   numMediators = (int)mona->mediators.size();
+   if (!mona->merge(*base) ||
+       ((int)mona->receptors.size() != numReceptors) ||
+       ((int)mona->mediators.size() != numMediators))
+   {
+      fprintf(stderr, "Self merge changed network: receptors %d->%d, mediators %d->%d\n",
+              numReceptors, (int)mona->receptors.size(),
+              numMediators, (int)mona->mediators.size());
+      pass = false;
+   }
+   delete mona;
+
+   // A fresh network imports everything.
+   mona = new Mona(NUM_SENSORS, NUM_RESPONSES, NUM_NEEDS);
+   assert(mona != NULL);
+   mona->MAX_MEDIATORS = MEDIATOR_LIMIT;
+   if (!mona->merge(*base) ||
+       (mona->receptors.size() != base->receptors.size()) ||
+       (mona->mediators.size() != base->mediators.size()))
+   {
+      fprintf(stderr, "Fresh merge: receptors %d/%d, mediators %d/%d\n",
+              (int)mona->receptors.size(), (int)base->receptors.size(),
+              (int)mona->mediators.size(), (int)base->mediators.size());
+      pass = false;
+   }
+   run(mona, 300, 9, false);
+   delete mona;
+
+   // An incompatible network does not merge.
+   mona = new Mona(NUM_SENSORS + 1, NUM_RESPONSES, NUM_NEEDS);
+   assert(mona != NULL);
+   if (mona->merge(*base))
+   {
+      fprintf(stderr, "Incompatible merge succeeded\n");
+      pass = false;
+   }
+   delete mona;
+
+   // Train workers on different seeds and merge them.
+   merged = base->clone();
+   for (i = 0; i < numWorkers; i++)
+   {
+      workers.push_back(base->clone());
+      run(workers[i], cycles, 100 + i, true);
+      if (!merged->merge(*workers[i]))
+      {
+         fprintf(stderr, "Cannot merge worker %d\n", i);
+         pass = false;
+      }
+   }
+   if ((int)merged->mediators.size() > MEDIATOR_LIMIT)
+   {
+      fprintf(stderr, "Merged network has %d mediators, maximum %d\n",
+              (int)merged->mediators.size(), MEDIATOR_LIMIT);
+      pass = false;
+   }
+   printf("Merged %d workers: %d receptors, %d mediators\n", numWorkers,
+          (int)merged->receptors.size(), (int)merged->mediators.size());
+
+   // The merged network keeps working.
+   run(merged, cycles, 77, true);
+   if ((int)merged->mediators.size() > MEDIATOR_LIMIT)
+   {
+      fprintf(stderr, "Merged network grew to %d mediators, maximum %d\n",
+              (int)merged->mediators.size(), MEDIATOR_LIMIT);
+      pass = false;
+   }
+   sprintf(filename, "%s/mergetest.mona", directory);
+   loaded = new Mona();
+   assert(loaded != NULL);
+   if (!merged->save(filename) || !loaded->load(filename))
+   {
+      fprintf(stderr, "Cannot save and load merged network\n");
+      pass = false;
+   }
+   else
+   {
+      mona = merged->clone();
+      if (run(mona, 500, 5, false) != run(loaded, 500, 5, false))
+      {
+         fprintf(stderr, "Reloaded merged network behaves differently\n");
+         pass = false;
+      }
+      delete mona;
+   }
+   remove(filename);
+   delete loaded;
+   delete merged;
+   for (i = 0; i < numWorkers; i++)
+   {
+      delete workers[i];
+   }
+   delete base;
+   if (pass)
+   {
+      printf("Pass\n");
+      exit(0);
+   }
+   else
+   {
+      printf("Fail\n");
+      exit(1);
+   }
+}
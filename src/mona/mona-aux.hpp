@@ -12,6 +12,35 @@ class Motor;
 class Mediator;
 class EnablingSet;
 
+// Quantized sensor vector.
+// The unmasked sensors of a quantized sensor mode, stored as
+// 8 or 16 bit codes of the sensor values times a scale.
+class SensorCodes
+{
+public:
+   int                   quantization;
+   SENSOR                scale;
+   int                   size;
+   vector<unsigned char> codes;
+
+   // Constructor.
+   SensorCodes()
+   {
+      quantization = 0;
+      scale        = 1.0f;
+      size         = 0;
+   }
+
+
+   // Get distance between code vectors.
+   // Distance metric is Euclidean distance squared in sensor units.
+   static SENSOR codeDistance(SensorCodes *codesA, SensorCodes *codesB);
+
+   // RDtree search.
+   static SENSOR patternDistance(void *codesA, void *codesB);
+   static void deletePattern(void *pattern);
+};
+
 // Sensor mode.
 class SensorMode
 {
@@ -22,11 +51,27 @@ public:
    vector<SENSOR_MODE> subsets;
    vector<SENSOR_MODE> supersets;
 
+   // Centroid quantization: none, or 8 or 16 bit codes of the
+   // sensor values times the scale, rounded and clamped to the
+   // code range. Sensor values that are multiples of 1/scale
+   // within the range keep their exact distances.
+   enum { NO_QUANTIZATION=0, QUANTIZE_8=8, QUANTIZE_16=16 };
+   int    quantization;
+   SENSOR quantizationScale;
+
+   // Compiled mode: indices of masked sensors, and the
+   // relation of each mode to this one, indexed by mode.
+   enum { UNRELATED_MODE=0, SUBSET_MODE=1, SUPERSET_MODE=2 };
+   vector<int>  indices;
+   vector<char> relations;
+
    // Constructor.
    SensorMode()
    {
-      mode       = 0;
-      resolution = 0.0f;
+      mode              = 0;
+      resolution        = 0.0f;
+      quantization      = NO_QUANTIZATION;
+      quantizationScale = 1.0f;
    }
 
 
@@ -76,6 +121,83 @@ public:
    }
 
 
+   // Compile mask and subset/superset relations.
+   void compile(vector<SensorMode *> *sensorModes)
+   {
+      int i;
+
+      indices.clear();
+      for (i = 0; i < (int)mask.size(); i++)
+      {
+         if (mask[i])
+         {
+            indices.push_back(i);
+         }
+      }
+      relations.assign(sensorModes->size(), (char)UNRELATED_MODE);
+      for (i = 0; i < (int)subsets.size(); i++)
+      {
+         if ((subsets[i] >= 0) && (subsets[i] < (int)relations.size()))
+         {
+            relations[subsets[i]] = SUBSET_MODE;
+         }
+      }
+      for (i = 0; i < (int)supersets.size(); i++)
+      {
+         if ((supersets[i] >= 0) && (supersets[i] < (int)relations.size()))
+         {
+            relations[supersets[i]] = SUPERSET_MODE;
+         }
+      }
+   }
+
+
+   // Quantize the unmasked sensors into codes.
+   void quantize(vector<SENSOR>& sensors, SensorCodes& codes)
+   {
+      int            i, j, n;
+      double         v, max;
+      unsigned short *codes16;
+
+      n                  = (int)indices.size();
+      codes.quantization = quantization;
+      codes.scale        = quantizationScale;
+      codes.size         = n;
+      codes.codes.resize(quantization == QUANTIZE_8 ? n : 2 * n);
+      if (n == 0)
+      {
+         return;
+      }
+      max     = (quantization == QUANTIZE_8) ? 255.0 : 65535.0;
+      codes16 = (unsigned short *)&codes.codes[0];
+      for (i = 0; i < n; i++)
+      {
+         j = indices[i];
+         v = 0.0;
+         if (j < (int)sensors.size())
+         {
+            v = floor((double)sensors[j] * (double)quantizationScale + 0.5);
+            if (v < 0.0)
+            {
+               v = 0.0;
+            }
+            else if (v > max)
+            {
+               v = max;
+            }
+         }
+         if (quantization == QUANTIZE_8)
+         {
+            codes.codes[i] = (unsigned char)v;
+         }
+         else
+         {
+            codes16[i] = (unsigned short)v;
+         }
+      }
+   }
+
+
    // Given mode is subset/superset?
    void subSuper(SensorMode *sensorMode, bool& sub, bool& super)
    {
@@ -220,6 +342,11 @@ public:
       }
       fprintf(out, "</mask>");
       fprintf(out, "<resolution>%f</resolution>", resolution);
+      if (quantization != NO_QUANTIZATION)
+      {
+         fprintf(out, "<quantization>%d</quantization><scale>%f</scale>",
+                 quantization, quantizationScale);
+      }
       fprintf(out, "<subsets>");
       size = (int)subsets.size();
       for (i = 0; i < size; i++)
@@ -246,13 +373,15 @@ public:
    VALUE_SET values;
    COUNTER   updateCount;
    Mona      *mona;
+   Neuron    *neuron;
 
    // Constructors.
    GoalValue(int numGoals, Mona *mona)
    {
       values.alloc(numGoals);
-      updateCount = 0;
-      this->mona  = mona;
+      updateCount  = 0;
+      this->mona   = mona;
+      this->neuron = NULL;
    }
 
 
@@ -260,14 +389,17 @@ public:
    {
       updateCount = 0;
       mona        = NULL;
+      neuron      = NULL;
    }
 
 
    // Initialize.
-   void init(int numGoals, Mona *mona)
+   // The owning neuron is notified of value changes.
+   void init(int numGoals, Mona *mona, Neuron *neuron = NULL)
    {
       values.alloc(numGoals);
-      this->mona = mona;
+      this->mona   = mona;
+      this->neuron = neuron;
    }
 
 
@@ -295,7 +427,11 @@ public:
    // Set specific goal value.
    inline void setValue(int index, NEED value)
    {
-      values.set(index, value);
+      if (values.get(index) != value)
+      {
+         values.set(index, value);
+         changed();
+      }
    }
 
 
@@ -303,6 +439,18 @@ public:
    inline void setGoals(VALUE_SET& goals)
    {
       values.load(goals);
+      changed();
+   }
+
+
+   // Notify owning neuron of goal value change.
+   inline void changed()
+   {
+      if (neuron != NULL)
+      {
+         neuron->dirty = true;
+         neuron->invalidateGoalSubsumption();
+      }
    }
 
 
@@ -350,6 +498,7 @@ public:
          values.set(i, values.get(i) + ((-v / (double)updateCount) *
                                         mona->LEARNING_INCREASE_VELOCITY));
       }
+      changed();
    }
 
 
@@ -575,6 +724,74 @@ public:
 };
 
 
+// Drive work frame.
+// Motive to be driven into a neuron, stacked by the
+// iterative drive traversal in place of recursion.
+class DriveFrame
+{
+public:
+   Neuron      *neuron;
+   bool        cause;
+   MotiveAccum motiveAccum;
+
+   // Constructor.
+   DriveFrame()
+   {
+      neuron = NULL;
+      cause  = false;
+   }
+};
+
+
+// Drive worker.
+// Traversal state and private motive accumulators
+// for the goal sources driven by one thread.
+// Accumulators are indexed by neuron drive index.
+class DriveWorker
+{
+public:
+   vector<DriveFrame>  stack;
+   int                 depth;
+   MotiveAccum         seed;
+   MotiveAccum         accum;
+   MotiveAccum         accumWork;
+   vector<MotiveAccum> motiveWork;
+   vector<bool>        motiveWorkValid;
+   vector<int>         visits;
+   vector<MOTIVE>      motives;
+   vector<int>         motiveCounts;
+   COUNTER             edges;
+   MOTIVE              droppedMotive;
+
+   // Constructor.
+   DriveWorker()
+   {
+      depth         = 0;
+      edges         = 0;
+      droppedMotive = 0.0;
+   }
+
+
+   // Initialize for a drive phase.
+   void init(VALUE_SET& needs, int numNeurons)
+   {
+      seed.init(needs);
+      motiveWork.resize(numNeurons);
+      for (int i = 0; i < numNeurons; i++)
+      {
+         motiveWork[i].init(needs);
+      }
+      motiveWorkValid.assign(numNeurons, false);
+      visits.clear();
+      motives.assign(numNeurons, 0.0);
+      motiveCounts.assign(numNeurons, 0);
+      depth         = 0;
+      edges         = 0;
+      droppedMotive = 0.0;
+   }
+};
+
+
 // Event enabling.
 class Enabling
 {
@@ -927,6 +1144,37 @@ public:
    VALUE_SET   needs;
 
    LearningEvent(Neuron *neuron)
+   {
+      init(neuron, neuron->mona->eventClock);
+      int n = neuron->mona->numNeeds;
+      needs.alloc(n);
+      for (int i = 0; i < n; i++)
+      {
+         needs.set(i, neuron->mona->homeostats[i]->getNeed());
+      }
+   }
+
+
+   // Event at given time with given needs.
+   LearningEvent(Neuron *neuron, TIME eventClock, VALUE_SET& needs)
+   {
+      init(neuron, eventClock);
+      this->needs = needs;
+   }
+
+
+   LearningEvent()
+   {
+      neuron         = NULL;
+      firingStrength = 0.0;
+      begin          = end = 0;
+      probability    = 0.0;
+      needs.clear();
+   }
+
+
+   // Initialize.
+   void init(Neuron *neuron, TIME eventClock)
    {
       this->neuron   = neuron;
       firingStrength = neuron->firingStrength;
@@ -936,9 +1184,9 @@ public:
       }
       else
       {
-         begin = neuron->mona->eventClock;
+         begin = eventClock;
       }
-      end = neuron->mona->eventClock;
+      end = eventClock;
       if (firingStrength > NEARLY_ZERO)
       {
          probability =
@@ -948,22 +1196,6 @@ public:
       {
          probability = 0.0;
       }
-      int n = neuron->mona->numNeeds;
-      needs.alloc(n);
-      for (int i = 0; i < n; i++)
-      {
-         needs.set(i, neuron->mona->homeostats[i]->getNeed());
-      }
-   }
-
-
-   LearningEvent()
-   {
-      neuron         = NULL;
-      firingStrength = 0.0;
-      begin          = end = 0;
-      probability    = 0.0;
-      needs.clear();
    }
 
 
@@ -1140,4 +1372,166 @@ public:
       fprintf(out, "/<needs>");
    }
 };
+
+
+// Enable worker.
+// Cause firings and generalization events deferred by one thread
+// during parallel enablement. Each is keyed by the serial
+// notification order of the mediator that produced it.
+class EnableWorker
+{
+public:
+   vector<pair<int, struct FiringNotify> >   causeFirings;
+   vector<pair<int, GeneralizationEvent *> > generalizationEvents;
+   vector<GeneralizationEvent *>             events;
+
+   // Clear.
+   void clear()
+   {
+      causeFirings.clear();
+      generalizationEvents.clear();
+      events.clear();
+   }
+};
+
+
+// Background learning task.
+// Holds the network's learning events, swapped in for a cycle, from
+// which a worker thread creates candidate mediators detached from the
+// network, appending their learning events. The candidates and the
+// events are handed back to the network by the next cycle.
+class LearningTask
+{
+public:
+   Mona                           *mona;
+   vector<list<LearningEvent *> > learningEvents;
+   vector<GeneralizationEvent *>  generalizationEvents;
+   TIME                           eventClock;
+   VALUE_SET                      needs;
+   Random                         random;
+   bool                           pending;
+
+   // Candidate mediator with the needs for its goal value
+   // and its learning event in learningEvents, if any.
+   struct Candidate
+   {
+      Mediator      *mediator;
+      VALUE_SET     needs;
+      LearningEvent *learningEvent;
+   };
+   vector<struct Candidate> candidates;
+
+   // Constructor.
+   LearningTask(Mona *mona)
+   {
+      this->mona = mona;
+      eventClock = 0;
+      pending    = false;
+      running    = false;
+      stop       = false;
+      thread     = new std::thread(&LearningTask::work, this);
+      assert(thread != NULL);
+   }
+
+
+   // Destructor.
+   ~LearningTask()
+   {
+      wait();
+      {
+         std::lock_guard<std::mutex> lock(taskMutex);
+         stop = true;
+      }
+      wakeup.notify_one();
+      thread->join();
+      delete thread;
+      clear();
+   }
+
+
+   // Start creating candidates in background.
+   void start()
+   {
+      {
+         std::lock_guard<std::mutex> lock(taskMutex);
+         pending = running = true;
+      }
+      wakeup.notify_one();
+   }
+
+
+   // Wait for candidates.
+   void wait()
+   {
+      std::unique_lock<std::mutex> lock(taskMutex);
+      while (running)
+      {
+         done.wait(lock);
+      }
+   }
+
+
+   // Clear events and candidates.
+   void clear()
+   {
+      int i;
+
+      list<LearningEvent *>::iterator learningEventItr;
+
+      for (i = 0; i < (int)learningEvents.size(); i++)
+      {
+         for (learningEventItr = learningEvents[i].begin();
+              learningEventItr != learningEvents[i].end(); learningEventItr++)
+         {
+            delete *learningEventItr;
+         }
+         learningEvents[i].clear();
+      }
+      for (i = 0; i < (int)generalizationEvents.size(); i++)
+      {
+         delete generalizationEvents[i];
+      }
+      generalizationEvents.clear();
+
+      // Delete uncommitted candidates, dependents first.
+      for (i = (int)candidates.size() - 1; i >= 0; i--)
+      {
+         delete candidates[i].mediator;
+      }
+      candidates.clear();
+      pending = false;
+   }
+
+
+private:
+
+   std::thread             *thread;
+   bool                    running;
+   bool                    stop;
+   std::mutex              taskMutex;
+   std::condition_variable wakeup;
+   std::condition_variable done;
+
+   // Worker thread.
+   void work()
+   {
+      std::unique_lock<std::mutex> lock(taskMutex);
+      while (true)
+      {
+         while (!stop && !running)
+         {
+            wakeup.wait(lock);
+         }
+         if (stop)
+         {
+            return;
+         }
+         lock.unlock();
+         mona->createMediators(this);
+         lock.lock();
+         running = false;
+         done.notify_one();
+      }
+   }
+};
 #endif
@@ -1,6 +1,10 @@
 // For conditions of distribution and use, see copyright notice in mona.hpp
 
 #include "mona.hpp"
+#ifndef WIN32
+#include <errno.h>
+#include <sys/wait.h>
+#endif
 
 // Version.
 const char *MonaVersion = MONA_VERSION;
@@ -20,6 +24,8 @@ const Mona::ID Mona::NULL_ID = Homeostat::NULL_ID;
 Mona::RESPONSE
 Mona::cycle(vector<Mona::SENSOR>& sensors)
 {
+   unsigned long long cycleBegin = (cycleLatencies != NULL) ? metricsClock() : 0;
+
    // Input sensors.
    assert((int)sensors.size() == numSensors);
    this->sensors.clear();
@@ -28,24 +34,97 @@ Mona::cycle(vector<Mona::SENSOR>& sensors)
       this->sensors.push_back(sensors[i]);
    }
 
+   // Commit background learning from previous cycle.
+   beginPhase(COMMIT_LEARNING_PHASE);
+   finishLearning();
+   endPhase(COMMIT_LEARNING_PHASE);
+
 #ifdef MONA_TRACKING
    // Clear tracking activity.
    clearTracking();
 #endif
 
+   beginPhase(SENSE_PHASE);
    sense();
+   endPhase(SENSE_PHASE);
+   beginPhase(ENABLE_PHASE);
    enable();
+   endPhase(ENABLE_PHASE);
+   beginPhase(LEARN_PHASE);
    learn();
+   endPhase(LEARN_PHASE);
+   beginPhase(DRIVE_PHASE);
    drive();
+   endPhase(DRIVE_PHASE);
+   beginPhase(RESPOND_PHASE);
    respond();
+   endPhase(RESPOND_PHASE, (double)response);
+
+   if (recordFile != NULL)
+   {
+      recordCycle(sensors);
+   }
 
+   // Update metrics.
+   cycles++;
+   if (cycleLatencies != NULL)
+   {
+      cycleLatencies->record(metricsClock() - cycleBegin);
+   }
+   if ((metricsFile != NULL) &&
+       ((cycles % (unsigned long long)metricsInterval) == 0))
+   {
+      writeMetrics(metricsFile);
+   }
    return(response);
 }
 
 
+// Begin cycle phase.
+void
+Mona::beginPhase(TRACE_PHASE phase)
+{
+   traceEvent(PHASE_BEGIN_EVENT, phase, NULL_ID, 0.0);
+   if (phaseLatencies != NULL)
+   {
+      phaseBegin = metricsClock();
+   }
+}
+
+
+// End cycle phase.
+void
+Mona::endPhase(TRACE_PHASE phase, double value)
+{
+   if (phaseLatencies != NULL)
+   {
+      phaseLatencies[phase].record(metricsClock() - phaseBegin);
+   }
+   traceEvent(PHASE_END_EVENT, phase, NULL_ID, value);
+}
+
+
 // Construct empty network.
-Mona::Mona()
+Mona::Mona() :
+   sensorMemberModes(ownSensorMemberModes),
+   effectEventIntervals(ownEffectEventIntervals),
+   effectEventIntervalWeights(ownEffectEventIntervalWeights),
+   maxLearningEffectEventIntervals(ownMaxLearningEffectEventIntervals)
 {
+   configuration      = NULL;
+   threadPool         = NULL;
+   learningTask       = NULL;
+   saveAsyncPreflight = NULL;
+   saveAsyncClient    = NULL;
+   recordFile         = NULL;
+   recordFileOwned    = false;
+   eventTrace         = NULL;
+   metricsFile        = NULL;
+   metricsInterval    = 0;
+   phaseLatencies     = NULL;
+   cycleLatencies     = NULL;
+   setLatencyMetrics(true);
+   resetMetrics();
    clearVars();
    initParms();
 }
@@ -53,14 +132,59 @@ Mona::Mona()
 
 // Construct network.
 Mona::Mona(int numSensors, int numResponses, int numNeeds,
-           RANDOM randomSeed)
+           RANDOM randomSeed) :
+   sensorMemberModes(ownSensorMemberModes),
+   effectEventIntervals(ownEffectEventIntervals),
+   effectEventIntervalWeights(ownEffectEventIntervalWeights),
+   maxLearningEffectEventIntervals(ownMaxLearningEffectEventIntervals)
 {
+   configuration      = NULL;
+   threadPool         = NULL;
+   learningTask       = NULL;
+   saveAsyncPreflight = NULL;
+   saveAsyncClient    = NULL;
+   recordFile         = NULL;
+   recordFileOwned    = false;
+   eventTrace         = NULL;
+   metricsFile        = NULL;
+   metricsInterval    = 0;
+   phaseLatencies     = NULL;
+   cycleLatencies     = NULL;
+   setLatencyMetrics(true);
+   resetMetrics();
    clearVars();
    initParms();
    initNet(numSensors, numResponses, numNeeds, randomSeed);
 }
 
 
+// Construct empty network sharing a configuration.
+Mona::Mona(Mona *configuration) :
+   sensorMemberModes(configuration->sensorMemberModes),
+   effectEventIntervals(configuration->effectEventIntervals),
+   effectEventIntervalWeights(configuration->effectEventIntervalWeights),
+   maxLearningEffectEventIntervals(configuration->maxLearningEffectEventIntervals)
+{
+   assert(configuration->configuration == NULL);
+   this->configuration = configuration;
+   threadPool          = NULL;
+   learningTask        = NULL;
+   saveAsyncPreflight  = NULL;
+   saveAsyncClient     = NULL;
+   recordFile          = NULL;
+   recordFileOwned     = false;
+   eventTrace          = NULL;
+   metricsFile         = NULL;
+   metricsInterval     = 0;
+   phaseLatencies      = NULL;
+   cycleLatencies      = NULL;
+   setLatencyMetrics(true);
+   resetMetrics();
+   clearVars();
+   initParms();
+}
+
+
 // Initialize parameters.
 void Mona::initParms()
 {
@@ -83,6 +207,18 @@ void Mona::initParms()
    SENSOR_RESOLUTION = 0.0f;
    LEARN_MEDIATOR_GOAL_VALUE_MIN_LEVEL = 2;
    LEARN_RECEPTOR_GOAL_VALUE           = false;
+   DRIVE_MOTIVE_EPSILON = 0.0;
+   MAX_DRIVE_EDGES      = -1;
+   DRIVE_THREADS        = 1;
+   ENABLE_THREADS       = 1;
+   LEARN_ASYNC          = false;
+   MAX_MEMORY_BYTES     = 0;
+
+   // A shared configuration keeps its intervals.
+   if (configuration != NULL)
+   {
+      return;
+   }
 
    // Initialize effect event intervals.
    initEffectEventIntervals();
@@ -100,6 +236,12 @@ void Mona::initEffectEventIntervals()
 {
    int i, j;
 
+   // A shared configuration is read-only.
+   if (configuration != NULL)
+   {
+      return;
+   }
+
    // Create the intervals.
    effectEventIntervals.resize(MAX_MEDIATOR_LEVEL + 1);
    for (i = 0; i <= MAX_MEDIATOR_LEVEL; i++)
@@ -119,6 +261,12 @@ void Mona::initEffectEventIntervals()
 // Initialize effect event intervals and weights for specific level.
 void Mona::initEffectEventInterval(int level, int numIntervals)
 {
+   // A shared configuration is read-only.
+   if (configuration != NULL)
+   {
+      return;
+   }
+
    // Create the intervals.
    effectEventIntervals[level].resize(numIntervals);
    for (int i = 0; i < numIntervals; i++)
@@ -135,6 +283,12 @@ void Mona::initEffectEventInterval(int level, int numIntervals)
 // the effect event intervals and a simple inverse proportional rule.
 void Mona::initEffectEventIntervalWeights()
 {
+   // A shared configuration is read-only.
+   if (configuration != NULL)
+   {
+      return;
+   }
+
    effectEventIntervalWeights.resize((int)effectEventIntervals.size());
    for (int i = 0; i < (int)effectEventIntervalWeights.size(); i++)
    {
@@ -149,6 +303,12 @@ void Mona::initEffectEventIntervalWeight(int level)
    int    i;
    WEIGHT sum;
 
+   // A shared configuration is read-only.
+   if (configuration != NULL)
+   {
+      return;
+   }
+
    sum = 0.0;
    effectEventIntervalWeights[level].resize((int)effectEventIntervals[level].size());
    for (i = 0; i < (int)effectEventIntervalWeights[level].size(); i++)
@@ -168,6 +328,12 @@ void Mona::initMaxLearningEffectEventIntervals()
 {
    int i, j;
 
+   // A shared configuration is read-only.
+   if (configuration != NULL)
+   {
+      return;
+   }
+
    maxLearningEffectEventIntervals.clear();
    for (i = 0; i <= MAX_MEDIATOR_LEVEL; i++)
    {
@@ -342,6 +508,16 @@ void Mona::clearVars()
    responseOverridePotential = -1.0;
    randomSeed                = INVALID_RANDOM;
    idDispenser               = 0;
+   driveEdges                = 0;
+   droppedMotive             = 0.0;
+   enableTasks               = NULL;
+   deferGoalSubsumption      = false;
+   checkpointBase            = false;
+   checkpointSequence        = 0;
+   checkpointClock           = 0;
+   centroidsDirty            = false;
+   memoryEstimate            = 0;
+   deletedNeurons.clear();
 }
 
 
@@ -349,6 +525,47 @@ void Mona::clearVars()
 Mona::~Mona()
 {
    clear();
+   for (int i = 0; i < (int)driveWorkers.size(); i++)
+   {
+      delete driveWorkers[i];
+   }
+   driveWorkers.clear();
+   for (int i = 0; i < (int)enableWorkers.size(); i++)
+   {
+      delete enableWorkers[i];
+   }
+   enableWorkers.clear();
+   if (learningTask != NULL)
+   {
+      delete learningTask;
+      learningTask = NULL;
+   }
+   if (threadPool != NULL)
+   {
+      delete threadPool;
+      threadPool = NULL;
+   }
+   stopEventTrace();
+   setMetricsFile(NULL, 0);
+   setLatencyMetrics(false);
+}
+
+
+// Get thread pool having at least the given number of threads.
+ThreadPool *
+Mona::getThreadPool(int numThreads)
+{
+   if ((threadPool != NULL) && (threadPool->size() < numThreads))
+   {
+      delete threadPool;
+      threadPool = NULL;
+   }
+   if (threadPool == NULL)
+   {
+      threadPool = new ThreadPool(numThreads);
+      assert(threadPool != NULL);
+   }
+   return(threadPool);
 }
 
 
@@ -366,6 +583,10 @@ void
 Mona::setNeed(int index, NEED value)
 {
    assert(value >= 0.0 && value <= 1.0);
+   if (recordFile != NULL)
+   {
+      recordInput(NEED_RECORD, index, 0, value);
+   }
    homeostats[index]->setNeed(value);
 }
 
@@ -385,6 +606,10 @@ Mona::inflateNeed(int index)
    list<Enabling *>::iterator      enablingItr;
    list<LearningEvent *>::iterator learningEventItr;
 
+   if (recordFile != NULL)
+   {
+      recordInput(INFLATE_NEED_RECORD, index);
+   }
    currentNeed = homeostats[index]->getNeed();
    deltaNeed   = 1.0 - currentNeed;
    homeostats[index]->setNeed(currentNeed + deltaNeed);
@@ -424,6 +649,10 @@ void
 Mona::setPeriodicNeed(int index, int frequency, NEED periodicNeed)
 {
    assert(periodicNeed >= 0.0 && periodicNeed <= 1.0);
+   if (recordFile != NULL)
+   {
+      recordInput(PERIODIC_NEED_RECORD, index, frequency, periodicNeed);
+   }
    homeostats[index]->setPeriodicNeed(frequency, periodicNeed);
 }
 
@@ -432,6 +661,10 @@ Mona::setPeriodicNeed(int index, int frequency, NEED periodicNeed)
 void
 Mona::clearPeriodicNeed(int index)
 {
+   if (recordFile != NULL)
+   {
+      recordInput(CLEAR_PERIODIC_NEED_RECORD, index);
+   }
    homeostats[index]->clearPeriodicNeed();
 }
 
@@ -449,6 +682,10 @@ int Mona::addGoal(int needIndex, vector<SENSOR>& sensors,
                   SENSOR_MODE sensorMode, RESPONSE response, NEED goalValue)
 {
    assert(needIndex >= 0 && needIndex < (int)homeostats.size());
+   if (recordFile != NULL)
+   {
+      recordGoal(needIndex, sensors, sensorMode, response, goalValue);
+   }
    return(homeostats[needIndex]->addGoal(sensors, sensorMode, response, goalValue));
 }
 
@@ -458,6 +695,10 @@ int Mona::addGoal(int needIndex, vector<SENSOR>& sensors,
                   SENSOR_MODE sensorMode, NEED goalValue)
 {
    assert(needIndex >= 0 && needIndex < (int)homeostats.size());
+   if (recordFile != NULL)
+   {
+      recordGoal(needIndex, sensors, sensorMode, NULL_RESPONSE, goalValue);
+   }
    return(homeostats[needIndex]->addGoal(sensors, sensorMode, goalValue));
 }
 
@@ -481,6 +722,27 @@ int Mona::findGoal(int needIndex, vector<SENSOR>& sensors,
 }
 
 
+// Check goal parameters.
+bool Mona::isGoalValid(int needIndex, SENSOR_MODE sensorMode, RESPONSE response)
+{
+   int numModes;
+
+   numModes = (int)sensorModes.size();
+   if (numModes == 0)
+   {
+      numModes = 1;
+   }
+   if ((needIndex < 0) || (needIndex >= numNeeds) ||
+       (sensorMode < 0) || (sensorMode >= numModes) ||
+       (response < 0) ||
+       ((response >= numResponses) && (response != NULL_RESPONSE)))
+   {
+      return(false);
+   }
+   return(true);
+}
+
+
 // Get number of goals for need.
 int Mona::getNumGoals(int needIndex)
 {
@@ -512,6 +774,10 @@ bool Mona::isGoalEnabled(int needIndex, int goalIndex)
 bool Mona::enableGoal(int needIndex, int goalIndex)
 {
    assert(needIndex >= 0 && needIndex < (int)homeostats.size());
+   if (recordFile != NULL)
+   {
+      recordInput(ENABLE_GOAL_RECORD, needIndex, goalIndex);
+   }
    return(homeostats[needIndex]->enableGoal(goalIndex));
 }
 
@@ -520,6 +786,10 @@ bool Mona::enableGoal(int needIndex, int goalIndex)
 bool Mona::disableGoal(int needIndex, int goalIndex)
 {
    assert(needIndex >= 0 && needIndex < (int)homeostats.size());
+   if (recordFile != NULL)
+   {
+      recordInput(DISABLE_GOAL_RECORD, needIndex, goalIndex);
+   }
    return(homeostats[needIndex]->disableGoal(goalIndex));
 }
 
@@ -528,6 +798,10 @@ bool Mona::disableGoal(int needIndex, int goalIndex)
 bool Mona::removeGoal(int needIndex, int goalIndex)
 {
    assert(needIndex >= 0 && needIndex < (int)homeostats.size());
+   if (recordFile != NULL)
+   {
+      recordInput(REMOVE_GOAL_RECORD, needIndex, goalIndex);
+   }
    return(homeostats[needIndex]->removeGoal(goalIndex));
 }
 
@@ -538,7 +812,20 @@ Mona::Neuron::init(Mona *mona)
 {
    clear();
    this->mona = mona;
-   goals.init(mona->numNeeds, mona);
+   goals.init(mona->numNeeds, mona, this);
+}
+
+
+// Clear notifications.
+void
+Mona::Neuron::clearNotify()
+{
+   for (int i = 0; i < (int)notifyList.size(); i++)
+   {
+      delete notifyList[i];
+      mona->memoryEstimate -= notifyMemoryEstimate();
+   }
+   notifyList.clear();
 }
 
 
@@ -552,15 +839,13 @@ Mona::Neuron::clear()
    goals.clear();
    motive      = 0.0;
    motiveValid = false;
-   motiveWork.clear();
-   motiveWorkValid = false;
    driveWeights.clear();
+   driveIndex = -1;
+   snapshotIndex = -1;
+   dirty         = true;
+   goalSubsumptionDeferred = false;
    instinct = false;
-   for (int i = 0; i < (int)notifyList.size(); i++)
-   {
-      delete notifyList[i];
-   }
-   notifyList.clear();
+   clearNotify();
 #ifdef MONA_TRACKING
    tracker.fire   = false;
    tracker.enable = false;
@@ -610,6 +895,7 @@ void Mona::Neuron::load(FILE *fp)
    {
       notify = new struct Notify;
       assert(notify != NULL);
+      mona->memoryEstimate += notifyMemoryEstimate();
       notify->mediator = (Mediator *)new ID;
       assert(notify->mediator != NULL);
       FREAD_LONG_LONG((ID *)notify->mediator, fp);
@@ -657,13 +943,8 @@ Mona::newReceptor(vector<SENSOR>& centroid, SENSOR_MODE sensorMode)
    r->id = idDispenser;
    idDispenser++;
    r->creationTime = eventClock;
-   vector<SENSOR> *sensors = new vector<SENSOR>();
-   assert(sensors != NULL);
-   for (int i = 0; i < (int)r->centroid.size(); i++)
-   {
-      sensors->push_back(r->centroid[i]);
-   }
-   sensorCentroids[sensorMode]->insert((void *)sensors, (void *)r);
+   sensorCentroids[sensorMode]->insert(newCentroidPattern(r->centroid, sensorMode), (void *)r);
+   centroidsDirty = true;
    receptors.push_back(r);
    return(r);
 }
@@ -683,12 +964,14 @@ Mona::Receptor::Receptor(vector<SENSOR>& centroid,
    init(mona);
    type   = RECEPTOR;
    motive = 0.0;
+   mona->memoryEstimate += mona->neuronMemoryEstimate(this);
 }
 
 
 // Receptor destructor.
 Mona::Receptor::~Receptor()
 {
+   mona->memoryEstimate -= mona->neuronMemoryEstimate(this);
    subSensorModes.clear();
    superSensorModes.clear();
    clear();
@@ -854,12 +1137,14 @@ Mona::Motor::Motor(RESPONSE response, Mona *mona)
    init(mona);
    type           = MOTOR;
    this->response = response;
+   mona->memoryEstimate += mona->neuronMemoryEstimate(this);
 }
 
 
 // Motor destructor.
 Mona::Motor::~Motor()
 {
+   mona->memoryEstimate -= mona->neuronMemoryEstimate(this);
    clear();
 }
 
@@ -960,8 +1245,14 @@ Mona::Mediator::Mediator(ENABLEMENT enablement, Mona *mona)
    effectiveEnablementValid = false;
    utilityWeight            = 0.0;
    updateUtility(0.0);
-   cause      = response = effect = NULL;
-   causeBegin = 0;
+   goalSubsumed      = false;
+   goalSubsumedValid = false;
+   cause             = response = effect = NULL;
+   causeBegin        = 0;
+   effectNotified    = false;
+   effectStrength    = 0.0;
+   enableOrder       = -1;
+   mona->memoryEstimate += mona->neuronMemoryEstimate(this);
 }
 
 
@@ -972,6 +1263,7 @@ Mona::Mediator::~Mediator()
 
    vector<struct Notify *>::iterator notifyItr;
 
+   mona->memoryEstimate -= mona->neuronMemoryEstimate(this);
    if (cause != NULL)
    {
       for (notifyItr = cause->notifyList.begin();
@@ -982,6 +1274,7 @@ Mona::Mediator::~Mediator()
          {
             cause->notifyList.erase(notifyItr);
             delete notify;
+            mona->memoryEstimate -= notifyMemoryEstimate();
             break;
          }
       }
@@ -997,6 +1290,7 @@ Mona::Mediator::~Mediator()
          {
             response->notifyList.erase(notifyItr);
             delete notify;
+            mona->memoryEstimate -= notifyMemoryEstimate();
             break;
          }
       }
@@ -1012,6 +1306,7 @@ Mona::Mediator::~Mediator()
          {
             effect->notifyList.erase(notifyItr);
             delete notify;
+            mona->memoryEstimate -= notifyMemoryEstimate();
             break;
          }
       }
@@ -1030,6 +1325,8 @@ Mona::Mediator::updateUtility(WEIGHT updateWeight)
 {
    WEIGHT w;
 
+   dirty = true;
+
    // Check for floating point overflow.
    w = utilityWeight + updateWeight + mona->UTILITY_ASYMPTOTE;
    if (w > (utilityWeight + updateWeight))
@@ -1069,9 +1366,16 @@ Mona::Mediator::getEffectiveUtility()
 void
 Mona::Mediator::addEvent(EVENT_TYPE type, Neuron *neuron)
 {
-   int           i, j, k;
-   struct Notify *notify;
-   Mediator      *mediator;
+   setEvent(type, neuron);
+   addNotify(type, neuron);
+}
+
+
+// Set mediator event without notification from event neuron.
+void
+Mona::Mediator::setEvent(EVENT_TYPE type, Neuron *neuron)
+{
+   Mediator *mediator;
 
    switch (type)
    {
@@ -1091,6 +1395,7 @@ Mona::Mediator::addEvent(EVENT_TYPE type, Neuron *neuron)
       break;
       assert(false);
    }
+   goalSubsumedValid = false;
    if (neuron->type == MEDIATOR)
    {
       mediator = (Mediator *)neuron;
@@ -1100,11 +1405,23 @@ Mona::Mediator::addEvent(EVENT_TYPE type, Neuron *neuron)
          assert(level <= mona->MAX_MEDIATOR_LEVEL);
       }
    }
+}
+
+
+// Add notification of event neuron firing.
+void
+Mona::Mediator::addNotify(EVENT_TYPE type, Neuron *neuron)
+{
+   int           i, j, k;
+   struct Notify *notify;
+
    notify = new struct Notify;
    assert(notify != NULL);
+   mona->memoryEstimate += notifyMemoryEstimate();
    notify->mediator  = this;
    notify->eventType = type;
    neuron->notifyList.push_back(notify);
+   neuron->dirty = true;
 
    // Sort by type: effect, response, cause.
    for (i = 0, j = (int)neuron->notifyList.size(); i < j; i++)
@@ -1179,6 +1496,7 @@ void Mona::Mediator::load(FILE *fp)
 
    clear();
    ((Neuron *)this)->load(fp);
+   goalSubsumedValid = false;
    FREAD_INT(&level, fp);
    FREAD_DOUBLE(&baseEnablement, fp);
    FREAD_DOUBLE(&utility, fp);
@@ -1533,12 +1851,17 @@ void
 Mona::deleteNeuron(Neuron *neuron)
 {
    int           i, j;
+   ID            id;
    struct Notify *notify;
    LearningEvent *learningEvent;
+   Mediator      *mediator;
 
    list<LearningEvent *>::iterator learningEventItr;
    Receptor *receptor, *refReceptor;
 
+   // Commit background learning.
+   finishLearning();
+
    // Delete parents.
    while (neuron->notifyList.size() > 0)
    {
@@ -1574,7 +1897,8 @@ Mona::deleteNeuron(Neuron *neuron)
       }
    }
 
-   // Delete neuron.
+   // Delete neuron, noting changed neighbors for checkpoints.
+   id = neuron->id;
    switch (neuron->type)
    {
    case RECEPTOR:
@@ -1589,7 +1913,8 @@ Mona::deleteNeuron(Neuron *neuron)
       }
       for (i = 0; i < (int)receptor->subSensorModes.size(); i++)
       {
-         refReceptor = receptor->subSensorModes[i];
+         refReceptor        = receptor->subSensorModes[i];
+         refReceptor->dirty = true;
          for (j = 0; j < (int)refReceptor->superSensorModes.size(); j++)
          {
             if (refReceptor->superSensorModes[j] == receptor)
@@ -1601,7 +1926,8 @@ Mona::deleteNeuron(Neuron *neuron)
       }
       for (i = 0; i < (int)receptor->superSensorModes.size(); i++)
       {
-         refReceptor = receptor->superSensorModes[i];
+         refReceptor        = receptor->superSensorModes[i];
+         refReceptor->dirty = true;
          for (j = 0; j < (int)refReceptor->subSensorModes.size(); j++)
          {
             if (refReceptor->subSensorModes[j] == receptor)
@@ -1617,7 +1943,17 @@ Mona::deleteNeuron(Neuron *neuron)
       }
       if ((int)sensorCentroids.size() > 0)
       {
-         sensorCentroids[receptor->sensorMode]->remove((void *)&(receptor->centroid));
+         if (sensorModes[receptor->sensorMode]->quantization != SensorMode::NO_QUANTIZATION)
+         {
+            SensorCodes codes;
+            sensorModes[receptor->sensorMode]->quantize(receptor->centroid, codes);
+            sensorCentroids[receptor->sensorMode]->remove((void *)&codes);
+         }
+         else
+         {
+            sensorCentroids[receptor->sensorMode]->remove((void *)&(receptor->centroid));
+         }
+         centroidsDirty = true;
       }
       delete receptor;
       break;
@@ -1639,10 +1975,25 @@ Mona::deleteNeuron(Neuron *neuron)
       break;
 
    case MEDIATOR:
-      mediators.remove((Mediator *)neuron);
-      delete (Mediator *)neuron;
+      mediator = (Mediator *)neuron;
+      traceEvent(MEDIATOR_DELETE_EVENT, mediator->level, id, mediator->getEnablement());
+      if (mediator->cause != NULL)
+      {
+         mediator->cause->dirty = true;
+      }
+      if (mediator->response != NULL)
+      {
+         mediator->response->dirty = true;
+      }
+      if (mediator->effect != NULL)
+      {
+         mediator->effect->dirty = true;
+      }
+      mediators.remove(mediator);
+      delete mediator;
       break;
    }
+   deletedNeurons.push_back(id);
 }
 
 
@@ -1737,6 +2088,203 @@ Mona::getBestMediator(int minLevel)
 }
 
 
+// Memory category names.
+static const char *MemoryCategoryNames[Mona::NUM_MEMORY_CATEGORIES] =
+{
+   "receptors",
+   "centroids",
+   "motors",
+   "mediators",
+   "enablings",
+   "learning_events",
+   "rdtree"
+};
+
+// Estimated container node overheads: list links and tree links.
+static const size_t LIST_NODE_BYTES = 2 * sizeof(void *);
+static const size_t MAP_NODE_BYTES  = 4 * sizeof(void *);
+
+// Memory of neuron members common to all types.
+static size_t
+neuronMemory(Mona::Neuron *neuron)
+{
+   size_t bytes;
+
+   bytes  = neuron->goals.values.values.capacity() * sizeof(double);
+   bytes += neuron->driveWeights.size() *
+            (MAP_NODE_BYTES + sizeof(pair<Mona::Neuron * const, double>));
+   bytes += neuron->notifyList.capacity() * sizeof(struct Mona::Notify *);
+   bytes += neuron->notifyList.size() * sizeof(struct Mona::Notify);
+   return(bytes);
+}
+
+
+// Memory of enabling set.
+static size_t
+enablingMemory(Mona::EnablingSet& enablingSet)
+{
+   size_t bytes;
+
+   list<Mona::Enabling *>::iterator enablingItr;
+
+   bytes = 0;
+   for (enablingItr = enablingSet.enablings.begin();
+        enablingItr != enablingSet.enablings.end(); enablingItr++)
+   {
+      bytes += LIST_NODE_BYTES + sizeof(Mona::Enabling *) + sizeof(Mona::Enabling) +
+               ((*enablingItr)->needs.values.capacity() * sizeof(double));
+   }
+   return(bytes);
+}
+
+
+// Running estimate of a neuron's memory: the object, its slot
+// in the network, its goal values, and a receptor's centroid and
+// its copy in the centroid tree.
+unsigned long long
+Mona::neuronMemoryEstimate(Neuron *neuron)
+{
+   unsigned long long bytes;
+
+   bytes = numNeeds * sizeof(double);
+   switch (neuron->type)
+   {
+   case RECEPTOR:
+      bytes += sizeof(Receptor) + sizeof(Receptor *) + sizeof(RDtree::RDnode) +
+               sizeof(vector<SENSOR>) + 2 * ((Receptor *)neuron)->centroid.size() * sizeof(SENSOR);
+      break;
+
+   case MOTOR:
+      bytes += sizeof(Motor) + sizeof(Motor *);
+      break;
+
+   case MEDIATOR:
+      bytes += LIST_NODE_BYTES + sizeof(Mediator *) + sizeof(Mediator);
+      break;
+   }
+   return(bytes);
+}
+
+
+// Running estimate of a notification's memory, with the
+// drive weights between the mediator and its event neuron.
+unsigned long long
+Mona::notifyMemoryEstimate()
+{
+   return(sizeof(struct Notify) + sizeof(struct Notify *) +
+          2 * (MAP_NODE_BYTES + sizeof(pair<Neuron * const, double>)));
+}
+
+
+// Estimated network memory usage in bytes.
+unsigned long long
+Mona::memoryUsage()
+{
+   vector<unsigned long long> categories;
+
+   return(memoryUsage(categories));
+}
+
+
+// Estimated network memory usage in bytes, also by category.
+unsigned long long
+Mona::memoryUsage(vector<unsigned long long>& categories)
+{
+   int                i, j;
+   SensorMode         *sensorMode;
+   Receptor           *receptor;
+   Motor              *motor;
+   Mediator           *mediator;
+   unsigned long long total;
+
+   list<Mediator *>::iterator      mediatorItr;
+   list<LearningEvent *>::iterator learningEventItr;
+
+   // Commit background learning, which holds the learning events.
+   finishLearning();
+
+   categories.assign(NUM_MEMORY_CATEGORIES, 0);
+   categories[RECEPTOR_MEMORY] = receptors.capacity() * sizeof(Receptor *);
+   categories[RDTREE_MEMORY]   = sensorCentroids.capacity() * sizeof(RDtree *) +
+                                 sensorCentroids.size() * sizeof(RDtree);
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      receptor = receptors[i];
+      categories[RECEPTOR_MEMORY] += sizeof(Receptor) + neuronMemory(receptor) +
+                                     (receptor->subSensorModes.capacity() +
+                                      receptor->superSensorModes.capacity()) * sizeof(Receptor *);
+      categories[CENTROID_MEMORY] += receptor->centroid.capacity() * sizeof(SENSOR);
+
+      // Each receptor's tree node holds a copy of its centroid,
+      // or codes of its unmasked sensors for a quantized mode.
+      sensorMode = sensorModes[receptor->sensorMode];
+      if (sensorMode->quantization != SensorMode::NO_QUANTIZATION)
+      {
+         categories[RDTREE_MEMORY] += sizeof(RDtree::RDnode) + sizeof(SensorCodes) +
+                                      sensorMode->indices.size() * (sensorMode->quantization / 8);
+      }
+      else
+      {
+         categories[RDTREE_MEMORY] += sizeof(RDtree::RDnode) + sizeof(vector<SENSOR>) +
+                                      receptor->centroid.size() * sizeof(SENSOR);
+      }
+   }
+   categories[MOTOR_MEMORY] = motors.capacity() * sizeof(Motor *);
+   for (i = 0; i < (int)motors.size(); i++)
+   {
+      motor = motors[i];
+      categories[MOTOR_MEMORY] += sizeof(Motor) + neuronMemory(motor);
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      mediator = *mediatorItr;
+      categories[MEDIATOR_MEMORY] += LIST_NODE_BYTES + sizeof(Mediator *) +
+                                     sizeof(Mediator) + neuronMemory(mediator);
+      categories[ENABLING_MEMORY] += enablingMemory(mediator->responseEnablings) +
+                                     enablingMemory(mediator->effectEnablings);
+   }
+   categories[LEARNING_EVENT_MEMORY] = learningEvents.capacity() * sizeof(list<LearningEvent *>) +
+                                       generalizationEvents.capacity() * sizeof(GeneralizationEvent *);
+   for (i = 0; i < (int)learningEvents.size(); i++)
+   {
+      for (learningEventItr = learningEvents[i].begin();
+           learningEventItr != learningEvents[i].end(); learningEventItr++)
+      {
+         categories[LEARNING_EVENT_MEMORY] += LIST_NODE_BYTES + sizeof(LearningEvent *) +
+                                              sizeof(LearningEvent) +
+                                              (*learningEventItr)->needs.values.capacity() * sizeof(double);
+      }
+   }
+   for (i = 0; i < (int)generalizationEvents.size(); i++)
+   {
+      categories[LEARNING_EVENT_MEMORY] += sizeof(GeneralizationEvent) +
+                                           generalizationEvents[i]->needs.values.capacity() * sizeof(double);
+   }
+   for (j = 0, total = 0; j < NUM_MEMORY_CATEGORIES; j++)
+   {
+      total += categories[j];
+   }
+   return(total);
+}
+
+
+// Print memory usage.
+void
+Mona::printMemoryUsage(FILE *out)
+{
+   vector<unsigned long long> categories;
+   unsigned long long         total;
+
+   total = memoryUsage(categories);
+   fprintf(out, "Memory: %llu bytes\n", total);
+   for (int i = 0; i < NUM_MEMORY_CATEGORIES; i++)
+   {
+      fprintf(out, "  %s: %llu\n", MemoryCategoryNames[i], categories[i]);
+   }
+}
+
+
 // Load network from a file.
 bool
 Mona::load(char *filename)
@@ -1771,16 +2319,27 @@ Mona::load(FILE *fp)
    struct Notify              *notify;
    ID *id;
 
+   // Load into a new network instead of one sharing a configuration.
+   if (configuration != NULL)
+   {
+      return(false);
+   }
+
    // Check format compatibility.
    FREAD_INT(&format, fp);
-   if (format != FORMAT)
+   if ((format != FORMAT) && (format != LEGACY_FORMAT))
    {
       fprintf(stderr, "File format %d is incompatible with expected format %d\n", format, FORMAT);
       return(false);
    }
    char buf[40];
    FREAD_STRING(buf, 40, fp);
+   if (format == FORMAT)
+   {
+      return(loadSections(fp));
+   }
 
+   // Load legacy format.
    clear();
    FREAD_DOUBLE(&MIN_ENABLEMENT, fp);
    FREAD_DOUBLE(&INITIAL_ENABLEMENT, fp);
@@ -1840,6 +2399,7 @@ Mona::load(FILE *fp)
       sensorMode->load(fp);
       sensorModes.push_back(sensorMode);
    }
+   compileSensorModes();
    random.RAND_LOAD(fp);
    for (i = 0; i < (int)sensors.size(); i++)
    {
@@ -1987,6 +2547,7 @@ Mona::load(FILE *fp)
                    Mona::Receptor::loadClient);
       sensorCentroids.push_back(rdTree);
    }
+   resetCheckpoint(0);
    return(true);
 }
 
@@ -2051,128 +2612,2859 @@ Mona::save(char *filename)
 bool
 Mona::save(FILE *fp)
 {
-   int           i, j, k;
-   TIME          t;
-   double        d;
-   int           format;
-   LearningEvent *learningEvent;
+   int format;
 
-   list<LearningEvent *>::iterator learningEventItr;
-   Receptor *receptor;
-   Motor    *motor;
-   Mediator *mediator;
-   list<Mediator *>::iterator mediatorItr;
+   // Commit background learning.
+   finishLearning();
 
    // Save format, including searchable string.
    format = FORMAT;
    FWRITE_INT(&format, fp);
-   char buf[40];
+   char buf[40] = { 0 };
    sprintf(buf, "%s(#) Mona format %d", "@", FORMAT);
    FWRITE_STRING(buf, 40, fp);
 
-   FWRITE_DOUBLE(&MIN_ENABLEMENT, fp);
-   FWRITE_DOUBLE(&INITIAL_ENABLEMENT, fp);
-   FWRITE_DOUBLE(&DRIVE_ATTENUATION, fp);
-   FWRITE_DOUBLE(&FIRING_STRENGTH_LEARNING_DAMPER, fp);
-   FWRITE_DOUBLE(&LEARNING_DECREASE_VELOCITY, fp);
-   FWRITE_DOUBLE(&LEARNING_INCREASE_VELOCITY, fp);
-   FWRITE_DOUBLE(&RESPONSE_RANDOMNESS, fp);
-   FWRITE_DOUBLE(&UTILITY_ASYMPTOTE, fp);
-   FWRITE_INT(&DEFAULT_MAX_LEARNING_EFFECT_EVENT_INTERVAL, fp);
-   FWRITE_INT(&DEFAULT_NUM_EFFECT_EVENT_INTERVALS, fp);
-   FWRITE_INT(&MAX_MEDIATORS, fp);
-   FWRITE_INT(&MAX_MEDIATOR_LEVEL, fp);
-   FWRITE_INT(&MAX_RESPONSE_EQUIPPED_MEDIATOR_LEVEL, fp);
-   FWRITE_INT(&MIN_RESPONSE_UNEQUIPPED_MEDIATOR_LEVEL, fp);
-   FWRITE_FLOAT(&SENSOR_RESOLUTION, fp);
-   FWRITE_INT(&LEARN_MEDIATOR_GOAL_VALUE_MIN_LEVEL, fp);
-   FWRITE_BOOL(&LEARN_RECEPTOR_GOAL_VALUE, fp);
-   for (i = 0; i < (int)effectEventIntervals.size(); i++)
-   {
-      k = (int)effectEventIntervals[i].size();
-      FWRITE_INT(&k, fp);
-      for (j = 0; j < k; j++)
-      {
-         t = effectEventIntervals[i][j];
-         FWRITE_LONG_LONG(&t, fp);
-      }
-   }
-   for (i = 0; i < (int)effectEventIntervalWeights.size(); i++)
+   if (!saveSections(fp))
    {
-      for (j = 0; j < (int)effectEventIntervalWeights[i].size(); j++)
-      {
-         d = effectEventIntervalWeights[i][j];
-         FWRITE_DOUBLE(&d, fp);
-      }
+      return(false);
    }
-   for (i = 0; i < (int)maxLearningEffectEventIntervals.size(); i++)
-   {
-      t = maxLearningEffectEventIntervals[i];
-      FWRITE_LONG_LONG(&t, fp);
+   resetCheckpoint(0);
+   return(true);
+}
+
+
+// Save network asynchronously.
+Mona::SaveHandle *
+Mona::saveAsync(char *filename)
+{
+   SaveHandle *handle;
+
+   handle = new SaveHandle();
+   assert(handle != NULL);
+
+   // Commit background learning: the child has no learning thread.
+   finishLearning();
+
+#ifndef WIN32
+   int  fds[2];
+   bool ret;
+   char *tmpname;
+
+   if (((saveAsyncPreflight == NULL) || saveAsyncPreflight(this, saveAsyncClient)) &&
+       (pipe(fds) == 0))
+   {
+      handle->pid = (int)fork();
+      if (handle->pid == 0)
+      {
+         // Child: write to temporary file and rename.
+         close(fds[0]);
+         tmpname = new char[strlen(filename) + 5];
+         assert(tmpname != NULL);
+         sprintf(tmpname, "%s.tmp", filename);
+         ret = save(tmpname) && (rename(tmpname, filename) == 0);
+         if (!ret)
+         {
+            unlink(tmpname);
+         }
+         _exit(ret ? 0 : 1);
+      }
+      close(fds[1]);
+      if (handle->pid > 0)
+      {
+         handle->fd = fds[0];
+         return(handle);
+      }
+      close(fds[0]);
+      handle->pid = -1;
+   }
+#endif
+
+   // Save synchronously.
+   handle->succeeded = save(filename);
+   handle->complete  = true;
+   return(handle);
+}
+
+
+// Asynchronous save handle constructor.
+Mona::SaveHandle::SaveHandle()
+{
+   fd        = -1;
+   pid       = -1;
+   complete  = false;
+   succeeded = false;
+}
+
+
+// Asynchronous save handle destructor.
+Mona::SaveHandle::~SaveHandle()
+{
+   wait();
+}
+
+
+// Check for asynchronous save completion without blocking.
+// If the child cannot be waited for, as when SIGCHLD is ignored or
+// another reaper collected it, the save is complete and failed.
+bool
+Mona::SaveHandle::done()
+{
+#ifndef WIN32
+   int   status;
+   pid_t ret;
+
+   if (!complete)
+   {
+      ret = waitpid((pid_t)pid, &status, WNOHANG);
+      if ((ret == (pid_t)pid) || ((ret == -1) && (errno != EINTR)))
+      {
+         complete  = true;
+         succeeded = (ret == (pid_t)pid) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+         close(fd);
+         fd = -1;
+      }
+   }
+#endif
+   return(complete);
+}
+
+
+// Wait for asynchronous save completion.
+bool
+Mona::SaveHandle::wait()
+{
+#ifndef WIN32
+   int status;
+
+   if (!complete)
+   {
+      while (waitpid((pid_t)pid, &status, 0) == -1)
+      {
+         if (errno != EINTR)
+         {
+            status = -1;
+            break;
+         }
+      }
+      complete  = true;
+      succeeded = (status != -1) && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+      close(fd);
+      fd = -1;
+   }
+#endif
+   return(succeeded);
+}
+
+
+// Number neurons densely for snapshot references:
+// receptors, then motors, then mediators.
+void
+Mona::numberNeurons()
+{
+   int i, n;
+
+   list<Mediator *>::iterator mediatorItr;
+
+   n = 0;
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      receptors[i]->snapshotIndex = n++;
+   }
+   for (i = 0; i < (int)motors.size(); i++)
+   {
+      motors[i]->snapshotIndex = n++;
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      (*mediatorItr)->snapshotIndex = n++;
+   }
+}
+
+
+// Save network sections.
+bool
+Mona::saveSections(FILE *fp)
+{
+   int        i;
+   ByteBuffer buffer;
+
+   numberNeurons();
+
+   // Write sections.
+   for (i = PARAMETER_SECTION; i <= CENTROID_SECTION; i++)
+   {
+      buffer.clear();
+      switch (i)
+      {
+      case PARAMETER_SECTION:
+         saveParameterSection(buffer);
+         break;
+
+      case SENSOR_MODE_SECTION:
+         saveSensorModeSection(buffer);
+         break;
+
+      case STATE_SECTION:
+         saveStateSection(buffer);
+         break;
+
+      case NEURON_SECTION:
+         saveNeuronSection(buffer);
+         break;
+
+      case LEARNING_EVENT_SECTION:
+         saveLearningEventSection(buffer);
+         break;
+
+      case HOMEOSTAT_SECTION:
+         saveHomeostatSection(buffer);
+         break;
+
+      case CENTROID_SECTION:
+         saveCentroidSection(buffer);
+         break;
+      }
+      FWRITE_INT(&i, fp);
+      if (!buffer.write(fp))
+      {
+         return(false);
+      }
+   }
+   buffer.clear();
+   i = END_SECTION;
+   FWRITE_INT(&i, fp);
+   return(buffer.write(fp));
+}
+
+
+// Load network sections.
+bool
+Mona::loadSections(FILE *fp)
+{
+   int        tag, last;
+   bool       ret;
+   ByteBuffer buffer;
+
+   vector<Neuron *> neurons;
+
+   clear();
+   last = END_SECTION;
+   while (true)
+   {
+      if ((FREAD_INT(&tag, fp) != 1) || !buffer.read(fp))
+      {
+         fprintf(stderr, "Truncated snapshot\n");
+         return(false);
+      }
+      if (tag == END_SECTION)
+      {
+         break;
+      }
+
+      // Sections are in order; unknown sections are skipped.
+      if (tag <= last)
+      {
+         fprintf(stderr, "Snapshot section %d out of order\n", tag);
+         return(false);
+      }
+      if ((tag > CENTROID_SECTION) || (tag > last + 1))
+      {
+         if (tag <= CENTROID_SECTION)
+         {
+            fprintf(stderr, "Snapshot section %d missing\n", last + 1);
+            return(false);
+         }
+         continue;
+      }
+      last = tag;
+      switch (tag)
+      {
+      case PARAMETER_SECTION:
+         ret = loadParameterSection(buffer);
+         break;
+
+      case SENSOR_MODE_SECTION:
+         ret = loadSensorModeSection(buffer);
+         break;
+
+      case STATE_SECTION:
+         ret = loadStateSection(buffer);
+         break;
+
+      case NEURON_SECTION:
+         ret = loadNeuronSection(buffer, neurons);
+         break;
+
+      case LEARNING_EVENT_SECTION:
+         ret = loadLearningEventSection(buffer, neurons);
+         break;
+
+      case HOMEOSTAT_SECTION:
+         ret = loadHomeostatSection(buffer, neurons);
+         break;
+
+      case CENTROID_SECTION:
+         ret = loadCentroidSection(buffer, neurons);
+         break;
+
+      default:
+         ret = false;
+         break;
+      }
+      if (!ret || buffer.failed)
+      {
+         fprintf(stderr, "Invalid snapshot section %d\n", tag);
+         return(false);
+      }
+   }
+   if (last != CENTROID_SECTION)
+   {
+      fprintf(stderr, "Snapshot section %d missing\n", last + 1);
+      return(false);
+   }
+   resetCheckpoint(0);
+   return(true);
+}
+
+
+// Save parameters.
+void
+Mona::saveParameterSection(ByteBuffer& buffer)
+{
+   int i, j;
+
+   buffer.put(MIN_ENABLEMENT);
+   buffer.put(INITIAL_ENABLEMENT);
+   buffer.put(DRIVE_ATTENUATION);
+   buffer.put(FIRING_STRENGTH_LEARNING_DAMPER);
+   buffer.put(LEARNING_DECREASE_VELOCITY);
+   buffer.put(LEARNING_INCREASE_VELOCITY);
+   buffer.put(RESPONSE_RANDOMNESS);
+   buffer.put(UTILITY_ASYMPTOTE);
+   buffer.put(DEFAULT_MAX_LEARNING_EFFECT_EVENT_INTERVAL);
+   buffer.put(DEFAULT_NUM_EFFECT_EVENT_INTERVALS);
+   buffer.put(MAX_MEDIATORS);
+   buffer.put(MAX_MEDIATOR_LEVEL);
+   buffer.put(MAX_RESPONSE_EQUIPPED_MEDIATOR_LEVEL);
+   buffer.put(MIN_RESPONSE_UNEQUIPPED_MEDIATOR_LEVEL);
+   buffer.put(SENSOR_RESOLUTION);
+   buffer.put(LEARN_MEDIATOR_GOAL_VALUE_MIN_LEVEL);
+   buffer.put(LEARN_RECEPTOR_GOAL_VALUE);
+   for (i = 0; i <= MAX_MEDIATOR_LEVEL; i++)
+   {
+      buffer.put((int)effectEventIntervals[i].size());
+      for (j = 0; j < (int)effectEventIntervals[i].size(); j++)
+      {
+         buffer.put((TIME)effectEventIntervals[i][j]);
+         buffer.put((double)effectEventIntervalWeights[i][j]);
+      }
+      buffer.put((TIME)maxLearningEffectEventIntervals[i]);
+   }
+   buffer.put(numSensors);
+   buffer.put(numResponses);
+   buffer.put(numNeeds);
+   buffer.put(randomSeed);
+}
+
+
+// Load parameters and initialize network.
+// Parameters applied to an existing network must keep its dimensions.
+bool
+Mona::loadParameterSection(ByteBuffer& buffer, bool init)
+{
+   int  i, j, k, maxLevel;
+   int  sensors, responses, needs;
+   TIME t;
+
+   RANDOM seed;
+
+   maxLevel = MAX_MEDIATOR_LEVEL;
+
+   buffer.get(MIN_ENABLEMENT);
+   buffer.get(INITIAL_ENABLEMENT);
+   buffer.get(DRIVE_ATTENUATION);
+   buffer.get(FIRING_STRENGTH_LEARNING_DAMPER);
+   buffer.get(LEARNING_DECREASE_VELOCITY);
+   buffer.get(LEARNING_INCREASE_VELOCITY);
+   buffer.get(RESPONSE_RANDOMNESS);
+   buffer.get(UTILITY_ASYMPTOTE);
+   buffer.get(DEFAULT_MAX_LEARNING_EFFECT_EVENT_INTERVAL);
+   buffer.get(DEFAULT_NUM_EFFECT_EVENT_INTERVALS);
+   buffer.get(MAX_MEDIATORS);
+   buffer.get(MAX_MEDIATOR_LEVEL);
+   buffer.get(MAX_RESPONSE_EQUIPPED_MEDIATOR_LEVEL);
+   buffer.get(MIN_RESPONSE_UNEQUIPPED_MEDIATOR_LEVEL);
+   buffer.get(SENSOR_RESOLUTION);
+   buffer.get(LEARN_MEDIATOR_GOAL_VALUE_MIN_LEVEL);
+   buffer.get(LEARN_RECEPTOR_GOAL_VALUE);
+   if (buffer.failed || (MAX_MEDIATOR_LEVEL < 0) ||
+       (!init && (MAX_MEDIATOR_LEVEL != maxLevel)))
+   {
+      return(false);
+   }
+   effectEventIntervals.resize(MAX_MEDIATOR_LEVEL + 1);
+   effectEventIntervalWeights.resize(MAX_MEDIATOR_LEVEL + 1);
+   maxLearningEffectEventIntervals.resize(MAX_MEDIATOR_LEVEL + 1);
+   for (i = 0; i <= MAX_MEDIATOR_LEVEL; i++)
+   {
+      k = buffer.getCount(sizeof(TIME) + sizeof(double));
+      effectEventIntervals[i].resize(k);
+      effectEventIntervalWeights[i].resize(k);
+      for (j = 0; j < k; j++)
+      {
+         buffer.get(t);
+         effectEventIntervals[i][j] = t;
+         buffer.get(effectEventIntervalWeights[i][j]);
+      }
+      buffer.get(t);
+      maxLearningEffectEventIntervals[i] = t;
+   }
+   buffer.get(sensors);
+   buffer.get(responses);
+   buffer.get(needs);
+   buffer.get(seed);
+   if (buffer.failed || (sensors <= 0) || (responses < 0) || (needs <= 0) ||
+       ((MAX_RESPONSE_EQUIPPED_MEDIATOR_LEVEL + 1) <
+        MIN_RESPONSE_UNEQUIPPED_MEDIATOR_LEVEL))
+   {
+      return(false);
+   }
+   if (!init)
+   {
+      randomSeed = seed;
+      return((sensors == numSensors) && (responses == numResponses) &&
+             (needs == numNeeds));
+   }
+   initNet(sensors, responses, needs, seed);
+   return(true);
+}
+
+
+// Save sensor modes.
+void
+Mona::saveSensorModeSection(ByteBuffer& buffer)
+{
+   int        i, j;
+   SensorMode *sensorMode;
+
+   buffer.put((int)sensorModes.size());
+   for (i = 0; i < (int)sensorModes.size(); i++)
+   {
+      sensorMode = sensorModes[i];
+      buffer.put(sensorMode->mode);
+      buffer.put((int)sensorMode->mask.size());
+      for (j = 0; j < (int)sensorMode->mask.size(); j++)
+      {
+         buffer.put((unsigned char)(sensorMode->mask[j] ? 1 : 0));
+      }
+      buffer.put(sensorMode->resolution);
+      buffer.put((int)sensorMode->subsets.size());
+      for (j = 0; j < (int)sensorMode->subsets.size(); j++)
+      {
+         buffer.put(sensorMode->subsets[j]);
+      }
+      buffer.put((int)sensorMode->supersets.size());
+      for (j = 0; j < (int)sensorMode->supersets.size(); j++)
+      {
+         buffer.put(sensorMode->supersets[j]);
+      }
+   }
+
+   // Quantizations follow the modes, only if used.
+   for (i = 0; i < (int)sensorModes.size(); i++)
+   {
+      if (sensorModes[i]->quantization != SensorMode::NO_QUANTIZATION)
+      {
+         break;
+      }
+   }
+   if (i < (int)sensorModes.size())
+   {
+      for (i = 0; i < (int)sensorModes.size(); i++)
+      {
+         buffer.put(sensorModes[i]->quantization);
+         buffer.put(sensorModes[i]->quantizationScale);
+      }
+   }
+}
+
+
+// Load sensor modes.
+bool
+Mona::loadSensorModeSection(ByteBuffer& buffer)
+{
+   int        i, j, k;
+   SensorMode *sensorMode;
+
+   for (i = 0; i < (int)sensorModes.size(); i++)
+   {
+      delete sensorModes[i];
+   }
+   sensorModes.clear();
+   k = buffer.getCount();
+   for (i = 0; i < k; i++)
+   {
+      sensorMode = new SensorMode();
+      assert(sensorMode != NULL);
+      sensorModes.push_back(sensorMode);
+      buffer.get(sensorMode->mode);
+      sensorMode->mask.resize(buffer.getCount());
+      for (j = 0; j < (int)sensorMode->mask.size(); j++)
+      {
+         sensorMode->mask[j] = (buffer.get<unsigned char>() != 0);
+      }
+      buffer.get(sensorMode->resolution);
+      sensorMode->subsets.resize(buffer.getCount(sizeof(int)));
+      for (j = 0; j < (int)sensorMode->subsets.size(); j++)
+      {
+         buffer.get(sensorMode->subsets[j]);
+      }
+      sensorMode->supersets.resize(buffer.getCount(sizeof(int)));
+      for (j = 0; j < (int)sensorMode->supersets.size(); j++)
+      {
+         buffer.get(sensorMode->supersets[j]);
+      }
+   }
+   if (buffer.position < buffer.size())
+   {
+      for (i = 0; i < k; i++)
+      {
+         sensorMode = sensorModes[i];
+         buffer.get(sensorMode->quantization);
+         buffer.get(sensorMode->quantizationScale);
+         if (((sensorMode->quantization != SensorMode::NO_QUANTIZATION) &&
+              (sensorMode->quantization != SensorMode::QUANTIZE_8) &&
+              (sensorMode->quantization != SensorMode::QUANTIZE_16)) ||
+             (sensorMode->quantizationScale <= 0.0f))
+         {
+            return(false);
+         }
+      }
+   }
+   compileSensorModes();
+   return(!buffer.failed);
+}
+
+
+// Save random state, sensors, response and clocks.
+void
+Mona::saveStateSection(ByteBuffer& buffer)
+{
+   RANDOM key[2], counter[4];
+   int    index;
+
+   buffer.put(random.mt, sizeof(random.mt));
+   if (random.generator == Random::PHILOX)
+   {
+      random.RAND_GET_PHILOX(key, counter, index);
+      buffer.put((int)Random::PHILOX_MTI);
+      buffer.put(key, sizeof(key));
+      buffer.put(counter, sizeof(counter));
+      buffer.put(index);
+   }
+   else
+   {
+      buffer.put(random.mti);
+   }
+   buffer.put((int)sensors.size());
+   buffer.put(&sensors[0], sensors.size() * sizeof(SENSOR));
+   buffer.put(response);
+   buffer.put(eventClock);
+   buffer.put(idDispenser);
+}
+
+
+// Load random state, sensors, response and clocks.
+bool
+Mona::loadStateSection(ByteBuffer& buffer)
+{
+   RANDOM key[2], counter[4];
+   int    index;
+
+   buffer.get(random.mt, sizeof(random.mt));
+   buffer.get(random.mti);
+   if (random.mti == Random::PHILOX_MTI)
+   {
+      buffer.get(key, sizeof(key));
+      buffer.get(counter, sizeof(counter));
+      buffer.get(index);
+      random.mti = RAND_N + 1;
+      random.RAND_SET_PHILOX(key, counter, index);
+   }
+   else
+   {
+      random.generator = Random::MERSENNE_TWISTER;
+   }
+   if (buffer.getCount(sizeof(SENSOR)) != numSensors)
+   {
+      return(false);
+   }
+   buffer.get(&sensors[0], sensors.size() * sizeof(SENSOR));
+   buffer.get(response);
+   buffer.get(eventClock);
+   buffer.get(idDispenser);
+   return(!buffer.failed);
+}
+
+
+// Save neurons.
+void
+Mona::saveNeuronSection(ByteBuffer& buffer)
+{
+   vector<Neuron *> neurons;
+
+   neurons.insert(neurons.end(), receptors.begin(), receptors.end());
+   neurons.insert(neurons.end(), motors.begin(), motors.end());
+   neurons.insert(neurons.end(), mediators.begin(), mediators.end());
+   buffer.bytes.reserve(neurons.size() * (128 + numNeeds * sizeof(NEED)) +
+                        receptors.size() * numSensors * sizeof(SENSOR));
+   buffer.put((int)receptors.size());
+   buffer.put((int)motors.size());
+   buffer.put((int)mediators.size());
+   saveNeuronRecords(buffer, neurons, (int)receptors.size(), (int)motors.size());
+}
+
+
+// Save neuron records: receptors, then motors, then mediators.
+// Each field is an array over the records of a class; variable
+// length fields are a count array followed by the concatenated items.
+// References are snapshot indices.
+void
+Mona::saveNeuronRecords(ByteBuffer& buffer, vector<Neuron *>& records,
+                        int numReceptors, int numMotors)
+{
+   int           i, j, k, n;
+   Neuron        *neuron;
+   Receptor      *receptor;
+   Mediator      *mediator;
+   Enabling      *enabling;
+   struct Notify *notify;
+
+   vector<Enabling *>         enablings;
+   list<Enabling *>::iterator enablingItr;
+
+   n = (int)records.size();
+
+   // Neuron fields.
+   for (i = 0; i < n; i++)
+   {
+      buffer.put(records[i]->id);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.put(records[i]->creationTime);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.put(records[i]->firingStrength);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.put(records[i]->motive);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.put((unsigned char)(records[i]->instinct ? 1 : 0));
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.put(records[i]->goals.updateCount);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.put(records[i]->goals.values.size());
+   }
+   for (i = 0; i < n; i++)
+   {
+      neuron = records[i];
+      for (j = 0; j < neuron->goals.values.size(); j++)
+      {
+         buffer.put(neuron->goals.values.get(j));
+      }
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.put((int)records[i]->notifyList.size());
+   }
+   for (i = 0; i < n; i++)
+   {
+      neuron = records[i];
+      for (j = 0; j < (int)neuron->notifyList.size(); j++)
+      {
+         notify = neuron->notifyList[j];
+         buffer.put(notify->mediator->snapshotIndex);
+         buffer.put((int)notify->eventType);
+      }
+   }
+
+   // Receptor fields.
+   for (i = 0; i < numReceptors; i++)
+   {
+      buffer.put(((Receptor *)records[i])->sensorMode);
+   }
+   for (i = 0; i < numReceptors; i++)
+   {
+      buffer.put(&((Receptor *)records[i])->centroid[0], numSensors * sizeof(SENSOR));
+   }
+   for (i = 0; i < numReceptors; i++)
+   {
+      buffer.put((int)((Receptor *)records[i])->subSensorModes.size());
+      buffer.put((int)((Receptor *)records[i])->superSensorModes.size());
+   }
+   for (i = 0; i < numReceptors; i++)
+   {
+      receptor = (Receptor *)records[i];
+      for (j = 0; j < (int)receptor->subSensorModes.size(); j++)
+      {
+         buffer.put(receptor->subSensorModes[j]->snapshotIndex);
+      }
+      for (j = 0; j < (int)receptor->superSensorModes.size(); j++)
+      {
+         buffer.put(receptor->superSensorModes[j]->snapshotIndex);
+      }
+   }
+
+   // Motor fields.
+   for (i = numReceptors; i < numReceptors + numMotors; i++)
+   {
+      buffer.put(((Motor *)records[i])->response);
+   }
+
+   // Mediator fields.
+   for (i = numReceptors + numMotors; i < n; i++)
+   {
+      mediator = (Mediator *)records[i];
+      buffer.put(mediator->level);
+      buffer.put(mediator->baseEnablement);
+      buffer.put(mediator->utility);
+      buffer.put(mediator->utilityWeight);
+      buffer.put(mediator->causeBegin);
+      buffer.put(mediator->cause->snapshotIndex);
+      buffer.put(mediator->response != NULL ? mediator->response->snapshotIndex : -1);
+      buffer.put(mediator->effect->snapshotIndex);
+      buffer.put((int)mediator->responseEnablings.enablings.size());
+      buffer.put((int)mediator->effectEnablings.enablings.size());
+      for (k = 0; k < 2; k++)
+      {
+         list<Enabling *>& set = (k == 0 ? mediator->responseEnablings.enablings :
+                                  mediator->effectEnablings.enablings);
+         for (enablingItr = set.begin(); enablingItr != set.end(); enablingItr++)
+         {
+            enablings.push_back(*enablingItr);
+         }
+      }
+   }
+
+   // Enabling pool.
+   for (i = 0; i < (int)enablings.size(); i++)
+   {
+      enabling = enablings[i];
+      buffer.put(enabling->value);
+      buffer.put(enabling->motive);
+      buffer.put(enabling->age);
+      buffer.put(enabling->timerIndex);
+      buffer.put((unsigned char)(enabling->newInSet ? 1 : 0));
+      buffer.put(enabling->causeBegin);
+      buffer.put(enabling->needs.size());
+   }
+   for (i = 0; i < (int)enablings.size(); i++)
+   {
+      enabling = enablings[i];
+      for (j = 0; j < enabling->needs.size(); j++)
+      {
+         buffer.put(enabling->needs.get(j));
+      }
+   }
+}
+
+
+// Load neurons, returning the neurons in snapshot index order.
+bool
+Mona::loadNeuronSection(ByteBuffer& buffer, vector<Neuron *>& neurons)
+{
+   int      i, n, numReceptors, numMotors, numMediators;
+   Receptor *receptor;
+   Mediator *mediator;
+
+   numReceptors = buffer.getCount();
+   numMotors    = buffer.getCount();
+   numMediators = buffer.getCount();
+   if (buffer.failed || (numMotors != (int)motors.size()))
+   {
+      return(false);
+   }
+   n = numReceptors + numMotors + numMediators;
+   if ((size_t)n * (sizeof(ID) + sizeof(TIME)) > buffer.size() - buffer.position)
+   {
+      return(false);
+   }
+   neurons.resize(n);
+   for (i = 0; i < numReceptors; i++)
+   {
+      receptor = new Receptor(sensors, 0, this);
+      assert(receptor != NULL);
+      receptors.push_back(receptor);
+      neurons[i] = receptor;
+   }
+   for (i = 0; i < numMotors; i++)
+   {
+      neurons[numReceptors + i] = motors[i];
+   }
+   for (i = numReceptors + numMotors; i < n; i++)
+   {
+      mediator = new Mediator(0.0, this);
+      assert(mediator != NULL);
+      mediators.push_back(mediator);
+      neurons[i] = mediator;
+   }
+   for (i = 0; i < n; i++)
+   {
+      neurons[i]->snapshotIndex = i;
+   }
+   if (!loadNeuronRecords(buffer, neurons, numReceptors, numMotors, neurons))
+   {
+      return(false);
+   }
+   return(checkNotifications(neurons));
+}
+
+
+// Check that notifications match mediator event neurons exactly once.
+bool
+Mona::checkNotifications(vector<Neuron *>& neurons)
+{
+   int           i, j, k, k2, n, numMediators;
+   Neuron        *neuron;
+   Mediator      *mediator;
+   struct Notify *notify;
+
+   vector<int> counts;
+
+   n            = (int)neurons.size();
+   numMediators = (int)mediators.size();
+   counts.assign(numMediators * 3, 0);
+   for (i = 0; i < n; i++)
+   {
+      neuron = neurons[i];
+      for (j = 0; j < (int)neuron->notifyList.size(); j++)
+      {
+         notify   = neuron->notifyList[j];
+         mediator = notify->mediator;
+         switch (notify->eventType)
+         {
+         case CAUSE_EVENT:
+            k2 = (mediator->cause == neuron ? 1 : 0);
+            break;
+
+         case RESPONSE_EVENT:
+            k2 = (mediator->response == neuron ? 1 : 0);
+            break;
+
+         default:
+            k2 = (mediator->effect == neuron ? 1 : 0);
+            break;
+         }
+         k = (mediator->snapshotIndex - (n - numMediators)) * 3 +
+             (int)notify->eventType;
+         if ((k2 == 0) || (++counts[k] > 1))
+         {
+            return(false);
+         }
+      }
+   }
+   for (i = 0; i < numMediators; i++)
+   {
+      mediator = (Mediator *)neurons[n - numMediators + i];
+      if ((counts[i * 3 + CAUSE_EVENT] != 1) || (counts[i * 3 + EFFECT_EVENT] != 1) ||
+          (counts[i * 3 + RESPONSE_EVENT] != (mediator->response != NULL ? 1 : 0)))
+      {
+         return(false);
+      }
+   }
+   return(true);
+}
+
+
+// Load neuron records saved by saveNeuronRecords into existing neurons,
+// resolving references through the neurons in snapshot index order.
+bool
+Mona::loadNeuronRecords(ByteBuffer& buffer, vector<Neuron *>& records,
+                        int numReceptors, int numMotors,
+                        vector<Neuron *>& neurons)
+{
+   int           i, j, k, k2, n, m, r;
+   Neuron        *neuron;
+   Receptor      *receptor;
+   Mediator      *mediator;
+   Enabling      *enabling;
+   EnablingSet   *enablingSet;
+   struct Notify *notify;
+
+   vector<int>                counts;
+   vector<Enabling *>         enablings;
+   list<Enabling *>::iterator enablingItr;
+
+   n = (int)records.size();
+   m = (int)neurons.size();
+   r = (int)receptors.size();
+
+   // Neuron fields.
+   for (i = 0; i < n; i++)
+   {
+      buffer.get(records[i]->id);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.get(records[i]->creationTime);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.get(records[i]->firingStrength);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.get(records[i]->motive);
+   }
+   for (i = 0; i < n; i++)
+   {
+      records[i]->instinct = (buffer.get<unsigned char>() != 0);
+   }
+   for (i = 0; i < n; i++)
+   {
+      buffer.get(records[i]->goals.updateCount);
+   }
+   counts.resize(n);
+   for (i = 0; i < n; i++)
+   {
+      counts[i] = buffer.getCount(sizeof(NEED));
+   }
+   for (i = 0; i < n && !buffer.failed; i++)
+   {
+      neuron = records[i];
+      neuron->goals.values.alloc(counts[i]);
+      for (j = 0; j < counts[i]; j++)
+      {
+         neuron->goals.values.set(j, buffer.get<NEED>());
+      }
+   }
+   for (i = 0; i < n; i++)
+   {
+      counts[i] = buffer.getCount(2 * sizeof(int));
+   }
+   for (i = 0; i < n && !buffer.failed; i++)
+   {
+      neuron = records[i];
+      for (j = 0; j < (int)neuron->notifyList.size(); j++)
+      {
+         delete neuron->notifyList[j];
+         memoryEstimate -= notifyMemoryEstimate();
+      }
+      neuron->notifyList.resize(counts[i]);
+      for (j = 0; j < counts[i]; j++)
+      {
+         notify = new struct Notify;
+         assert(notify != NULL);
+         memoryEstimate += notifyMemoryEstimate();
+         neuron->notifyList[j] = notify;
+         k  = buffer.get<int>();
+         k2 = buffer.get<int>();
+         if ((k < r + (int)motors.size()) || (k >= m) ||
+             (k2 < CAUSE_EVENT) || (k2 > EFFECT_EVENT))
+         {
+            notify->mediator  = NULL;
+            notify->eventType = CAUSE_EVENT;
+            buffer.failed     = true;
+         }
+         else
+         {
+            notify->mediator  = (Mediator *)neurons[k];
+            notify->eventType = (EVENT_TYPE)k2;
+         }
+      }
+   }
+   if (buffer.failed)
+   {
+      return(false);
+   }
+
+   // Receptor fields.
+   for (i = 0; i < numReceptors; i++)
+   {
+      receptor = (Receptor *)records[i];
+      buffer.get(receptor->sensorMode);
+      if ((receptor->sensorMode < 0) ||
+          (receptor->sensorMode >= (int)sensorModes.size()))
+      {
+         return(false);
+      }
+   }
+   for (i = 0; i < numReceptors; i++)
+   {
+      receptor = (Receptor *)records[i];
+      receptor->centroid.resize(numSensors);
+      buffer.get(&receptor->centroid[0], numSensors * sizeof(SENSOR));
+   }
+   counts.resize(2 * numReceptors);
+   for (i = 0; i < 2 * numReceptors; i++)
+   {
+      counts[i] = buffer.getCount(sizeof(int));
+   }
+   for (i = 0; i < numReceptors && !buffer.failed; i++)
+   {
+      receptor = (Receptor *)records[i];
+      for (k = 0; k < 2; k++)
+      {
+         vector<Receptor *>& modes = (k == 0 ? receptor->subSensorModes :
+                                      receptor->superSensorModes);
+         modes.resize(counts[2 * i + k]);
+         for (j = 0; j < (int)modes.size(); j++)
+         {
+            k2 = buffer.get<int>();
+            if ((k2 < 0) || (k2 >= r))
+            {
+               return(false);
+            }
+            modes[j] = (Receptor *)neurons[k2];
+         }
+      }
+   }
+
+   // Motor fields.
+   for (i = numReceptors; i < numReceptors + numMotors; i++)
+   {
+      buffer.get(((Motor *)records[i])->response);
+      if ((((Motor *)records[i])->response < 0) ||
+          (((Motor *)records[i])->response >= numResponses))
+      {
+         return(false);
+      }
+   }
+
+   // Mediator fields.
+   for (i = numReceptors + numMotors; i < n && !buffer.failed; i++)
+   {
+      mediator = (Mediator *)records[i];
+      buffer.get(mediator->level);
+      if ((mediator->level < 0) || (mediator->level > MAX_MEDIATOR_LEVEL))
+      {
+         return(false);
+      }
+      buffer.get(mediator->baseEnablement);
+      buffer.get(mediator->utility);
+      buffer.get(mediator->utilityWeight);
+      buffer.get(mediator->causeBegin);
+      for (k = 0; k < 3; k++)
+      {
+         j = buffer.get<int>();
+         if ((j < -1) || (j >= m) || ((j == -1) && (k != 1)))
+         {
+            return(false);
+         }
+         neuron = (j == -1 ? NULL : neurons[j]);
+         switch (k)
+         {
+         case 0:
+            mediator->cause = neuron;
+            break;
+
+         case 1:
+            mediator->response = neuron;
+            break;
+
+         case 2:
+            mediator->effect = neuron;
+            break;
+         }
+      }
+      mediator->goalSubsumedValid = false;
+      for (k = 0; k < 2; k++)
+      {
+         enablingSet = (k == 0 ? &mediator->responseEnablings :
+                        &mediator->effectEnablings);
+         for (enablingItr = enablingSet->enablings.begin();
+              enablingItr != enablingSet->enablings.end(); enablingItr++)
+         {
+            delete *enablingItr;
+         }
+         enablingSet->enablings.clear();
+         j = buffer.getCount();
+         for ( ; j > 0; j--)
+         {
+            enabling = new Enabling();
+            assert(enabling != NULL);
+            enabling->set = enablingSet;
+            enablingSet->enablings.push_back(enabling);
+            enablings.push_back(enabling);
+         }
+      }
+   }
+
+   // Enabling pool.
+   counts.resize(enablings.size());
+   for (i = 0; i < (int)enablings.size() && !buffer.failed; i++)
+   {
+      enabling = enablings[i];
+      buffer.get(enabling->value);
+      buffer.get(enabling->motive);
+      buffer.get(enabling->age);
+      buffer.get(enabling->timerIndex);
+      enabling->newInSet = (buffer.get<unsigned char>() != 0);
+      buffer.get(enabling->causeBegin);
+      counts[i] = buffer.getCount(sizeof(NEED));
+   }
+   for (i = 0; i < (int)enablings.size() && !buffer.failed; i++)
+   {
+      enabling = enablings[i];
+      enabling->needs.alloc(counts[i]);
+      for (j = 0; j < counts[i]; j++)
+      {
+         enabling->needs.set(j, buffer.get<double>());
+      }
+   }
+   return(!buffer.failed);
+}
+
+
+// Save learning events.
+void
+Mona::saveLearningEventSection(ByteBuffer& buffer)
+{
+   int           i, j;
+   LearningEvent *learningEvent;
+
+   list<LearningEvent *>::iterator learningEventItr;
+
+   buffer.put((int)learningEvents.size());
+   for (i = 0; i < (int)learningEvents.size(); i++)
+   {
+      buffer.put((int)learningEvents[i].size());
+      for (learningEventItr = learningEvents[i].begin();
+           learningEventItr != learningEvents[i].end(); learningEventItr++)
+      {
+         learningEvent = *learningEventItr;
+         buffer.put(learningEvent->neuron->snapshotIndex);
+         buffer.put(learningEvent->firingStrength);
+         buffer.put(learningEvent->begin);
+         buffer.put(learningEvent->end);
+         buffer.put(learningEvent->probability);
+         buffer.put(learningEvent->needs.size());
+         for (j = 0; j < learningEvent->needs.size(); j++)
+         {
+            buffer.put(learningEvent->needs.get(j));
+         }
+      }
+   }
+}
+
+
+// Load learning events.
+bool
+Mona::loadLearningEventSection(ByteBuffer& buffer, vector<Neuron *>& neurons)
+{
+   int           i, j, k, n;
+   LearningEvent *learningEvent;
+
+   list<LearningEvent *>::iterator learningEventItr;
+
+   if (buffer.getCount() != (int)learningEvents.size())
+   {
+      return(false);
+   }
+   for (i = 0; i < (int)learningEvents.size(); i++)
+   {
+      for (learningEventItr = learningEvents[i].begin();
+           learningEventItr != learningEvents[i].end(); learningEventItr++)
+      {
+         delete *learningEventItr;
+      }
+      learningEvents[i].clear();
+      k = buffer.getCount(sizeof(int));
+      for ( ; k > 0 && !buffer.failed; k--)
+      {
+         n = buffer.get<int>();
+         if ((n < 0) || (n >= (int)neurons.size()))
+         {
+            return(false);
+         }
+         learningEvent = new LearningEvent();
+         assert(learningEvent != NULL);
+         learningEvents[i].push_back(learningEvent);
+         learningEvent->neuron = neurons[n];
+         buffer.get(learningEvent->firingStrength);
+         buffer.get(learningEvent->begin);
+         buffer.get(learningEvent->end);
+         buffer.get(learningEvent->probability);
+         n = buffer.getCount(sizeof(NEED));
+         learningEvent->needs.alloc(n);
+         for (j = 0; j < n; j++)
+         {
+            learningEvent->needs.set(j, buffer.get<double>());
+         }
+      }
+   }
+   return(!buffer.failed);
+}
+
+
+// Save homeostats.
+void
+Mona::saveHomeostatSection(ByteBuffer& buffer)
+{
+   int       i, j, k;
+   Homeostat *homeostat;
+
+   for (i = 0; i < numNeeds; i++)
+   {
+      homeostat = homeostats[i];
+      buffer.put(homeostat->need);
+      buffer.put(homeostat->needIndex);
+      buffer.put(homeostat->needDelta);
+      buffer.put(homeostat->periodicNeed);
+      buffer.put(homeostat->frequency);
+      buffer.put(homeostat->freqTimer);
+      buffer.put((int)homeostat->goals.size());
+      for (j = 0; j < (int)homeostat->goals.size(); j++)
+      {
+         Homeostat::Goal& goal = homeostat->goals[j];
+         buffer.put((int)goal.sensors.size());
+         for (k = 0; k < (int)goal.sensors.size(); k++)
+         {
+            buffer.put(goal.sensors[k]);
+         }
+         buffer.put(goal.sensorMode);
+         buffer.put(goal.receptor != NULL ? ((Receptor *)goal.receptor)->snapshotIndex : -1);
+         buffer.put(goal.response);
+         buffer.put(goal.goalValue);
+         buffer.put(goal.enabled);
+      }
+   }
+}
+
+
+// Load homeostats.
+bool
+Mona::loadHomeostatSection(ByteBuffer& buffer, vector<Neuron *>& neurons)
+{
+   int       i, j, k, n;
+   Homeostat *homeostat;
+
+   for (i = 0; i < numNeeds; i++)
+   {
+      homeostat = homeostats[i];
+      buffer.get(homeostat->need);
+      buffer.get(homeostat->needIndex);
+      buffer.get(homeostat->needDelta);
+      buffer.get(homeostat->periodicNeed);
+      buffer.get(homeostat->frequency);
+      buffer.get(homeostat->freqTimer);
+      homeostat->goals.resize(buffer.getCount());
+      for (j = 0; j < (int)homeostat->goals.size() && !buffer.failed; j++)
+      {
+         Homeostat::Goal& goal = homeostat->goals[j];
+         goal.sensors.resize(buffer.getCount(sizeof(SENSOR)));
+         for (k = 0; k < (int)goal.sensors.size(); k++)
+         {
+            buffer.get(goal.sensors[k]);
+         }
+         buffer.get(goal.sensorMode);
+         n = buffer.get<int>();
+         if ((n < -1) || (n >= (int)receptors.size()))
+         {
+            return(false);
+         }
+         goal.receptor = (n == -1 ? NULL : (void *)neurons[n]);
+         buffer.get(goal.response);
+         if (goal.response != NULL_RESPONSE)
+         {
+            goal.motor = findMotorByResponse(goal.response);
+         }
+         else
+         {
+            goal.motor = NULL;
+         }
+         buffer.get(goal.goalValue);
+         buffer.get(goal.enabled);
+      }
+      homeostat->invalidateGoalIndex();
+   }
+   return(!buffer.failed);
+}
+
+
+// Save sensor centroid trees.
+void
+Mona::saveCentroidSection(ByteBuffer& buffer)
+{
+   int  i, j;
+   bool quantized;
+
+   vector<int>    childCounts;
+   vector<void *> patterns;
+   vector<void *> clients;
+   vector<float>  distances;
+
+   buffer.put((int)sensorCentroids.size());
+   for (i = 0; i < (int)sensorCentroids.size(); i++)
+   {
+      sensorCentroids[i]->exportNodes(childCounts, patterns, clients, distances);
+      buffer.put((int)childCounts.size());
+      for (j = 0; j < (int)childCounts.size(); j++)
+      {
+         buffer.put(childCounts[j]);
+         buffer.put(distances[j]);
+         buffer.put(((Receptor *)clients[j])->snapshotIndex);
+      }
+      // Quantized patterns are saved as their receptors' centroids.
+      quantized = (sensorModes[i]->quantization != SensorMode::NO_QUANTIZATION);
+      for (j = 0; j < (int)patterns.size(); j++)
+      {
+         vector<SENSOR>& centroid = quantized ? ((Receptor *)clients[j])->centroid :
+                                    *(vector<SENSOR> *)patterns[j];
+         buffer.put(&centroid[0], numSensors * sizeof(SENSOR));
+      }
+   }
+}
+
+
+// Load sensor centroid trees.
+bool
+Mona::loadCentroidSection(ByteBuffer& buffer, vector<Neuron *>& neurons)
+{
+   int    i, j, k, m, n, sum;
+   RDtree *rdTree;
+
+   vector<int>    childCounts;
+   vector<void *> patterns;
+   vector<void *> clients;
+   vector<float>  distances;
+   vector<SENSOR> centroid(numSensors);
+
+   for (i = 0; i < (int)sensorCentroids.size(); i++)
+   {
+      delete sensorCentroids[i];
+   }
+   sensorCentroids.clear();
+   k = buffer.getCount();
+   if (k > (int)sensorModes.size())
+   {
+      return(false);
+   }
+   for (i = 0; i < k && !buffer.failed; i++)
+   {
+      rdTree = newCentroidTree(i);
+      sensorCentroids.push_back(rdTree);
+      n = buffer.getCount(2 * sizeof(int) + sizeof(float) +
+                          numSensors * sizeof(SENSOR));
+      if (n == 0)
+      {
+         continue;
+      }
+
+      // Child counts not exceeding the number of non-root nodes
+      // keep the preorder import within the arrays.
+      childCounts.resize(n);
+      distances.resize(n);
+      clients.resize(n);
+      patterns.resize(n);
+      for (j = 0, sum = 0; j < n; j++)
+      {
+         buffer.get(childCounts[j]);
+         buffer.get(distances[j]);
+         m = buffer.get<int>();
+         sum += childCounts[j];
+         if ((childCounts[j] < 0) || (sum >= n) ||
+             (m < 0) || (m >= (int)receptors.size()))
+         {
+            return(false);
+         }
+         clients[j] = (void *)neurons[m];
+      }
+      for (j = 0; j < n; j++)
+      {
+         buffer.get(&centroid[0], numSensors * sizeof(SENSOR));
+         patterns[j] = newCentroidPattern(centroid, i);
+      }
+      rdTree->importNodes(childCounts, patterns, clients, distances);
+   }
+   return(!buffer.failed);
+}
+
+
+// Save delta checkpoint to file.
+bool
+Mona::saveDelta(char *filename)
+{
+   FILE *fp;
+
+   if ((fp = FOPEN_WRITE(filename)) == NULL)
+   {
+      return(false);
+   }
+   bool ret = saveDelta(fp);
+   FCLOSE(fp);
+   return(ret);
+}
+
+
+// Save delta checkpoint.
+bool
+Mona::saveDelta(FILE *fp)
+{
+   int format;
+
+   // Commit background learning.
+   finishLearning();
+
+   if (!checkpointBase)
+   {
+      fprintf(stderr, "No checkpoint to save delta from\n");
+      return(false);
+   }
+
+   // Save format, including searchable string.
+   format = DELTA_FORMAT;
+   FWRITE_INT(&format, fp);
+   char buf[40] = { 0 };
+   sprintf(buf, "%s(#) Mona delta format %d", "@", FORMAT);
+   FWRITE_STRING(buf, 40, fp);
+
+   if (!saveDeltaSections(fp))
+   {
+      return(false);
+   }
+   resetCheckpoint(checkpointSequence + 1);
+   return(true);
+}
+
+
+// Load delta checkpoint from file.
+bool
+Mona::loadDelta(char *filename)
+{
+   FILE *fp;
+
+   if ((fp = FOPEN_READ(filename)) == NULL)
+   {
+      return(false);
+   }
+   bool ret = loadDelta(fp);
+   FCLOSE(fp);
+   return(ret);
+}
+
+
+// Sections of a delta, in order. The centroid section is optional.
+const int Mona::DELTA_SECTIONS[] =
+{
+   CHECKPOINT_SECTION,     PARAMETER_SECTION,      SENSOR_MODE_SECTION,
+   STATE_SECTION,          NEURON_DELTA_SECTION,   MOTIVE_SECTION,
+   LEARNING_EVENT_SECTION, HOMEOSTAT_SECTION,      CENTROID_SECTION,
+   END_SECTION
+};
+
+// Load delta checkpoint.
+// A delta that fails to apply after changing the network clears it.
+bool
+Mona::loadDelta(FILE *fp)
+{
+   int        i, tag, format;
+   ByteBuffer buffer;
+
+   vector<Neuron *> neurons;
+
+   // A delta may change the sensor modes and intervals.
+   if (configuration != NULL)
+   {
+      return(false);
+   }
+
+   // Check format compatibility.
+   FREAD_INT(&format, fp);
+   if (format != DELTA_FORMAT)
+   {
+      fprintf(stderr, "File format %d is incompatible with expected format %d\n", format, DELTA_FORMAT);
+      return(false);
+   }
+   char buf[40];
+   FREAD_STRING(buf, 40, fp);
+
+   // Commit background learning.
+   finishLearning();
+
+   if (!checkpointBase)
+   {
+      fprintf(stderr, "No checkpoint to apply delta to\n");
+      return(false);
+   }
+   i = 0;
+   while (true)
+   {
+      if ((FREAD_INT(&tag, fp) != 1) || !buffer.read(fp))
+      {
+         fprintf(stderr, "Truncated delta\n");
+         break;
+      }
+      if ((tag != DELTA_SECTIONS[i]) && (DELTA_SECTIONS[i] == CENTROID_SECTION))
+      {
+         i++;
+      }
+      if (tag != DELTA_SECTIONS[i])
+      {
+         fprintf(stderr, "Delta section %d missing\n", DELTA_SECTIONS[i]);
+         break;
+      }
+      i++;
+      if (tag == END_SECTION)
+      {
+         resetCheckpoint(checkpointSequence + 1);
+         return(true);
+      }
+      if (!loadDeltaSection(tag, buffer, neurons) || buffer.failed)
+      {
+         if (tag == CHECKPOINT_SECTION)
+         {
+            return(false);
+         }
+         fprintf(stderr, "Invalid delta section %d\n", tag);
+         break;
+      }
+   }
+   if (i > 1)
+   {
+      clear();
+   }
+   return(false);
+}
+
+
+// Fold a snapshot and its chain of deltas into a new snapshot.
+bool
+Mona::compactCheckpoints(char *snapshot, vector<char *>& deltas, char *output)
+{
+   if (!load(snapshot))
+   {
+      return(false);
+   }
+   for (int i = 0; i < (int)deltas.size(); i++)
+   {
+      if (!loadDelta(deltas[i]))
+      {
+         return(false);
+      }
+   }
+   return(save(output));
+}
+
+
+// Save delta sections.
+bool
+Mona::saveDeltaSections(FILE *fp)
+{
+   int        i, tag;
+   ByteBuffer buffer;
+
+   numberNeurons();
+   for (i = 0; DELTA_SECTIONS[i] != END_SECTION; i++)
+   {
+      tag = DELTA_SECTIONS[i];
+      buffer.clear();
+      switch (tag)
+      {
+      case CHECKPOINT_SECTION:
+         saveCheckpointSection(buffer);
+         break;
+
+      case PARAMETER_SECTION:
+         saveParameterSection(buffer);
+         break;
+
+      case SENSOR_MODE_SECTION:
+         saveSensorModeSection(buffer);
+         break;
+
+      case STATE_SECTION:
+         saveStateSection(buffer);
+         break;
+
+      case NEURON_DELTA_SECTION:
+         saveNeuronDeltaSection(buffer);
+         break;
+
+      case MOTIVE_SECTION:
+         saveMotiveSection(buffer);
+         break;
+
+      case LEARNING_EVENT_SECTION:
+         saveLearningEventSection(buffer);
+         break;
+
+      case HOMEOSTAT_SECTION:
+         saveHomeostatSection(buffer);
+         break;
+
+      case CENTROID_SECTION:
+         if (!centroidsDirty)
+         {
+            continue;
+         }
+         saveCentroidSection(buffer);
+         break;
+      }
+      FWRITE_INT(&tag, fp);
+      if (!buffer.write(fp))
+      {
+         return(false);
+      }
+   }
+   buffer.clear();
+   tag = END_SECTION;
+   FWRITE_INT(&tag, fp);
+   return(buffer.write(fp));
+}
+
+
+// Load delta section.
+bool
+Mona::loadDeltaSection(int tag, ByteBuffer& buffer, vector<Neuron *>& neurons)
+{
+   switch (tag)
+   {
+   case CHECKPOINT_SECTION:
+      return(loadCheckpointSection(buffer));
+
+   case PARAMETER_SECTION:
+      return(loadParameterSection(buffer, false));
+
+   case SENSOR_MODE_SECTION:
+      return(loadSensorModeSection(buffer));
+
+   case STATE_SECTION:
+      return(loadStateSection(buffer));
+
+   case NEURON_DELTA_SECTION:
+      return(loadNeuronDeltaSection(buffer, neurons));
+
+   case MOTIVE_SECTION:
+      return(loadMotiveSection(buffer, neurons));
+
+   case LEARNING_EVENT_SECTION:
+      return(loadLearningEventSection(buffer, neurons));
+
+   case HOMEOSTAT_SECTION:
+      return(loadHomeostatSection(buffer, neurons));
+
+   case CENTROID_SECTION:
+      return(loadCentroidSection(buffer, neurons));
+
+   default:
+      return(false);
+   }
+}
+
+
+// Save checkpoint sequence number and the clock of the previous checkpoint.
+void
+Mona::saveCheckpointSection(ByteBuffer& buffer)
+{
+   buffer.put(checkpointSequence + 1);
+   buffer.put(checkpointClock);
+}
+
+
+// Load checkpoint sequence, which must follow the network's checkpoint.
+bool
+Mona::loadCheckpointSection(ByteBuffer& buffer)
+{
+   int  sequence;
+   TIME clock;
+
+   buffer.get(sequence);
+   buffer.get(clock);
+   if (buffer.failed)
+   {
+      fprintf(stderr, "Invalid delta section %d\n", CHECKPOINT_SECTION);
+      return(false);
+   }
+   if ((sequence != checkpointSequence + 1) || (clock != checkpointClock) ||
+       (eventClock != checkpointClock))
+   {
+      fprintf(stderr, "Delta %d does not follow checkpoint %d\n",
+              sequence, checkpointSequence);
+      return(false);
+   }
+   return(true);
+}
+
+
+// Save neurons changed since the previous checkpoint:
+// the identifiers of deleted neurons, then the identifiers and
+// snapshot indices of changed receptors, motors and mediators,
+// the network dimensions, and the changed neuron records.
+void
+Mona::saveNeuronDeltaSection(ByteBuffer& buffer)
+{
+   int      i, numReceptors, numMotors;
+   Mediator *mediator;
+
+   vector<Neuron *>           records;
+   list<Mediator *>::iterator mediatorItr;
+
+   buffer.put((int)deletedNeurons.size());
+   for (i = 0; i < (int)deletedNeurons.size(); i++)
+   {
+      buffer.put(deletedNeurons[i]);
+   }
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      if (receptors[i]->dirty)
+      {
+         records.push_back(receptors[i]);
+      }
+   }
+   numReceptors = (int)records.size();
+   for (i = 0; i < (int)motors.size(); i++)
+   {
+      if (motors[i]->dirty)
+      {
+         records.push_back(motors[i]);
+      }
+   }
+   numMotors = (int)records.size() - numReceptors;
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      mediator = *mediatorItr;
+      if (mediator->dirty)
+      {
+         records.push_back(mediator);
+      }
+   }
+   buffer.put(numReceptors);
+   buffer.put(numMotors);
+   buffer.put((int)records.size() - numReceptors - numMotors);
+   for (i = 0; i < (int)records.size(); i++)
+   {
+      buffer.put(records[i]->id);
+      buffer.put(records[i]->snapshotIndex);
+   }
+   buffer.put((int)receptors.size());
+   buffer.put((int)motors.size());
+   buffer.put((int)mediators.size());
+   saveNeuronRecords(buffer, records, numReceptors, numMotors);
+}
+
+
+// Load changed neurons: delete neurons, add new ones,
+// and load changed neuron records.
+// Returns the neurons in snapshot index order.
+bool
+Mona::loadNeuronDeltaSection(ByteBuffer& buffer, vector<Neuron *>& neurons)
+{
+   int      i, n, numReceptors, numMotors, numMediators;
+   ID       id;
+   Neuron   *neuron;
+   Receptor *receptor;
+   Mediator *mediator;
+
+   map<ID, Neuron *>           neuronMap;
+   map<ID, Neuron *>::iterator neuronItr;
+   vector<Neuron *>            records;
+   vector<int>                 indices;
+   list<Mediator *>::iterator  mediatorItr;
+
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      neuronMap[receptors[i]->id] = receptors[i];
+   }
+   for (i = 0; i < (int)motors.size(); i++)
+   {
+      neuronMap[motors[i]->id] = motors[i];
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      neuronMap[(*mediatorItr)->id] = *mediatorItr;
+   }
+
+   // Delete neurons. Parents are deleted before their components;
+   // neurons added and deleted since the previous checkpoint are unknown.
+   n = buffer.getCount(sizeof(ID));
+   for (i = 0; i < n; i++)
+   {
+      buffer.get(id);
+      if ((neuronItr = neuronMap.find(id)) == neuronMap.end())
+      {
+         continue;
+      }
+      neuron = neuronItr->second;
+      if ((neuron->type == MOTOR) || (neuron->notifyList.size() > 0))
+      {
+         return(false);
+      }
+      neuronMap.erase(neuronItr);
+      deleteNeuron(neuron);
+   }
+
+   // Find changed neurons, adding new ones.
+   numReceptors = buffer.getCount(sizeof(ID) + sizeof(int));
+   numMotors    = buffer.getCount(sizeof(ID) + sizeof(int));
+   numMediators = buffer.getCount(sizeof(ID) + sizeof(int));
+   n            = numReceptors + numMotors + numMediators;
+   if (buffer.failed ||
+       ((size_t)n * (sizeof(ID) + sizeof(int)) > buffer.size() - buffer.position))
+   {
+      return(false);
+   }
+   records.resize(n);
+   indices.resize(n);
+   for (i = 0; i < n; i++)
+   {
+      buffer.get(id);
+      buffer.get(indices[i]);
+      if ((neuronItr = neuronMap.find(id)) != neuronMap.end())
+      {
+         neuron = neuronItr->second;
+         if ((i < numReceptors) ? (neuron->type != RECEPTOR) :
+             (i < numReceptors + numMotors) ? (neuron->type != MOTOR) :
+             (neuron->type != MEDIATOR))
+         {
+            return(false);
+         }
+      }
+      else if (i < numReceptors)
+      {
+         receptor = new Receptor(sensors, 0, this);
+         assert(receptor != NULL);
+         receptors.push_back(receptor);
+         neuron = receptor;
+      }
+      else if (i >= numReceptors + numMotors)
+      {
+         mediator = new Mediator(0.0, this);
+         assert(mediator != NULL);
+         mediators.push_back(mediator);
+         neuron = mediator;
+      }
+      else
+      {
+         return(false);
+      }
+      neuron->id = id;
+      records[i] = neuron;
+   }
+
+   // Number neurons, which must match the saved network.
+   if ((buffer.get<int>() != (int)receptors.size()) ||
+       (buffer.get<int>() != (int)motors.size()) ||
+       (buffer.get<int>() != (int)mediators.size()))
+   {
+      return(false);
+   }
+   numberNeurons();
+   neurons.clear();
+   neurons.insert(neurons.end(), receptors.begin(), receptors.end());
+   neurons.insert(neurons.end(), motors.begin(), motors.end());
+   neurons.insert(neurons.end(), mediators.begin(), mediators.end());
+   for (i = 0; i < n; i++)
+   {
+      if (records[i]->snapshotIndex != indices[i])
+      {
+         return(false);
+      }
+   }
+
+   // Load changed neuron records.
+   if (!loadNeuronRecords(buffer, records, numReceptors, numMotors, neurons))
+   {
+      return(false);
+   }
+   return(checkNotifications(neurons));
+}
+
+
+// Save motives of all neurons, which drive updates every cycle.
+void
+Mona::saveMotiveSection(ByteBuffer& buffer)
+{
+   int i;
+
+   list<Mediator *>::iterator mediatorItr;
+
+   buffer.put((int)(receptors.size() + motors.size() + mediators.size()));
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      buffer.put(receptors[i]->motive);
+   }
+   for (i = 0; i < (int)motors.size(); i++)
+   {
+      buffer.put(motors[i]->motive);
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      buffer.put((*mediatorItr)->motive);
+   }
+}
+
+
+// Load motives.
+bool
+Mona::loadMotiveSection(ByteBuffer& buffer, vector<Neuron *>& neurons)
+{
+   if (buffer.getCount(sizeof(MOTIVE)) != (int)neurons.size())
+   {
+      return(false);
+   }
+   for (int i = 0; i < (int)neurons.size(); i++)
+   {
+      buffer.get(neurons[i]->motive);
+   }
+   return(!buffer.failed);
+}
+
+
+// Begin checkpoint: changes are tracked from the current network.
+void
+Mona::resetCheckpoint(int sequence)
+{
+   int i;
+
+   list<Mediator *>::iterator mediatorItr;
+
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      receptors[i]->dirty = false;
+   }
+   for (i = 0; i < (int)motors.size(); i++)
+   {
+      motors[i]->dirty = false;
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      (*mediatorItr)->dirty = false;
+   }
+   deletedNeurons.clear();
+   centroidsDirty     = false;
+   checkpointSequence = sequence;
+   checkpointClock    = eventClock;
+   checkpointBase     = true;
+}
+
+
+// Clone network.
+Mona *
+Mona::clone(bool shareConfiguration)
+{
+   int       i, j;
+   Mona      *mona;
+   Homeostat *homeostat, *homeostatCopy;
+   RDtree    *rdTree;
+
+   vector<Neuron *>                neurons;
+   list<LearningEvent *>::iterator learningEventItr;
+   vector<int>                     childCounts;
+   vector<void *>                  patterns;
+   vector<void *>                  clients;
+   vector<float>                   distances;
+
+   // Complete background learning.
+   finishLearning();
+
+   if (shareConfiguration)
+   {
+      // Share the base sensor mode that sensing would add.
+      if ((configuration == NULL) && (sensorModes.size() == 0))
+      {
+         vector<bool> mask(numSensors, true);
+         addSensorMode(mask);
+      }
+      mona = new Mona((configuration != NULL) ? configuration : this);
+   }
+   else
+   {
+      mona = new Mona();
+   }
+   assert(mona != NULL);
+
+   // Copy parameters and run-time settings.
+   mona->MIN_ENABLEMENT                             = MIN_ENABLEMENT;
+   mona->INITIAL_ENABLEMENT                         = INITIAL_ENABLEMENT;
+   mona->DRIVE_ATTENUATION                          = DRIVE_ATTENUATION;
+   mona->FIRING_STRENGTH_LEARNING_DAMPER            = FIRING_STRENGTH_LEARNING_DAMPER;
+   mona->LEARNING_DECREASE_VELOCITY                 = LEARNING_DECREASE_VELOCITY;
+   mona->LEARNING_INCREASE_VELOCITY                 = LEARNING_INCREASE_VELOCITY;
+   mona->RESPONSE_RANDOMNESS                        = RESPONSE_RANDOMNESS;
+   mona->UTILITY_ASYMPTOTE                          = UTILITY_ASYMPTOTE;
+   mona->DEFAULT_MAX_LEARNING_EFFECT_EVENT_INTERVAL = DEFAULT_MAX_LEARNING_EFFECT_EVENT_INTERVAL;
+   mona->DEFAULT_NUM_EFFECT_EVENT_INTERVALS         = DEFAULT_NUM_EFFECT_EVENT_INTERVALS;
+   mona->MAX_MEDIATORS                          = MAX_MEDIATORS;
+   mona->MAX_MEDIATOR_LEVEL                     = MAX_MEDIATOR_LEVEL;
+   mona->MAX_RESPONSE_EQUIPPED_MEDIATOR_LEVEL   = MAX_RESPONSE_EQUIPPED_MEDIATOR_LEVEL;
+   mona->MIN_RESPONSE_UNEQUIPPED_MEDIATOR_LEVEL = MIN_RESPONSE_UNEQUIPPED_MEDIATOR_LEVEL;
+   mona->SENSOR_RESOLUTION                   = SENSOR_RESOLUTION;
+   mona->LEARN_MEDIATOR_GOAL_VALUE_MIN_LEVEL = LEARN_MEDIATOR_GOAL_VALUE_MIN_LEVEL;
+   mona->LEARN_RECEPTOR_GOAL_VALUE           = LEARN_RECEPTOR_GOAL_VALUE;
+   mona->DRIVE_MOTIVE_EPSILON = DRIVE_MOTIVE_EPSILON;
+   mona->MAX_DRIVE_EDGES      = MAX_DRIVE_EDGES;
+   mona->DRIVE_THREADS        = DRIVE_THREADS;
+   mona->ENABLE_THREADS       = ENABLE_THREADS;
+   mona->LEARN_ASYNC          = LEARN_ASYNC;
+   mona->MAX_MEMORY_BYTES     = MAX_MEMORY_BYTES;
+   mona->setLatencyMetrics(phaseLatencies != NULL);
+   if (mona->configuration == NULL)
+   {
+      mona->effectEventIntervals            = effectEventIntervals;
+      mona->effectEventIntervalWeights      = effectEventIntervalWeights;
+      mona->maxLearningEffectEventIntervals = maxLearningEffectEventIntervals;
+   }
+
+   // Initialize network.
+   mona->initNet(numSensors, numResponses, numNeeds, randomSeed);
+   mona->maxMotive = maxMotive;
+#ifdef MONA_TRACE
+   mona->traceSense   = traceSense;
+   mona->traceEnable  = traceEnable;
+   mona->traceLearn   = traceLearn;
+   mona->traceDrive   = traceDrive;
+   mona->traceRespond = traceRespond;
+#endif
+
+   // Copy or share sensor modes.
+   for (i = 0; i < (int)sensorModes.size(); i++)
+   {
+      if (mona->configuration == NULL)
+      {
+         mona->sensorModes.push_back(new SensorMode(*sensorModes[i]));
+         assert(mona->sensorModes[i] != NULL);
+      }
+      else
+      {
+         mona->sensorModes.push_back(mona->configuration->sensorModes[i]);
+      }
+   }
+   mona->compileSensorModes();
+
+   // Copy random state, sensors, response and clocks.
+   random.RAND_CLONE(mona->random);
+   mona->sensors                   = sensors;
+   mona->response                  = response;
+   mona->responsePotentials        = responsePotentials;
+   mona->responseOverride          = responseOverride;
+   mona->responseOverridePotential = responseOverridePotential;
+   mona->eventClock                = eventClock;
+   mona->idDispenser               = idDispenser;
+
+   // Copy neurons.
+   numberNeurons();
+   cloneNeurons(mona, neurons);
+
+   // Copy learning events.
+   for (i = 0; i < (int)learningEvents.size(); i++)
+   {
+      for (learningEventItr = learningEvents[i].begin();
+           learningEventItr != learningEvents[i].end(); learningEventItr++)
+      {
+         LearningEvent *learningEvent = new LearningEvent(**learningEventItr);
+         assert(learningEvent != NULL);
+         learningEvent->neuron = neurons[learningEvent->neuron->snapshotIndex];
+         mona->learningEvents[i].push_back(learningEvent);
+      }
+   }
+
+   // Copy homeostats.
+   for (i = 0; i < numNeeds; i++)
+   {
+      homeostat                   = homeostats[i];
+      homeostatCopy               = mona->homeostats[i];
+      homeostatCopy->need         = homeostat->need;
+      homeostatCopy->needIndex    = homeostat->needIndex;
+      homeostatCopy->needDelta    = homeostat->needDelta;
+      homeostatCopy->periodicNeed = homeostat->periodicNeed;
+      homeostatCopy->frequency    = homeostat->frequency;
+      homeostatCopy->freqTimer    = homeostat->freqTimer;
+      homeostatCopy->goals        = homeostat->goals;
+      homeostatCopy->invalidateGoalIndex();
+      for (j = 0; j < (int)homeostatCopy->goals.size(); j++)
+      {
+         Homeostat::Goal& goal = homeostatCopy->goals[j];
+         if (goal.receptor != NULL)
+         {
+            goal.receptor =
+               (void *)neurons[((Receptor *)goal.receptor)->snapshotIndex];
+         }
+         if (goal.motor != NULL)
+         {
+            goal.motor =
+               (void *)neurons[((Motor *)goal.motor)->snapshotIndex];
+         }
+      }
+   }
+
+   // Copy sensor centroid trees.
+   for (i = 0; i < (int)sensorCentroids.size(); i++)
+   {
+      rdTree = mona->newCentroidTree(i);
+      mona->sensorCentroids.push_back(rdTree);
+      sensorCentroids[i]->exportNodes(childCounts, patterns, clients, distances);
+      for (j = 0; j < (int)patterns.size(); j++)
+      {
+         patterns[j] = copyCentroidPattern(patterns[j], i);
+         clients[j] = (void *)neurons[((Receptor *)clients[j])->snapshotIndex];
+      }
+      if (patterns.size() > 0)
+      {
+         rdTree->importNodes(childCounts, patterns, clients, distances);
+      }
+   }
+   return(mona);
+}
+
+
+// Clone neurons into network, returning its neurons in snapshot index order.
+void
+Mona::cloneNeurons(Mona *mona, vector<Neuron *>& neurons)
+{
+   int           i, j, k, n, numReceptors, numMotors;
+   Neuron        *neuron, *neuronCopy;
+   Receptor      *receptor, *receptorCopy;
+   Mediator      *mediator, *mediatorCopy;
+   Enabling      *enabling;
+   struct Notify *notify;
+
+   vector<Neuron *>           records;
+   list<Mediator *>::iterator mediatorItr;
+   list<Enabling *>::iterator enablingItr;
+
+   // Create neurons: motors were created with the network.
+   numReceptors = (int)receptors.size();
+   numMotors    = (int)motors.size();
+   assert(numMotors == (int)mona->motors.size());
+   records.insert(records.end(), receptors.begin(), receptors.end());
+   records.insert(records.end(), motors.begin(), motors.end());
+   records.insert(records.end(), mediators.begin(), mediators.end());
+   n = (int)records.size();
+   neurons.resize(n);
+   for (i = 0; i < numReceptors; i++)
+   {
+      receptor     = receptors[i];
+      receptorCopy = new Receptor(receptor->centroid, receptor->sensorMode, mona);
+      assert(receptorCopy != NULL);
+      mona->receptors.push_back(receptorCopy);
+      neurons[i] = receptorCopy;
+   }
+   for (i = 0; i < numMotors; i++)
+   {
+      neurons[numReceptors + i] = mona->motors[i];
+   }
+   for (i = numReceptors + numMotors; i < n; i++)
+   {
+      mediatorCopy = new Mediator(0.0, mona);
+      assert(mediatorCopy != NULL);
+      mona->mediators.push_back(mediatorCopy);
+      neurons[i] = mediatorCopy;
+   }
+
+   // Neuron fields.
+   for (i = 0; i < n; i++)
+   {
+      neuron                        = records[i];
+      neuronCopy                    = neurons[i];
+      neuronCopy->id                = neuron->id;
+      neuronCopy->creationTime      = neuron->creationTime;
+      neuronCopy->firingStrength    = neuron->firingStrength;
+      neuronCopy->motive            = neuron->motive;
+      neuronCopy->instinct          = neuron->instinct;
+      neuronCopy->goals.updateCount = neuron->goals.updateCount;
+      neuronCopy->goals.values.load(neuron->goals.values);
+      neuronCopy->snapshotIndex = i;
+      neuronCopy->clearNotify();
+      for (j = 0; j < (int)neuron->notifyList.size(); j++)
+      {
+         notify = new struct Notify;
+         assert(notify != NULL);
+         mona->memoryEstimate += notifyMemoryEstimate();
+         notify->mediator  = (Mediator *)neurons[neuron->notifyList[j]->mediator->snapshotIndex];
+         notify->eventType = neuron->notifyList[j]->eventType;
+         neuronCopy->notifyList.push_back(notify);
+      }
+   }
+
+   // Receptor fields.
+   for (i = 0; i < numReceptors; i++)
+   {
+      receptor     = (Receptor *)records[i];
+      receptorCopy = (Receptor *)neurons[i];
+      for (j = 0; j < (int)receptor->subSensorModes.size(); j++)
+      {
+         receptorCopy->subSensorModes.push_back(
+            (Receptor *)neurons[receptor->subSensorModes[j]->snapshotIndex]);
+      }
+      for (j = 0; j < (int)receptor->superSensorModes.size(); j++)
+      {
+         receptorCopy->superSensorModes.push_back(
+            (Receptor *)neurons[receptor->superSensorModes[j]->snapshotIndex]);
+      }
+   }
+
+   // Mediator fields.
+   for (i = numReceptors + numMotors; i < n; i++)
+   {
+      mediator                     = (Mediator *)records[i];
+      mediatorCopy                 = (Mediator *)neurons[i];
+      mediatorCopy->level          = mediator->level;
+      mediatorCopy->baseEnablement = mediator->baseEnablement;
+      mediatorCopy->utility        = mediator->utility;
+      mediatorCopy->utilityWeight  = mediator->utilityWeight;
+      mediatorCopy->causeBegin     = mediator->causeBegin;
+      mediatorCopy->cause          = neurons[mediator->cause->snapshotIndex];
+      if (mediator->response != NULL)
+      {
+         mediatorCopy->response = neurons[mediator->response->snapshotIndex];
+      }
+      mediatorCopy->effect = neurons[mediator->effect->snapshotIndex];
+      for (k = 0; k < 2; k++)
+      {
+         EnablingSet& set     = (k == 0 ? mediator->responseEnablings :
+                                 mediator->effectEnablings);
+         EnablingSet& setCopy = (k == 0 ? mediatorCopy->responseEnablings :
+                                 mediatorCopy->effectEnablings);
+         for (enablingItr = set.enablings.begin();
+              enablingItr != set.enablings.end(); enablingItr++)
+         {
+            enabling = new Enabling(**enablingItr);
+            assert(enabling != NULL);
+            enabling->set = &setCopy;
+            setCopy.enablings.push_back(enabling);
+         }
+      }
+   }
+}
+
+
+// Order mediators by descending utility.
+static bool utilityGreater(Mona::Mediator *a, Mona::Mediator *b)
+{
+   return(a->utility > b->utility);
+}
+
+
+// Merge network.
+bool
+Mona::merge(const Mona& other)
+{
+   int        i, j, level;
+   SENSOR     distance;
+   SensorMode *sensorMode, *otherMode;
+   Neuron     *cause, *response, *effect;
+   Receptor   *receptor, *otherReceptor, *subReceptor;
+   Motor      *motor;
+   Mediator   *mediator, *otherMediator;
+   ENABLEMENT e1, e2;
+   WEIGHT     w1, w2;
+
+   map<Neuron *, Neuron *>           neuronMap;
+   map<Neuron *, Neuron *>::iterator neuronItr;
+   vector<SENSOR>                    centroid;
+   vector<vector<Mediator *> >       levels;
+   list<Mediator *>::const_iterator  mediatorItr;
+
+   if ((numSensors != other.numSensors) ||
+       (numResponses != other.numResponses) || (numNeeds != other.numNeeds))
+   {
+      return(false);
+   }
+
+   // Take the other network's sensor modes?
+   if ((sensorModes.size() == 0) && (receptors.size() == 0))
+   {
+      for (i = 0; i < (int)other.sensorModes.size(); i++)
+      {
+         otherMode = other.sensorModes[i];
+         if ((addSensorMode(otherMode->mask, otherMode->resolution) != i) ||
+             !setSensorModeQuantization(i, otherMode->quantization,
+                                        otherMode->quantizationScale))
+         {
+            return(false);
+         }
+      }
+   }
+   if (sensorModes.size() != other.sensorModes.size())
+   {
+      return(false);
+   }
+   for (i = 0; i < (int)sensorModes.size(); i++)
+   {
+      sensorMode = sensorModes[i];
+      otherMode  = other.sensorModes[i];
+      if ((sensorMode->mask != otherMode->mask) ||
+          (sensorMode->resolution != otherMode->resolution) ||
+          (sensorMode->quantization != otherMode->quantization) ||
+          (sensorMode->quantizationScale != otherMode->quantizationScale))
+      {
+         return(false);
+      }
+   }
+
+   // Complete background learning.
+   finishLearning();
+
+   // The merged network cannot be replayed from a recording.
+   stopRecording();
+
+   // Match or import receptors.
+   for (i = 0; i < (int)other.receptors.size(); i++)
+   {
+      otherReceptor = other.receptors[i];
+      centroid      = otherReceptor->centroid;
+      receptor      = getCentroidReceptor(centroid, otherReceptor->sensorMode, distance);
+      if ((receptor == NULL) ||
+          ((distance > sensorModes[otherReceptor->sensorMode]->resolution) &&
+           (distance > NEARLY_ZERO)))
+      {
+         receptor = newReceptor(centroid, otherReceptor->sensorMode);
+         receptor->instinct = otherReceptor->instinct;
+         receptor->goals.setGoals(otherReceptor->goals.values);
+         receptor->goals.updateCount = otherReceptor->goals.updateCount;
+      }
+      else
+      {
+         mergeGoals(receptor, otherReceptor);
+      }
+      neuronMap[otherReceptor] = receptor;
    }
-   FWRITE_INT(&numSensors, fp);
-   FWRITE_INT(&numResponses, fp);
-   FWRITE_INT(&numNeeds, fp);
-   FWRITE_LONG(&randomSeed, fp);
-   j = (int)sensorModes.size();
-   FWRITE_INT(&j, fp);
-   for (i = 0; i < j; i++)
+
+   // Link receptors by sensor mode.
+   for (i = 0; i < (int)other.receptors.size(); i++)
    {
-      sensorModes[i]->save(fp);
+      otherReceptor = other.receptors[i];
+      receptor      = (Receptor *)neuronMap[otherReceptor];
+      for (j = 0; j < (int)otherReceptor->subSensorModes.size(); j++)
+      {
+         subReceptor = (Receptor *)neuronMap[otherReceptor->subSensorModes[j]];
+         if ((subReceptor != NULL) && (subReceptor != receptor) &&
+             (find(receptor->subSensorModes.begin(), receptor->subSensorModes.end(),
+                   subReceptor) == receptor->subSensorModes.end()))
+         {
+            receptor->subSensorModes.push_back(subReceptor);
+            subReceptor->superSensorModes.push_back(receptor);
+            receptor->dirty    = true;
+            subReceptor->dirty = true;
+         }
+      }
    }
-   random.RAND_SAVE(fp);
-   for (i = 0; i < (int)sensors.size(); i++)
+
+   // Match motors.
+   for (i = 0; i < (int)other.motors.size(); i++)
    {
-      FWRITE_FLOAT(&sensors[i], fp);
+      motor = findMotorByResponse(other.motors[i]->response);
+      if (motor != NULL)
+      {
+         mergeGoals(motor, other.motors[i]);
+         neuronMap[other.motors[i]] = motor;
+      }
    }
-   FWRITE_INT(&response, fp);
-   FWRITE_LONG_LONG(&eventClock, fp);
-   for (i = 0; i < (int)learningEvents.size(); i++)
+
+   // Match or import mediators a level at a time, so that
+   // their events have been matched or imported first.
+   for (mediatorItr = other.mediators.begin();
+        mediatorItr != other.mediators.end(); mediatorItr++)
    {
-      j = (int)learningEvents[i].size();
-      FWRITE_INT(&j, fp);
-      for (learningEventItr = learningEvents[i].begin();
-           learningEventItr != learningEvents[i].end(); learningEventItr++)
+      otherMediator = *mediatorItr;
+      if (otherMediator->level <= MAX_MEDIATOR_LEVEL)
       {
-         learningEvent = *learningEventItr;
-         learningEvent->save(fp);
+         if (otherMediator->level >= (int)levels.size())
+         {
+            levels.resize(otherMediator->level + 1);
+         }
+         levels[otherMediator->level].push_back(otherMediator);
       }
    }
-   i = (int)receptors.size();
-   FWRITE_INT(&i, fp);
-   for (i = 0; i < (int)receptors.size(); i++)
+   for (level = 0; level < (int)levels.size(); level++)
    {
-      receptor = receptors[i];
-      receptor->save(fp);
+      stable_sort(levels[level].begin(), levels[level].end(), utilityGreater);
+      for (i = 0; i < (int)levels[level].size(); i++)
+      {
+         otherMediator = levels[level][i];
+         neuronItr     = neuronMap.find(otherMediator->cause);
+         cause         = (neuronItr != neuronMap.end() ? neuronItr->second : NULL);
+         neuronItr     = neuronMap.find(otherMediator->effect);
+         effect        = (neuronItr != neuronMap.end() ? neuronItr->second : NULL);
+         response      = NULL;
+         if (otherMediator->response != NULL)
+         {
+            neuronItr = neuronMap.find(otherMediator->response);
+            if (neuronItr != neuronMap.end())
+            {
+               response = neuronItr->second;
+            }
+            else
+            {
+               continue;
+            }
+         }
+         if ((cause == NULL) || (effect == NULL))
+         {
+            continue;
+         }
+         mediator = findMediator(cause, response, effect);
+         if (mediator != NULL)
+         {
+            // Weight by accumulated firing updates.
+            w1 = mediator->utilityWeight;
+            w2 = otherMediator->utilityWeight;
+            if (!mediator->instinct)
+            {
+               e1 = mediator->getEnablement();
+               e2 = otherMediator->getEnablement();
+               if ((w1 + w2) > 0.0)
+               {
+                  mediator->setEnablement(((e1 * w1) + (e2 * w2)) / (w1 + w2));
+               }
+               else
+               {
+                  mediator->setEnablement((e1 + e2) / 2.0);
+               }
+            }
+            if ((w1 + w2) > 0.0)
+            {
+               mediator->utility = ((mediator->utility * w1) +
+                                    (otherMediator->utility * w2)) / (w1 + w2);
+            }
+            else
+            {
+               mediator->utility = (mediator->utility + otherMediator->utility) / 2.0;
+            }
+            mediator->utilityWeight = w1 + w2;
+            mediator->dirty         = true;
+            mergeGoals(mediator, otherMediator);
+         }
+         else
+         {
+            if ((int)mediators.size() >= MAX_MEDIATORS)
+            {
+               continue;
+            }
+            mediator = newMediator(otherMediator->getEnablement());
+            mediator->addEvent(CAUSE_EVENT, cause);
+            if (response != NULL)
+            {
+               mediator->addEvent(RESPONSE_EVENT, response);
+            }
+            mediator->addEvent(EFFECT_EVENT, effect);
+            mediator->instinct      = otherMediator->instinct;
+            mediator->utility       = otherMediator->utility;
+            mediator->utilityWeight = otherMediator->utilityWeight;
+            mediator->goals.setGoals(otherMediator->goals.values);
+            mediator->goals.updateCount = otherMediator->goals.updateCount;
+            traceEvent(MEDIATOR_CREATE_EVENT, mediator->level, mediator->id,
+                       mediator->baseEnablement);
+         }
+         neuronMap[otherMediator] = mediator;
+      }
    }
-   for (i = 0; i < (int)motors.size(); i++)
+
+   // Delete mediators exceeding the memory budget.
+   deleteExcessMediators();
+   return(true);
+}
+
+
+// Find mediator having given events.
+Mona::Mediator *
+Mona::findMediator(Neuron *cause, Neuron *response, Neuron *effect)
+{
+   Mediator *mediator;
+
+   for (int i = 0; i < (int)cause->notifyList.size(); i++)
    {
-      motor = motors[i];
-      motor->save(fp);
+      mediator = cause->notifyList[i]->mediator;
+      if ((cause->notifyList[i]->eventType == CAUSE_EVENT) &&
+          (mediator->response == response) && (mediator->effect == effect))
+      {
+         return(mediator);
+      }
+   }
+   return(NULL);
+}
+
+
+// Merge goal values weighted by update counts.
+void
+Mona::mergeGoals(Neuron *neuron, Neuron *otherNeuron)
+{
+   COUNTER c1, c2;
+
+   c1 = neuron->goals.updateCount;
+   c2 = otherNeuron->goals.updateCount;
+   if (c2 == 0)
+   {
+      return;
+   }
+   for (int i = 0; i < neuron->goals.getNumGoals(); i++)
+   {
+      neuron->goals.setValue(i, ((neuron->goals.getValue(i) * (double)c1) +
+                                 (otherNeuron->goals.getValue(i) * (double)c2)) /
+                             (double)(c1 + c2));
+   }
+   neuron->goals.updateCount = c1 + c2;
+   neuron->dirty = true;
+}
+
+
+// Start event tracing, discarding previous events.
+void
+Mona::startEventTrace(int size)
+{
+   stopEventTrace();
+   eventTrace = new EventRing(size);
+   assert(eventTrace != NULL);
+}
+
+
+// Stop event tracing.
+void
+Mona::stopEventTrace()
+{
+   if (eventTrace != NULL)
+   {
+      delete eventTrace;
+      eventTrace = NULL;
+   }
+}
+
+
+// Dump event trace to file.
+bool
+Mona::dumpEventTrace(char *filename)
+{
+   FILE *fp;
+   bool ret;
+
+   if ((fp = FOPEN_WRITE(filename)) == NULL)
+   {
+      fprintf(stderr, "Cannot open trace file %s\n", filename);
+      return(false);
+   }
+   ret = dumpEventTrace(fp);
+   FCLOSE(fp);
+   return(ret);
+}
+
+
+// Dump retained trace events, oldest first.
+bool
+Mona::dumpEventTrace(FILE *fp)
+{
+   int                      i, n;
+   unsigned long long       dropped;
+   vector<EventRing::Event> events;
+
+   if (eventTrace == NULL)
+   {
+      fprintf(stderr, "Event tracing is not started\n");
+      return(false);
    }
-   i = (int)mediators.size();
+   eventTrace->get(events);
+   dropped = eventTrace->count() - (unsigned long long)events.size();
+
+   // Save format, including searchable string.
+   i = TRACE_FORMAT;
    FWRITE_INT(&i, fp);
-   for (mediatorItr = mediators.begin();
-        mediatorItr != mediators.end(); mediatorItr++)
+   char buf[40] = { 0 };
+   sprintf(buf, "%s(#) Mona trace format %d", "@", FORMAT);
+   FWRITE_STRING(buf, 40, fp);
+
+   n = (int)events.size();
+   FWRITE_INT(&n, fp);
+   FWRITE_LONG_LONG(&dropped, fp);
+   for (i = 0; i < n; i++)
    {
-      mediator = *mediatorItr;
-      mediator->save(fp);
+      EventRing::Event& e = events[i];
+      FWRITE_LONG_LONG(&e.sequence, fp);
+      FWRITE_LONG_LONG(&e.time, fp);
+      FWRITE_LONG_LONG(&e.clock, fp);
+      FWRITE_LONG_LONG(&e.id, fp);
+      FWRITE_DOUBLE(&e.value, fp);
+      FWRITE_INT(&e.type, fp);
+      FWRITE_INT(&e.arg, fp);
    }
-   for (i = 0; i < numNeeds; i++)
+   fflush(fp);
+   if (ferror(fp))
    {
-      homeostats[i]->save(fp);
+      fprintf(stderr, "Cannot write trace\n");
+      return(false);
    }
-   j = (int)sensorCentroids.size();
-   FWRITE_INT(&j, fp);
-   for (i = 0; i < j; i++)
+   return(true);
+}
+
+
+// Metrics clock in nanoseconds.
+unsigned long long
+Mona::metricsClock()
+{
+   return((unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+// Reset metrics.
+void
+Mona::resetMetrics()
+{
+   if (phaseLatencies != NULL)
+   {
+      for (int i = 0; i <= NUM_TRACE_PHASES; i++)
+      {
+         phaseLatencies[i].clear();
+      }
+   }
+   phaseBegin          = 0;
+   cycles              = 0;
+   mediatorsCreated    = 0;
+   duplicateMediators  = 0;
+   mediatorsEvicted    = 0;
+   enablingsCreated    = 0;
+   enablingsExpired    = 0;
+   driveEdgesTraversed = 0;
+   centroidDistances   = 0;
+}
+
+
+// Turn latency metrics on or off.
+// The cycle latency histogram follows those of the phases.
+void
+Mona::setLatencyMetrics(bool on)
+{
+   if (on && (phaseLatencies == NULL))
+   {
+      phaseLatencies = new Histogram[NUM_TRACE_PHASES + 1];
+      assert(phaseLatencies != NULL);
+      cycleLatencies = &phaseLatencies[NUM_TRACE_PHASES];
+   }
+   else if (!on && (phaseLatencies != NULL))
+   {
+      delete [] phaseLatencies;
+      phaseLatencies = NULL;
+      cycleLatencies = NULL;
+   }
+}
+
+
+// Set file to write metrics to every given number of cycles.
+// A NULL file name stops writing.
+void
+Mona::setMetricsFile(char *filename, int interval)
+{
+   if (metricsFile != NULL)
+   {
+      delete [] metricsFile;
+      metricsFile = NULL;
+   }
+   metricsInterval = 0;
+   if ((filename != NULL) && (interval > 0))
+   {
+      metricsFile = new char[strlen(filename) + 1];
+      assert(metricsFile != NULL);
+      strcpy(metricsFile, filename);
+      metricsInterval = interval;
+   }
+}
+
+
+// Metric phase names.
+static const char *MetricPhaseNames[Mona::NUM_TRACE_PHASES] =
+{
+   "sense",
+   "enable",
+   "learn",
+   "drive",
+   "respond",
+   "commit_learning"
+};
+
+// Print metric name with labels.
+static void
+printMetricName(FILE *out, const char *name, const char *suffix,
+                char *labels, const char *phase, double quantile)
+{
+   const char *separator = "";
+
+   fprintf(out, "%s%s", name, suffix);
+   if ((labels == NULL) && (phase == NULL) && (quantile < 0.0))
+   {
+      fprintf(out, " ");
+      return;
+   }
+   fprintf(out, "{");
+   if (labels != NULL)
+   {
+      fprintf(out, "%s", labels);
+      separator = ",";
+   }
+   if (phase != NULL)
+   {
+      fprintf(out, "%sphase=\"%s\"", separator, phase);
+      separator = ",";
+   }
+   if (quantile >= 0.0)
+   {
+      fprintf(out, "%squantile=\"%g\"", separator, quantile);
+   }
+   fprintf(out, "} ");
+}
+
+
+// Print latency histogram as Prometheus summary samples in seconds.
+static void
+printLatencyMetric(FILE *out, const char *name, char *labels,
+                   const char *phase, Histogram& histogram)
+{
+   int    i;
+   double quantiles[4] = { 0.5, 0.9, 0.99, 0.999 };
+
+   for (i = 0; i < 4; i++)
+   {
+      printMetricName(out, name, "", labels, phase, quantiles[i]);
+      fprintf(out, "%.9f\n", (double)histogram.getQuantile(quantiles[i]) / 1.0e9);
+   }
+   printMetricName(out, name, "_sum", labels, phase, -1.0);
+   fprintf(out, "%.9f\n", (double)histogram.getSum() / 1.0e9);
+   printMetricName(out, name, "_count", labels, phase, -1.0);
+   fprintf(out, "%llu\n", histogram.getCount());
+}
+
+
+// Print counter metric.
+static void
+printCounterMetric(FILE *out, const char *name, const char *help,
+                   char *labels, unsigned long long value)
+{
+   fprintf(out, "# HELP %s %s\n", name, help);
+   fprintf(out, "# TYPE %s counter\n", name);
+   printMetricName(out, name, "", labels, NULL, -1.0);
+   fprintf(out, "%llu\n", value);
+}
+
+
+// Print metrics in Prometheus text exposition format.
+// Labels, such as: instance="muzz0", are added to every sample.
+void
+Mona::printMetrics(FILE *out, char *labels)
+{
+   int i;
+
+   if (cycleLatencies != NULL)
+   {
+      fprintf(out, "# HELP mona_cycle_seconds Behavior cycle latency.\n");
+      fprintf(out, "# TYPE mona_cycle_seconds summary\n");
+      printLatencyMetric(out, "mona_cycle_seconds", labels, NULL, *cycleLatencies);
+      fprintf(out, "# HELP mona_phase_seconds Behavior cycle phase latency.\n");
+      fprintf(out, "# TYPE mona_phase_seconds summary\n");
+      for (i = 0; i < NUM_TRACE_PHASES; i++)
+      {
+         printLatencyMetric(out, "mona_phase_seconds", labels,
+                            MetricPhaseNames[i], phaseLatencies[i]);
+      }
+   }
+   else
+   {
+      printCounterMetric(out, "mona_cycles_total",
+                         "Behavior cycles.", labels, cycles);
+   }
+   printCounterMetric(out, "mona_mediators_created_total",
+                      "Mediators added to the network.", labels, mediatorsCreated);
+   printCounterMetric(out, "mona_duplicate_mediators_total",
+                      "Learned mediators rejected as duplicates.", labels, duplicateMediators);
+   printCounterMetric(out, "mona_mediators_evicted_total",
+                      "Mediators deleted to stay within MAX_MEDIATORS or MAX_MEMORY_BYTES.", labels, mediatorsEvicted);
+   printCounterMetric(out, "mona_enablings_created_total",
+                      "Enablings created by cause firings.", labels, enablingsCreated.load());
+   printCounterMetric(out, "mona_enablings_expired_total",
+                      "Enablings expired without an effect firing.", labels, enablingsExpired.load());
+   printCounterMetric(out, "mona_drive_edges_total",
+                      "Drive edges traversed.", labels, driveEdgesTraversed);
+   printCounterMetric(out, "mona_centroid_distances_total",
+                      "Sensor centroid distance evaluations.", labels, centroidDistances);
+   fprintf(out, "# HELP mona_mediators Mediators in the network.\n");
+   fprintf(out, "# TYPE mona_mediators gauge\n");
+   printMetricName(out, "mona_mediators", "", labels, NULL, -1.0);
+   fprintf(out, "%d\n", (int)mediators.size());
+   fprintf(out, "# HELP mona_receptors Receptors in the network.\n");
+   fprintf(out, "# TYPE mona_receptors gauge\n");
+   printMetricName(out, "mona_receptors", "", labels, NULL, -1.0);
+   fprintf(out, "%d\n", (int)receptors.size());
+   fprintf(out, "# HELP mona_memory_bytes Estimated network memory usage.\n");
+   fprintf(out, "# TYPE mona_memory_bytes gauge\n");
+   printMetricName(out, "mona_memory_bytes", "", labels, NULL, -1.0);
+   fprintf(out, "%llu\n", memoryUsage());
+}
+
+
+// Write metrics to file, replacing it atomically.
+bool
+Mona::writeMetrics(char *filename, char *labels)
+{
+   FILE *fp;
+   bool ret;
+
+   string tmpname = string(filename) + ".tmp";
+   if ((fp = fopen(tmpname.c_str(), "w")) == NULL)
+   {
+      fprintf(stderr, "Cannot open metrics file %s\n", tmpname.c_str());
+      return(false);
+   }
+   printMetrics(fp, labels);
+   ret = (ferror(fp) == 0);
+   if (fclose(fp) != 0)
+   {
+      ret = false;
+   }
+#ifdef WIN32
+   remove(filename);
+#endif
+   if (!ret || (rename(tmpname.c_str(), filename) != 0))
    {
-      sensorCentroids[i]->save(fp, Mona::Receptor::savePattern,
-                               Mona::Receptor::saveClient);
+      fprintf(stderr, "Cannot write metrics file %s\n", filename);
+      remove(tmpname.c_str());
+      return(false);
    }
    return(true);
 }
 
 
+// Print readable statistics, with latencies in microseconds.
+void
+Mona::printStats(FILE *out)
+{
+   int i;
+
+   fprintf(out, "Cycles: %llu\n", cycles);
+   if (cycleLatencies != NULL)
+   {
+      fprintf(out, "Latency (us)          mean        p50        p99        max\n");
+      for (i = -1; i < NUM_TRACE_PHASES; i++)
+      {
+         Histogram& h = (i < 0) ? *cycleLatencies : phaseLatencies[i];
+         fprintf(out, "  %-15s %10.3f %10.3f %10.3f %10.3f\n",
+                 (i < 0) ? "cycle" : MetricPhaseNames[i],
+                 h.getMean() / 1000.0, (double)h.getQuantile(0.5) / 1000.0,
+                 (double)h.getQuantile(0.99) / 1000.0, (double)h.getMax() / 1000.0);
+      }
+   }
+   fprintf(out, "Mediators: %d\n", (int)mediators.size());
+   fprintf(out, "Mediators created: %llu\n", mediatorsCreated);
+   fprintf(out, "Duplicate mediators: %llu\n", duplicateMediators);
+   fprintf(out, "Mediators evicted: %llu\n", mediatorsEvicted);
+   fprintf(out, "Enablings created: %llu\n", enablingsCreated.load());
+   fprintf(out, "Enablings expired: %llu\n", enablingsExpired.load());
+   fprintf(out, "Drive edges: %llu\n", driveEdgesTraversed);
+   fprintf(out, "Centroid distances: %llu\n", centroidDistances);
+   printMemoryUsage(out);
+}
+
+
 // Clear the network.
 void
 Mona::clear()
@@ -2180,27 +5472,72 @@ Mona::clear()
    int      i;
    Receptor *receptor;
    Motor    *motor;
+   Mediator *mediator;
 
    list<Mediator *>::iterator      mediatorItr;
    LearningEvent                   *learningEvent;
    list<LearningEvent *>::iterator learningEventItr;
 
+   // Discard background learning.
+   if (learningTask != NULL)
+   {
+      learningTask->wait();
+      learningTask->clear();
+   }
+
+   // End recording.
+   stopRecording();
+
    random.RAND_CLEAR();
    sensors.clear();
-   for (i = 0; i < (int)sensorModes.size(); i++)
+
+   // A shared configuration's sensor modes remain its own.
+   if (configuration == NULL)
    {
-      delete sensorModes[i];
+      for (i = 0; i < (int)sensorModes.size(); i++)
+      {
+         delete sensorModes[i];
+      }
+      sensorMemberModes.clear();
    }
    sensorModes.clear();
+   sensorModeViews.clear();
+   senseReceptors.clear();
+   senseDistances.clear();
    for (i = 0; i < (int)sensorCentroids.size(); i++)
    {
       delete sensorCentroids[i];
    }
    sensorCentroids.clear();
-   while ((int)receptors.size() > 0)
+
+   // Detach neurons before deleting them, as a partially
+   // loaded network may have inconsistent notifications.
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      receptors[i]->clearNotify();
+   }
+   for (i = 0; i < (int)motors.size(); i++)
+   {
+      motors[i]->clearNotify();
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
    {
-      receptor = receptors[0];
-      deleteNeuron(receptor);
+      mediator = *mediatorItr;
+      mediator->clearNotify();
+      mediator->cause = mediator->response = mediator->effect = NULL;
+   }
+   for (mediatorItr = mediators.begin();
+        mediatorItr != mediators.end(); mediatorItr++)
+   {
+      mediator = *mediatorItr;
+      delete mediator;
+   }
+   mediators.clear();
+   for (i = 0; i < (int)receptors.size(); i++)
+   {
+      receptor = receptors[i];
+      delete receptor;
    }
    receptors.clear();
    responsePotentials.clear();
@@ -2507,6 +5844,19 @@ Mona::printParms(FILE *out)
    {
       fprintf(out, "<parameter>LEARN_RECEPTOR_GOAL_VALUE</parameter><value>false</value>\n");
    }
+   fprintf(out, "<parameter>DRIVE_MOTIVE_EPSILON</parameter><value>%f</value>\n", DRIVE_MOTIVE_EPSILON);
+   fprintf(out, "<parameter>MAX_DRIVE_EDGES</parameter><value>%d</value>\n", MAX_DRIVE_EDGES);
+   fprintf(out, "<parameter>DRIVE_THREADS</parameter><value>%d</value>\n", DRIVE_THREADS);
+   fprintf(out, "<parameter>ENABLE_THREADS</parameter><value>%d</value>\n", ENABLE_THREADS);
+   if (LEARN_ASYNC)
+   {
+      fprintf(out, "<parameter>LEARN_ASYNC</parameter><value>true</value>\n");
+   }
+   else
+   {
+      fprintf(out, "<parameter>LEARN_ASYNC</parameter><value>false</value>\n");
+   }
+   fprintf(out, "<parameter>MAX_MEMORY_BYTES</parameter><value>%llu</value>\n", MAX_MEMORY_BYTES);
    fprintf(out, "<effect_event_intervals>\n");
    for (i = 0; i < (int)effectEventIntervals.size(); i++)
    {
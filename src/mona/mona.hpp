@@ -44,6 +44,10 @@ extern const char *MonaVersion;
 #endif
 
 #include "../common/common.h"
+#include "../common/threadpool.hpp"
+#include "../common/bytebuffer.hpp"
+#include "../common/eventring.hpp"
+#include "../common/histogram.hpp"
 #include "homeostat.hpp"
 
 // Mona: sensory/response, neural network, and needs.
@@ -52,7 +56,7 @@ class PUBLIC_API Mona
 public:
 
    // Content format.
-   enum { FORMAT=10 };
+   enum { FORMAT=11, LEGACY_FORMAT=10, DELTA_FORMAT=1011, RECORDING_FORMAT=2012, TRACE_FORMAT=3011 };
 
    // Data types.
    typedef Homeostat::ID            ID;
@@ -100,6 +104,8 @@ public:
    bool setSensorResolution(SENSOR sensorResolution);
    int addSensorMode(vector<bool>& sensorMask);
    int addSensorMode(vector<bool>& sensorMask, SENSOR sensorResolution);
+   bool setSensorModeQuantization(SENSOR_MODE sensorMode, int quantization,
+                                  SENSOR quantizationScale);
 
    // Destructor.
    ~Mona();
@@ -148,13 +154,36 @@ public:
    // receptor in a set reserved for the mode. This
    // provides the network with selective attention
    // capabilities.
+   // A network sharing a configuration holds the configuration's
+   // sensor modes, which it must not change.
    vector<SensorMode *> sensorModes;
    void                 applySensorMode(vector<SENSOR> &in, vector<SENSOR> &out, SENSOR_MODE);
    void                 applySensorMode(vector<SENSOR> &sensors, SENSOR_MODE);
+   SENSOR               sensorModeDistance(vector<SENSOR>& pattern, vector<SENSOR>& sensors,
+                                           SENSOR_MODE);
+
+   // Compiled sensor modes.
+   // Sensing gathers the sensors into a masked view for every
+   // mode in one pass, using the modes that include each sensor.
+   // Compile after adding or loading sensor modes.
+   // The member modes are part of a shared configuration.
+   vector<vector<SENSOR_MODE> >& sensorMemberModes;
+   vector<vector<SENSOR> >       sensorModeViews;
+   void compileSensorModes();
 
    // Sensor centroid search spaces.
-   // Each sensor mode defines a space.
+   // Each sensor mode defines a space. Quantized modes store and
+   // search codes of their unmasked sensors instead of the sensors.
    vector<RDtree *> sensorCentroids;
+   SensorCodes      searchCodes;
+   RDtree *newCentroidTree(SENSOR_MODE sensorMode);
+   void *newCentroidPattern(vector<SENSOR>& centroid, SENSOR_MODE sensorMode);
+   void *copyCentroidPattern(void *pattern, SENSOR_MODE sensorMode);
+
+   // Receptors firing for each sensor mode in the sense phase,
+   // NULL for none, and their centroid distances.
+   vector<Receptor *> senseReceptors;
+   vector<SENSOR>     senseDistances;
 
    // Find the receptor having the centroid closest to
    // the sensor vector for the give sensor mode.
@@ -197,6 +226,10 @@ public:
                 SENSOR_MODE sensorMode, RESPONSE response);
    int findGoal(int needIndex, vector<SENSOR>& sensors,
                 SENSOR_MODE sensorMode);
+   // Check goal parameters before adding a goal: the need and sensor
+   // mode must exist, and the response must exist or be NULL_RESPONSE.
+   // A network without sensor modes has base mode 0.
+   bool isGoalValid(int needIndex, SENSOR_MODE sensorMode, RESPONSE response);
    int getNumGoals(int needIndex);
    bool getGoalInfo(int needIndex, int goalIndex,
                     vector<SENSOR>& sensors, SENSOR_MODE& sensorMode,
@@ -212,7 +245,10 @@ public:
    // 2. Response-equipped mediators are considered "immediate" mediators
    //    for which only the first interval is applicable with 100% weight.
    // 3. Customizable by application at initialization time. See initEffectIntervals.
-   vector<vector<TIME> > effectEventIntervals;
+   // A network sharing a configuration reads the configuration's
+   // intervals, weights and maximum learning intervals: writing
+   // them changes those of every network sharing it.
+   vector<vector<TIME> >& effectEventIntervals;
 
    // Effect interval weights determine how enablement is distributed to enablings
    // timed by the effect event intervals. Causes that have more immediate effects
@@ -220,7 +256,7 @@ public:
    // effects. This can be represented by weighting smaller intervals more heavily
    // than larger ones. effectIntervalWeights[n] must sum to 1.0
    // Customizable by application at initialization time. See initEffectIntervals.
-   vector<vector<WEIGHT> > effectEventIntervalWeights;
+   vector<vector<WEIGHT> >& effectEventIntervalWeights;
 
    // Maximum learning effect event intervals.
    // 1. These are the maximum firing intervals between events allowable
@@ -229,7 +265,7 @@ public:
    //     existing mediators as a means of improving the quality and throttling
    //     the quantity of learned mediators.
    // 3. Customizable by application at initialization time. See initEffectIntervals.
-   vector<TIME> maxLearningEffectEventIntervals;
+   vector<TIME>& maxLearningEffectEventIntervals;
 
    // Initialize effect event intervals and weights.
    void initEffectEventIntervals();
@@ -250,10 +286,70 @@ public:
    // Cause event firing notifications.
    list<struct FiringNotify> causeFirings;
 
+   // Parallel enablement.
+   // With ENABLE_THREADS > 1 mediators are enabled a level at a time
+   // across the thread pool; a mediator's effect firing depends only
+   // on lower level mediators. The result equals serial enablement.
+   // Tracing or tracking forces serial enablement.
+   // This is a run-time setting and is not saved.
+   enum { ENABLE_TASK_SIZE=64 };
+   enum ENABLE_STEP
+   {
+      CLEAR_STEP,
+      EFFECT_STEP,
+      CAUSE_STEP,
+      DEFERRED_CAUSE_STEP,
+      RETIRE_STEP,
+      EFFECTIVE_ENABLEMENT_STEP
+   };
+   int                          ENABLE_THREADS;
+   ENABLE_STEP                  enableStep;
+   vector<Mediator *>           enableMediators;
+   vector<vector<Mediator *> >  enableLevels;
+   vector<Mediator *>           *enableTasks;
+   vector<struct FiringNotify>  enableCauseFirings;
+   vector<EnableWorker *>       enableWorkers;
+   bool                         deferGoalSubsumption;
+   void enableParallel(int numWorkers);
+   void runEnableStep(ENABLE_STEP step, vector<Mediator *> *mediators,
+                      int numItems, int numWorkers);
+   static void enableTask(void *mona, int task, int worker);
+
+   // Goal value subsumption work.
+   vector<bool> goalBlocks;
+
+   // Drive traversal.
+   // Motive is driven from each goal source by a depth-first
+   // traversal using an explicit work stack. Motive contributions
+   // less than DRIVE_MOTIVE_EPSILON in magnitude are not propagated,
+   // and at most MAX_DRIVE_EDGES edges are traversed per drive phase
+   // (-1 = unlimited). The defaults (0.0, -1) give exact drive.
+   // With DRIVE_THREADS > 1 the goal sources are divided among
+   // workers having private motive accumulators, whose motives
+   // are merged by maximum; the result equals serial drive.
+   // An edge budget, tracing or tracking forces serial drive.
+   // These are run-time settings and are not saved.
+   MOTIVE                DRIVE_MOTIVE_EPSILON;
+   int                   MAX_DRIVE_EDGES;
+   int                   DRIVE_THREADS;
+   COUNTER               driveEdges;
+   MOTIVE                droppedMotive;
+   vector<Neuron *>      driveNeurons;
+   vector<Neuron *>      driveSources;
+   vector<COUNTER>       driveSourceEdges;
+   vector<MOTIVE>        driveSourceDroppedMotive;
+   vector<DriveWorker *> driveWorkers;
+   void driveSource(DriveWorker *worker, int sourceIndex);
+   static void driveTask(void *mona, int sourceIndex, int worker);
+   void driveMotive(DriveWorker *worker, Neuron *neuron);
+   void pushDrive(DriveWorker *worker, Neuron *neuron, bool cause, WEIGHT weight);
+
+   // Thread pool for parallel phases.
+   ThreadPool *threadPool;
+   ThreadPool *getThreadPool(int numThreads);
+
    // Motive.
    MOTIVE maxMotive;
-   void clearMotiveWork();
-   void setMotives();
    void finalizeMotives();
 
    // Unique identifier dispenser.
@@ -267,11 +363,108 @@ public:
    vector<GeneralizationEvent *>  generalizationEvents;
 
    // Mediator generation.
-   void createMediator(LearningEvent *event);
-   void generalizeMediator(GeneralizationEvent *event);
+   // A background learning task creates detached mediators.
+   void createMediators(LearningTask *task = NULL);
+   void createMediator(LearningEvent *event, LearningTask *task = NULL);
+   void generalizeMediator(GeneralizationEvent *event, LearningTask *task = NULL);
+   Mediator *makeMediator(Neuron *cause, Neuron *response, Neuron *effect,
+                          VALUE_SET& needs, TIME causeBegin,
+                          WEIGHT firingStrength, LearningTask *task);
    bool isDuplicateMediator(Mediator *);
+   void deleteExcessMediators();
+
+   // Background learning.
+   // With LEARN_ASYNC the mediators for a cycle's learning events are
+   // created by a worker thread while the cycle completes, and are
+   // committed to the network, with duplicate checks and deletion of
+   // excess mediators, at the beginning of the next cycle. Learning
+   // is thus delayed by exactly one cycle: new mediators do not take
+   // part in the drive and response of the cycle that learned them,
+   // and a mediator built on a new mediator that proves to be a
+   // duplicate is discarded. While the worker runs it holds the
+   // learning events, which are swapped to it rather than copied.
+   // Learning traces force serial learning.
+   // This is a run-time setting and is not saved.
+   bool         LEARN_ASYNC;
+   LearningTask *learningTask;
+   void finishLearning();
+
+   // Event tracing.
+   // While started, phase boundaries, neuron firings, enablings,
+   // mediator creations and deletions, and drive hops are recorded
+   // in a ring buffer keeping the most recent events. Stopped tracing
+   // costs one test per event. Dump to a file for bin/mona_trace.
+   // This is a run-time setting and is not saved.
+   enum TRACE_EVENT
+   {
+      PHASE_BEGIN_EVENT,
+      PHASE_END_EVENT,
+      FIRE_EVENT,
+      ENABLE_EVENT,
+      MEDIATOR_CREATE_EVENT,
+      MEDIATOR_DELETE_EVENT,
+      DRIVE_EVENT
+   };
+   enum TRACE_PHASE
+   {
+      SENSE_PHASE,
+      ENABLE_PHASE,
+      LEARN_PHASE,
+      DRIVE_PHASE,
+      RESPOND_PHASE,
+      COMMIT_LEARNING_PHASE
+   };
+   enum { NUM_TRACE_PHASES=6 };
+   enum { DEFAULT_EVENT_TRACE_SIZE=65536 };
+   EventRing *eventTrace;
+   void startEventTrace(int size = DEFAULT_EVENT_TRACE_SIZE);
+   void stopEventTrace();
+   bool dumpEventTrace(char *filename);
+   bool dumpEventTrace(FILE *fp);
+   inline void traceEvent(TRACE_EVENT type, int arg, ID id, double value)
+   {
+      if (eventTrace != NULL)
+      {
+         eventTrace->record(type, arg, eventClock, id, value);
+      }
+   }
+
+   // Metrics.
+   // Latency histograms of the cycle phases and the whole cycle,
+   // in nanoseconds, and activity counters, accumulated since
+   // construction or resetMetrics. printMetrics writes them in
+   // Prometheus text exposition format; with a metrics file set,
+   // they are also written to it every metricsInterval cycles,
+   // replacing the file atomically for scraping. The latency
+   // histograms, some 64KB, are kept while latency metrics are on,
+   // the default; turned off, the cycle reads no clocks.
+   // These are run-time values and are not saved.
+   Histogram            *phaseLatencies;
+   Histogram            *cycleLatencies;
+   unsigned long long   phaseBegin;
+   COUNTER              cycles;
+   COUNTER              mediatorsCreated;
+   COUNTER              duplicateMediators;
+   COUNTER              mediatorsEvicted;
+   std::atomic<COUNTER> enablingsCreated;
+   std::atomic<COUNTER> enablingsExpired;
+   COUNTER              driveEdgesTraversed;
+   COUNTER              centroidDistances;
+   char                 *metricsFile;
+   int                  metricsInterval;
+   void resetMetrics();
+   void setLatencyMetrics(bool on);
+   void setMetricsFile(char *filename, int interval);
+   void printMetrics(FILE *out = stdout, char *labels = NULL);
+   bool writeMetrics(char *filename, char *labels = NULL);
+   void printStats(FILE *out = stdout);
+   void beginPhase(TRACE_PHASE phase);
+   void endPhase(TRACE_PHASE phase, double value = 0.0);
+   static unsigned long long metricsClock();
 
    // Random numbers.
+   // Seeding a Philox stream, random.SRAND_PHILOX(seed, stream),
+   // gives each agent or worker its own reproducible sequence.
    RANDOM randomSeed;
    Random random;
 
@@ -289,33 +482,32 @@ public:
       void init(Mona *mona);
       void clear();
 
-      // Identifier.
-      ID id;
+      // Fields are laid out hot first: those read or written for
+      // each neuron every cycle are packed at the start of the object
+      // to share a cache line, and rarely used fields follow them.
 
       // Neuron type.
       NEURON_TYPE type;
 
-      // Creation time.
-      TIME creationTime;
+      // Index of drive state in drive worker arrays.
+      int driveIndex;
 
       // Firing strength.
       ENABLEMENT firingStrength;
 
-      // Goal value.
-      GoalValue goals;
-
       // Motive.
       MOTIVE motive;
       bool   motiveValid;
-      void   drive(MotiveAccum);
-      void initDrive(VALUE_SET& needs);
-      void clearMotiveWork();
-      void setMotive();
+      void initDrive();
       void finalizeMotive();
 
-      MotiveAccum           motiveWork;
-      bool                  motiveWorkValid;
-      map<Neuron *, double> driveWeights;
+      // Changed since last checkpoint.
+      bool dirty;
+
+      // Invalidate goal value subsumption of parent mediators.
+      // Deferred while mediators are enabled in parallel.
+      void invalidateGoalSubsumption();
+      bool goalSubsumptionDeferred;
 
       // Instinct?
       bool instinct;
@@ -323,11 +515,52 @@ public:
       // Parent is instinct?
       bool hasParentInstinct();
 
+      // Neural network.
+      Mona *mona;
+
       // Event notification.
       vector<struct Notify *> notifyList;
+      void                    clearNotify();
 
-      // Neural network.
-      Mona *mona;
+      // Set firing strength, noting a change.
+      inline void setFiringStrength(ENABLEMENT strength)
+      {
+         if (firingStrength != strength)
+         {
+            firingStrength = strength;
+            dirty          = true;
+         }
+      }
+
+      // Drive weights to destinations.
+      map<Neuron *, double> driveWeights;
+
+      // Get drive weight to destination.
+      inline WEIGHT getDriveWeight(Neuron *neuron)
+      {
+         map<Neuron *, double>::iterator itr = driveWeights.find(neuron);
+
+         if (itr != driveWeights.end())
+         {
+            return(itr->second);
+         }
+         else
+         {
+            return(0.0);
+         }
+      }
+
+      // Goal value.
+      GoalValue goals;
+
+      // Identifier.
+      ID id;
+
+      // Creation time.
+      TIME creationTime;
+
+      // Dense index in network snapshot.
+      int snapshotIndex;
 
       // Load.
       void load(FILE *fp);
@@ -464,15 +697,48 @@ public:
       Mediator(ENABLEMENT enablement, Mona *mona);
       ~Mediator();
 
+      // Enabling and drive state is laid out first, followed by
+      // utility and goal value subsumption state.
+
       // Level 0 mediator is composed of non-mediator neurons.
       // Level n mediator is composed of at most level n-1 mediators.
       int level;
 
+      // Parallel enablement: effect notification state and
+      // order of serial effect notification.
+      int    enableOrder;
+      bool   effectNotified;
+      WEIGHT effectStrength;
+      void retireEnablings(bool force = false);
+
+      // Events.
+      Neuron *cause;
+      Neuron *response;
+      Neuron *effect;
+      void   addEvent(EVENT_TYPE, Neuron *);
+      void   setEvent(EVENT_TYPE, Neuron *);
+      void   addNotify(EVENT_TYPE, Neuron *);
+
       // Enablement.
       ENABLEMENT baseEnablement;
       ENABLEMENT getEnablement();
       void updateEnablement(EVENT_OUTCOME outcome,
                             WEIGHT        updateWeight);
+      void setEnablement(ENABLEMENT enablement);
+
+      // Time of causation.
+      TIME causeBegin;
+
+      // Enablings.
+      EnablingSet responseEnablings;
+      EnablingSet effectEnablings;
+
+      // Event firing.
+      void causeFiring(WEIGHT notifyStrength, TIME causeBegin);
+      void responseFiring(WEIGHT notifyStrength);
+      void effectFiring(WEIGHT notifyStrength);
+      WEIGHT fireEffect(WEIGHT notifyStrength,
+                        vector<GeneralizationEvent *>& generalizationEvents);
 
       // Effective enablement.
       ENABLEMENT effectiveEnablement;
@@ -480,6 +746,12 @@ public:
       bool       effectiveEnablementValid;
       void updateEffectiveEnablement();
 
+      // Is goal value subsumed by component?
+      // Cached until component goal values change.
+      bool goalValueSubsumed();
+      bool goalSubsumed;
+      bool goalSubsumedValid;
+
       // Utility.
       UTILITY utility;
       WEIGHT  utilityWeight;
@@ -489,31 +761,6 @@ public:
       // Update goal value.
       void updateGoalValue(VALUE_SET& needs);
 
-      // Is goal value subsumed by component?
-      bool goalValueSubsumed();
-
-      // Events.
-      Neuron *cause;
-      Neuron *response;
-      Neuron *effect;
-      void   addEvent(EVENT_TYPE, Neuron *);
-
-      // Enablings.
-      EnablingSet responseEnablings;
-      EnablingSet effectEnablings;
-
-      // Time of causation.
-      TIME causeBegin;
-
-      // Event firing.
-      void causeFiring(WEIGHT notifyStrength, TIME causeBegin);
-      void responseFiring(WEIGHT notifyStrength);
-      void effectFiring(WEIGHT notifyStrength);
-      void retireEnablings(bool force = false);
-
-      // Drive.
-      void driveCause(MotiveAccum);
-
       // Is given mediator a duplicate of this?
       bool isDuplicate(Mediator *);
 
@@ -558,6 +805,39 @@ public:
    Mediator *getWorstMediator(int minLevel = 0);
    Mediator *getBestMediator(int minLevel = 0);
 
+   // Memory accounting.
+   // Estimated bytes allocated for the network by category, counting
+   // object sizes, container capacities and container node overheads.
+   // Working buffers and allocator overhead are not counted.
+   // The running estimate, memoryEstimate, is kept as neurons and
+   // notifications are constructed and destroyed, without walking
+   // the network. It counts the neurons, their centroids and
+   // centroid tree nodes, goal values, and notifications with their
+   // drive weights; working memory, bounded by the effect event
+   // intervals, and container slack are not counted.
+   // With MAX_MEMORY_BYTES > 0, learning deletes mediators having the
+   // worst utilities until the running estimate is within the budget,
+   // as with MAX_MEDIATORS; 0 is unlimited.
+   // This is a run-time setting and is not saved.
+   enum MEMORY_CATEGORY
+   {
+      RECEPTOR_MEMORY,
+      CENTROID_MEMORY,
+      MOTOR_MEMORY,
+      MEDIATOR_MEMORY,
+      ENABLING_MEMORY,
+      LEARNING_EVENT_MEMORY,
+      RDTREE_MEMORY
+   };
+   enum { NUM_MEMORY_CATEGORIES=7 };
+   unsigned long long MAX_MEMORY_BYTES;
+   std::atomic<unsigned long long> memoryEstimate;
+   unsigned long long neuronMemoryEstimate(Neuron *neuron);
+   static unsigned long long notifyMemoryEstimate();
+   unsigned long long memoryUsage();
+   unsigned long long memoryUsage(vector<unsigned long long>& categories);
+   void printMemoryUsage(FILE *out = stdout);
+
    // Load network.
    bool load(char *filename);
    bool load(FILE *fp);
@@ -567,6 +847,147 @@ public:
    bool save(char *filename);
    bool save(FILE *fp);
 
+   // Asynchronous save handle.
+   // The descriptor becomes readable when the save completes,
+   // so it can be included in poll or select sets.
+   class SaveHandle
+   {
+public:
+      int  fd;
+      bool complete;
+      bool succeeded;
+
+      // Child process.
+      int pid;
+
+      // Constructor/destructor.
+      SaveHandle();
+      ~SaveHandle();
+
+      // Check for completion without blocking.
+      // A child that cannot be waited for, because SIGCHLD is
+      // ignored or it was reaped elsewhere, completes the save
+      // as failed.
+      bool done();
+
+      // Wait for completion, returning whether the save succeeded.
+      bool wait();
+   };
+
+   // Save network asynchronously.
+   // On POSIX systems a forked child process writes the copy-on-write
+   // image of the network at the time of the call while this process
+   // continues; the file is written under a temporary name and renamed
+   // when complete. Elsewhere the save is synchronous.
+   // The child only writes the file and exits without running exit
+   // handlers, leaving graphics and interpreter state alone. Programs
+   // with other threads that may hold locks (GLUT, OpenGL, Tcl) can set
+   // the preflight hook, which is called before forking; returning false
+   // makes the save synchronous.
+   // Unlike save, this does not begin a new chain of delta checkpoints.
+   // The caller deletes the handle, which waits for completion.
+   SaveHandle *saveAsync(char *filename);
+   bool       (*saveAsyncPreflight)(Mona *mona, void *client);
+   void       *saveAsyncClient;
+
+   // Incremental checkpoints.
+   // A full save or load begins a chain of checkpoints. Each delta
+   // saves the neurons added, deleted or changed since the previous
+   // checkpoint, plus working memory, and is applied in sequence
+   // to the network at the previous checkpoint.
+   bool saveDelta(char *filename);
+   bool saveDelta(FILE *fp);
+   bool loadDelta(char *filename);
+   bool loadDelta(FILE *fp);
+
+   // Fold a snapshot and its chain of deltas into a new snapshot.
+   bool compactCheckpoints(char *snapshot, vector<char *>& deltas, char *output);
+
+   // Clone network.
+   // The copy is made in memory with neuron references resolved
+   // through snapshot indices, and given the same inputs responds
+   // as this network would. Run-time settings are copied; the copy
+   // has its own threads and begins no chain of delta checkpoints.
+   // A copy sharing the configuration holds no sensor modes or
+   // effect event interval tables of its own, only its learned and
+   // working state; see the shared configuration. Sharing adds the
+   // base sensor mode to a network without sensor modes, as sensing
+   // would.
+   Mona *clone(bool shareConfiguration = false);
+
+   // Shared configuration.
+   // The sensor modes, compiled member modes and effect event
+   // interval tables of the network that a copy sharing its
+   // configuration was cloned from, or of that network's own
+   // configuration. The configuration network must outlive the
+   // networks sharing it, and its configuration must not change
+   // while they do. A sharing network cannot change it: adding
+   // sensor modes, setting their quantization, initializing the
+   // effect event intervals and loading fail, the last so that a
+   // network is loaded into a new network instead. The parameters,
+   // sensor mode views and centroid search trees are the network's
+   // own. NULL if the network owns its configuration.
+   Mona *configuration;
+
+   // Merge network.
+   // Folds what another network has learned into this one, such as
+   // a clone trained in other environments. Receptors match by centroid
+   // within their sensor mode's resolution, motors by response, and
+   // mediators by cause, response and effect after matching those.
+   // Matched neurons average their goal values weighted by goal update
+   // counts, and matched mediators their enablements and utilities
+   // weighted by utility weights, the accumulated firing updates; the
+   // counts and weights are summed, so networks forked from a common
+   // network count their shared history twice. Unmatched receptors are
+   // imported, and unmatched mediators a level at a time, best utility
+   // first, while there are fewer than MAX_MEDIATORS. Working memory,
+   // learning events and homeostat goals are not merged, nor are the
+   // other network's pending background mediators. Returns false, merging
+   // nothing, if the networks' sensors, responses, needs or sensor modes
+   // differ; a network without sensor modes or receptors takes the
+   // other's sensor modes. Ends a recording.
+   bool merge(const Mona& other);
+   Mediator *findMediator(Neuron *cause, Neuron *response, Neuron *effect);
+   void mergeGoals(Neuron *neuron, Neuron *otherNeuron);
+
+   // Record inputs.
+   // A recording begins with a snapshot of the network and its
+   // run-time settings, followed by its inputs in order: the sensors
+   // of each cycle with the resulting response, need and goal changes,
+   // response overrides and memory clearing. Replaying the inputs into
+   // the network loaded from the recording reproduces the responses.
+   // Loading or reinitializing the network ends the recording.
+   enum RECORD_TYPE
+   {
+      END_RECORD = 0,
+      CYCLE_RECORD,
+      NEED_RECORD,
+      INFLATE_NEED_RECORD,
+      PERIODIC_NEED_RECORD,
+      CLEAR_PERIODIC_NEED_RECORD,
+      GOAL_RECORD,
+      ENABLE_GOAL_RECORD,
+      DISABLE_GOAL_RECORD,
+      REMOVE_GOAL_RECORD,
+      OVERRIDE_RESPONSE_RECORD,
+      CLEAR_RESPONSE_OVERRIDE_RECORD,
+      CLEAR_WORKING_MEMORY_RECORD,
+      CLEAR_LONG_TERM_MEMORY_RECORD
+   };
+   bool startRecording(char *filename);
+   bool startRecording(FILE *fp);
+   bool stopRecording();
+   FILE *recordFile;
+   bool recordFileOwned;
+
+   // Replay recording.
+   // Load the network from the start of a recording, then replay
+   // its records one at a time, returning the record type, END_RECORD
+   // at the end of the recording, or -1 if the record is invalid.
+   // A replayed cycle matches if its response is the recorded one.
+   bool loadRecording(FILE *fp);
+   int replayRecord(FILE *fp, bool& match);
+
    // Clear network.
    void clear();
 
@@ -597,7 +1018,92 @@ public:
 #endif
 
 private:
+   // Construct network sharing a configuration.
+   Mona(Mona *configuration);
+
+   // Configuration storage, unused by a network sharing a configuration.
+   vector<vector<SENSOR_MODE> > ownSensorMemberModes;
+   vector<vector<TIME> >        ownEffectEventIntervals;
+   vector<vector<WEIGHT> >      ownEffectEventIntervalWeights;
+   vector<TIME>                 ownMaxLearningEffectEventIntervals;
+
    // Clear variables.
    void clearVars();
+
+   // Snapshot sections.
+   // A snapshot is a sequence of tagged sections, each a length-prefixed
+   // block written and read with a single I/O call. Neurons are stored
+   // as arrays by class with references as dense indices: receptors,
+   // then motors, then mediators.
+   enum SNAPSHOT_SECTION
+   {
+      END_SECTION            = 0,
+      PARAMETER_SECTION      = 1,
+      SENSOR_MODE_SECTION    = 2,
+      STATE_SECTION          = 3,
+      NEURON_SECTION         = 4,
+      LEARNING_EVENT_SECTION = 5,
+      HOMEOSTAT_SECTION      = 6,
+      CENTROID_SECTION       = 7,
+      CHECKPOINT_SECTION     = 8,
+      NEURON_DELTA_SECTION   = 9,
+      MOTIVE_SECTION         = 10
+   };
+   void numberNeurons();
+   bool saveSections(FILE *fp);
+   bool loadSections(FILE *fp);
+   void saveParameterSection(ByteBuffer& buffer);
+   bool loadParameterSection(ByteBuffer& buffer, bool init = true);
+   void saveSensorModeSection(ByteBuffer& buffer);
+   bool loadSensorModeSection(ByteBuffer& buffer);
+   void saveStateSection(ByteBuffer& buffer);
+   bool loadStateSection(ByteBuffer& buffer);
+   void saveNeuronSection(ByteBuffer& buffer);
+   bool loadNeuronSection(ByteBuffer& buffer, vector<Neuron *>& neurons);
+   void saveNeuronRecords(ByteBuffer& buffer, vector<Neuron *>& records,
+                          int numReceptors, int numMotors);
+   bool loadNeuronRecords(ByteBuffer& buffer, vector<Neuron *>& records,
+                          int numReceptors, int numMotors,
+                          vector<Neuron *>& neurons);
+   bool checkNotifications(vector<Neuron *>& neurons);
+   void saveLearningEventSection(ByteBuffer& buffer);
+   bool loadLearningEventSection(ByteBuffer& buffer, vector<Neuron *>& neurons);
+   void saveHomeostatSection(ByteBuffer& buffer);
+   bool loadHomeostatSection(ByteBuffer& buffer, vector<Neuron *>& neurons);
+   void saveCentroidSection(ByteBuffer& buffer);
+   bool loadCentroidSection(ByteBuffer& buffer, vector<Neuron *>& neurons);
+
+   // Delta checkpoint sections.
+   // A delta holds the checkpoint sequence, the full parameter,
+   // sensor mode, state, learning event and homeostat sections,
+   // the changed neuron records, the motives of all neurons, and
+   // the centroid trees if they changed.
+   static const int DELTA_SECTIONS[];
+   bool saveDeltaSections(FILE *fp);
+   bool loadDeltaSection(int tag, ByteBuffer& buffer, vector<Neuron *>& neurons);
+   void saveCheckpointSection(ByteBuffer& buffer);
+   bool loadCheckpointSection(ByteBuffer& buffer);
+   void saveNeuronDeltaSection(ByteBuffer& buffer);
+   bool loadNeuronDeltaSection(ByteBuffer& buffer, vector<Neuron *>& neurons);
+   void saveMotiveSection(ByteBuffer& buffer);
+   bool loadMotiveSection(ByteBuffer& buffer, vector<Neuron *>& neurons);
+
+   // Checkpoint tracking.
+   bool       checkpointBase;
+   int        checkpointSequence;
+   TIME       checkpointClock;
+   bool       centroidsDirty;
+   vector<ID> deletedNeurons;
+   void resetCheckpoint(int sequence);
+
+   // Clone neurons into network, returning its neurons
+   // in snapshot index order.
+   void cloneNeurons(Mona *mona, vector<Neuron *>& neurons);
+
+   // Write input records.
+   void recordCycle(vector<SENSOR>& sensors);
+   void recordInput(RECORD_TYPE type, int index, int value = 0, double amount = 0.0);
+   void recordGoal(int needIndex, vector<SENSOR>& sensors,
+                   SENSOR_MODE sensorMode, RESPONSE response, NEED goalValue);
 };
 #endif
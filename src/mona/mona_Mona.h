@@ -79,6 +79,22 @@ JNIEXPORT void JNICALL Java_mona_Mona_dispose
 JNIEXPORT jint JNICALL Java_mona_Mona_cycle
   (JNIEnv *, jobject, jint, jfloatArray);
 
+/*
+ * Class:     mona_Mona
+ * Method:    cycleBatchDirect
+ * Signature: ([ILjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)Z
+ */
+JNIEXPORT jboolean JNICALL Java_mona_Mona_cycleBatchDirect
+  (JNIEnv *, jclass, jintArray, jobject, jobject, jobject, jobject);
+
+/*
+ * Class:     mona_Mona
+ * Method:    cycleBatchArrays
+ * Signature: ([I[F[D[I[D)Z
+ */
+JNIEXPORT jboolean JNICALL Java_mona_Mona_cycleBatchArrays
+  (JNIEnv *, jclass, jintArray, jfloatArray, jdoubleArray, jintArray, jdoubleArray);
+
 /*
  * Class:     mona_Mona
  * Method:    addResponse
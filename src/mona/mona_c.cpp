@@ -0,0 +1,400 @@
+// Mona C interface implementation.
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+#include "mona_c.h"
+#include "population.hpp"
+
+// Handle conversions.
+static inline Mona *toMona(mona_t *mona)
+{
+   return((Mona *)mona);
+}
+
+
+static inline mona_t *toHandle(Mona *mona)
+{
+   return((mona_t *)mona);
+}
+
+
+static inline MonaPopulation *toPopulation(mona_population_t *population)
+{
+   return((MonaPopulation *)population);
+}
+
+
+// Validate handles.
+static bool validHandles(mona_t *const *monas, int count)
+{
+   if ((monas == NULL) || (count < 0))
+   {
+      return(false);
+   }
+   for (int i = 0; i < count; i++)
+   {
+      if (monas[i] == NULL)
+      {
+         return(false);
+      }
+   }
+   return(true);
+}
+
+
+int mona_abi_version(void)
+{
+   return(MONA_C_ABI_VERSION);
+}
+
+
+mona_t *mona_create(int num_sensors, int num_responses,
+                    int num_needs, int random_seed)
+{
+   Mona *mona = new Mona(num_sensors, num_responses,
+                         num_needs, (RANDOM)random_seed);
+
+   assert(mona != NULL);
+   return(toHandle(mona));
+}
+
+
+mona_t *mona_clone(mona_t *mona)
+{
+   if (mona != NULL)
+   {
+      return(toHandle(toMona(mona)->clone()));
+   }
+   else
+   {
+      return(NULL);
+   }
+}
+
+
+void mona_destroy(mona_t *mona)
+{
+   if (mona != NULL)
+   {
+      delete toMona(mona);
+   }
+}
+
+
+int mona_num_sensors(mona_t *mona)
+{
+   return((mona != NULL) ? toMona(mona)->numSensors : 0);
+}
+
+
+int mona_num_responses(mona_t *mona)
+{
+   return((mona != NULL) ? toMona(mona)->numResponses : 0);
+}
+
+
+int mona_num_needs(mona_t *mona)
+{
+   return((mona != NULL) ? toMona(mona)->numNeeds : 0);
+}
+
+
+int mona_set_sensor_resolution(mona_t *mona, float resolution)
+{
+   if ((mona != NULL) && toMona(mona)->setSensorResolution(resolution))
+   {
+      return(1);
+   }
+   else
+   {
+      return(0);
+   }
+}
+
+
+int mona_add_sensor_mode(mona_t *mona, const int *mask, float resolution)
+{
+   if ((mona != NULL) && (mask != NULL))
+   {
+      vector<bool> sensorMask(toMona(mona)->numSensors);
+      for (int i = 0; i < (int)sensorMask.size(); i++)
+      {
+         sensorMask[i] = (mask[i] != 0);
+      }
+      return(toMona(mona)->addSensorMode(sensorMask, resolution));
+   }
+   else
+   {
+      return(-1);
+   }
+}
+
+
+int mona_cycle(mona_t *mona, const float *sensors)
+{
+   if ((mona != NULL) && (sensors != NULL))
+   {
+      vector<Mona::SENSOR> s(sensors, sensors + toMona(mona)->numSensors);
+      return(toMona(mona)->cycle(s));
+   }
+   else
+   {
+      return(MONA_NULL_RESPONSE);
+   }
+}
+
+
+double mona_get_response_potential(mona_t *mona, int response)
+{
+   return((mona != NULL) ? toMona(mona)->getResponsePotential(response) : 0.0);
+}
+
+
+void mona_override_response(mona_t *mona, int response)
+{
+   if (mona != NULL)
+   {
+      toMona(mona)->overrideResponse(response);
+   }
+}
+
+
+void mona_clear_response_override(mona_t *mona)
+{
+   if (mona != NULL)
+   {
+      toMona(mona)->clearResponseOverride();
+   }
+}
+
+
+double mona_get_need(mona_t *mona, int index)
+{
+   if ((mona != NULL) && (index >= 0) && (index < toMona(mona)->numNeeds))
+   {
+      return(toMona(mona)->getNeed(index));
+   }
+   else
+   {
+      return(0.0);
+   }
+}
+
+
+void mona_set_need(mona_t *mona, int index, double value)
+{
+   if ((mona != NULL) && (index >= 0) && (index < toMona(mona)->numNeeds))
+   {
+      toMona(mona)->setNeed(index, value);
+   }
+}
+
+
+int mona_add_goal(mona_t *mona, int need_index, const float *sensors,
+                  int sensor_mode, int response, double goal_value)
+{
+   if ((mona != NULL) && (sensors != NULL) &&
+       toMona(mona)->isGoalValid(need_index, sensor_mode, response))
+   {
+      vector<Mona::SENSOR> s(sensors, sensors + toMona(mona)->numSensors);
+      return(toMona(mona)->addGoal(need_index, s, sensor_mode, response, goal_value));
+   }
+   else
+   {
+      return(-1);
+   }
+}
+
+
+int mona_remove_goal(mona_t *mona, int need_index, int goal_index)
+{
+   if ((mona != NULL) && (need_index >= 0) && (need_index < toMona(mona)->numNeeds) &&
+       toMona(mona)->removeGoal(need_index, goal_index))
+   {
+      return(1);
+   }
+   else
+   {
+      return(0);
+   }
+}
+
+
+void mona_clear_working_memory(mona_t *mona)
+{
+   if (mona != NULL)
+   {
+      toMona(mona)->clearWorkingMemory();
+   }
+}
+
+
+void mona_clear_long_term_memory(mona_t *mona)
+{
+   if (mona != NULL)
+   {
+      toMona(mona)->clearLongTermMemory();
+   }
+}
+
+
+int mona_load(mona_t *mona, const char *filename)
+{
+   if ((mona != NULL) && (filename != NULL) &&
+       toMona(mona)->load((char *)filename))
+   {
+      return(1);
+   }
+   else
+   {
+      return(0);
+   }
+}
+
+
+int mona_save(mona_t *mona, const char *filename)
+{
+   if ((mona != NULL) && (filename != NULL) &&
+       toMona(mona)->save((char *)filename))
+   {
+      return(1);
+   }
+   else
+   {
+      return(0);
+   }
+}
+
+
+int mona_merge(mona_t *mona, mona_t *other)
+{
+   if ((mona != NULL) && (other != NULL) && (mona != other))
+   {
+      toMona(other)->finishLearning();
+      if (toMona(mona)->merge(*toMona(other)))
+      {
+         return(1);
+      }
+   }
+   return(0);
+}
+
+
+int mona_cycle_many(mona_t *const *monas, int count,
+                    const float *sensors, int *responses)
+{
+   Mona *mona;
+
+   vector<Mona::SENSOR> s;
+
+   if (!validHandles(monas, count) || (sensors == NULL) || (responses == NULL))
+   {
+      return(-1);
+   }
+   for (int i = 0; i < count; i++)
+   {
+      mona = toMona(monas[i]);
+      s.assign(sensors, sensors + mona->numSensors);
+      sensors     += mona->numSensors;
+      responses[i] = mona->cycle(s);
+   }
+   return(0);
+}
+
+
+int mona_set_needs_many(mona_t *const *monas, int count, const double *needs)
+{
+   Mona *mona;
+
+   if (!validHandles(monas, count) || (needs == NULL))
+   {
+      return(-1);
+   }
+   for (int i = 0; i < count; i++)
+   {
+      mona = toMona(monas[i]);
+      for (int j = 0; j < mona->numNeeds; j++)
+      {
+         // Not NaN.
+         if (needs[j] == needs[j])
+         {
+            mona->setNeed(j, needs[j]);
+         }
+      }
+      needs += mona->numNeeds;
+   }
+   return(0);
+}
+
+
+int mona_get_potentials_many(mona_t *const *monas, int count, double *potentials)
+{
+   Mona *mona;
+
+   if (!validHandles(monas, count) || (potentials == NULL))
+   {
+      return(-1);
+   }
+   for (int i = 0; i < count; i++)
+   {
+      mona = toMona(monas[i]);
+      for (int j = 0; j < mona->numResponses; j++)
+      {
+         potentials[j] = mona->getResponsePotential(j);
+      }
+      potentials += mona->numResponses;
+   }
+   return(0);
+}
+
+
+mona_population_t *mona_population_create(mona_t *prototype, int num_agents,
+                                          int random_seed, int num_threads)
+{
+   if ((prototype == NULL) || (num_agents < 0))
+   {
+      return(NULL);
+   }
+   MonaPopulation *population = new MonaPopulation(toMona(prototype), num_agents,
+                                                   (RANDOM)random_seed, num_threads);
+   assert(population != NULL);
+   return((mona_population_t *)population);
+}
+
+
+void mona_population_destroy(mona_population_t *population)
+{
+   if (population != NULL)
+   {
+      delete toPopulation(population);
+   }
+}
+
+
+int mona_population_size(mona_population_t *population)
+{
+   return((population != NULL) ? toPopulation(population)->size() : 0);
+}
+
+
+mona_t *mona_population_agent(mona_population_t *population, int index)
+{
+   if ((population != NULL) && (index >= 0) &&
+       (index < toPopulation(population)->size()))
+   {
+      return(toHandle(toPopulation(population)->getAgent(index)));
+   }
+   else
+   {
+      return(NULL);
+   }
+}
+
+
+void mona_population_cycle(mona_population_t *population,
+                           const float *sensors, int *responses)
+{
+   if ((population != NULL) && (sensors != NULL) && (responses != NULL))
+   {
+      toPopulation(population)->cycleAll(sensors, responses);
+   }
+}
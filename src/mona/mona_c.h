@@ -0,0 +1,127 @@
+/*
+ * Mona C interface.
+ * For conditions of distribution and use, see copyright notice in mona.hpp
+ *
+ * A stable C ABI to the Mona library, for embedding in C programs
+ * and in foreign runtimes such as Python ctypes or Go cgo. Monas are
+ * opaque handles. Batch calls take arrays of handles with their
+ * values packed in handle order, each mona taking its own number of
+ * values, so that a whole population is driven in one call.
+ *
+ * A handle must not be used by two threads at once; different
+ * handles may be used concurrently.
+ */
+
+#ifndef __MONA_C__
+#define __MONA_C__
+
+#ifdef WIN32
+#define MONA_C_API    __declspec(dllexport)
+#else
+#define MONA_C_API    __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Interface version: incremented on incompatible changes. */
+#define MONA_C_ABI_VERSION    1
+
+/* Null response: goals for any response; no response override. */
+#define MONA_NULL_RESPONSE    0x7fffffff
+
+/* Opaque handles. */
+typedef struct mona_s              mona_t;
+typedef struct mona_population_s   mona_population_t;
+
+/* Interface version of the library. */
+MONA_C_API int mona_abi_version(void);
+
+/* Create/destroy. */
+MONA_C_API mona_t *mona_create(int num_sensors, int num_responses,
+                               int num_needs, int random_seed);
+MONA_C_API mona_t *mona_clone(mona_t *mona);
+MONA_C_API void mona_destroy(mona_t *mona);
+
+/* Dimensions. */
+MONA_C_API int mona_num_sensors(mona_t *mona);
+MONA_C_API int mona_num_responses(mona_t *mona);
+MONA_C_API int mona_num_needs(mona_t *mona);
+
+/* Sensor resolution, set before cycling: returns 1 on success, else 0. */
+MONA_C_API int mona_set_sensor_resolution(mona_t *mona, float resolution);
+
+/* Sensor modes: mask has num_sensors values, non-zero to include
+ * the sensor. Returns the mode, or -1. */
+MONA_C_API int mona_add_sensor_mode(mona_t *mona, const int *mask,
+                                    float resolution);
+
+/* Cycle: sensors has num_sensors values. Returns the response. */
+MONA_C_API int mona_cycle(mona_t *mona, const float *sensors);
+
+/* Responses. */
+MONA_C_API double mona_get_response_potential(mona_t *mona, int response);
+MONA_C_API void mona_override_response(mona_t *mona, int response);
+MONA_C_API void mona_clear_response_override(mona_t *mona);
+
+/* Needs: values in [0,1]. */
+MONA_C_API double mona_get_need(mona_t *mona, int index);
+MONA_C_API void mona_set_need(mona_t *mona, int index, double value);
+
+/* Goals: sensors has num_sensors values. Adding returns the goal
+ * index, or -1 if the need, sensor mode or response does not exist
+ * (response may be MONA_NULL_RESPONSE; a network without sensor modes
+ * has mode 0); removing returns 1 on success, else 0. */
+MONA_C_API int mona_add_goal(mona_t *mona, int need_index, const float *sensors,
+                             int sensor_mode, int response, double goal_value);
+MONA_C_API int mona_remove_goal(mona_t *mona, int need_index, int goal_index);
+
+/* Memory. */
+MONA_C_API void mona_clear_working_memory(mona_t *mona);
+MONA_C_API void mona_clear_long_term_memory(mona_t *mona);
+
+/* Load/save: returns 1 on success, else 0. */
+MONA_C_API int mona_load(mona_t *mona, const char *filename);
+MONA_C_API int mona_save(mona_t *mona, const char *filename);
+
+/* Merge what other has learned into mona, see Mona::merge:
+ * returns 1 on success, else 0. */
+MONA_C_API int mona_merge(mona_t *mona, mona_t *other);
+
+/* Batch calls.
+ * Each validates all of its handles before acting, returning 0 on
+ * success or -1, having done nothing, if a handle is NULL. */
+
+/* Cycle count monas: sensors are packed, responses has count values. */
+MONA_C_API int mona_cycle_many(mona_t *const *monas, int count,
+                               const float *sensors, int *responses);
+
+/* Set needs of count monas: needs are packed; NaN leaves a need unchanged. */
+MONA_C_API int mona_set_needs_many(mona_t *const *monas, int count,
+                                   const double *needs);
+
+/* Get response potentials of count monas, packed. */
+MONA_C_API int mona_get_potentials_many(mona_t *const *monas, int count,
+                                        double *potentials);
+
+/* Populations.
+ * Clones of a prototype cycled together across num_threads threads,
+ * each seeded with its own random stream. The population owns its
+ * agents, which may be used through the mona calls, but not destroyed. */
+MONA_C_API mona_population_t *mona_population_create(mona_t *prototype,
+                                                     int num_agents, int random_seed,
+                                                     int num_threads);
+MONA_C_API void mona_population_destroy(mona_population_t *population);
+MONA_C_API int mona_population_size(mona_population_t *population);
+MONA_C_API mona_t *mona_population_agent(mona_population_t *population, int index);
+
+/* Cycle all agents: sensors is size by num_sensors, responses has size values. */
+MONA_C_API void mona_population_cycle(mona_population_t *population,
+                                      const float *sensors, int *responses);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
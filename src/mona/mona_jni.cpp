@@ -182,6 +182,37 @@ JNIEXPORT jint JNICALL Java_mona_Mona_createMonaWithParameters(JNIEnv *env, jobj
       {
          mona->SENSOR_RESOLUTION = (Mona::SENSOR)atof(val);
       }
+      else if (strcmp(parm, "DRIVE_MOTIVE_EPSILON") == 0)
+      {
+         mona->DRIVE_MOTIVE_EPSILON = atof(val);
+      }
+      else if (strcmp(parm, "MAX_DRIVE_EDGES") == 0)
+      {
+         mona->MAX_DRIVE_EDGES = atoi(val);
+      }
+      else if (strcmp(parm, "DRIVE_THREADS") == 0)
+      {
+         mona->DRIVE_THREADS = atoi(val);
+      }
+      else if (strcmp(parm, "ENABLE_THREADS") == 0)
+      {
+         mona->ENABLE_THREADS = atoi(val);
+      }
+      else if (strcmp(parm, "LEARN_ASYNC") == 0)
+      {
+         if (strcmp(val, "true") == 0)
+         {
+            mona->LEARN_ASYNC = true;
+         }
+         else
+         {
+            mona->LEARN_ASYNC = false;
+         }
+      }
+      else if (strcmp(parm, "MAX_MEMORY_BYTES") == 0)
+      {
+         mona->MAX_MEMORY_BYTES = strtoull(val, NULL, 10);
+      }
 
       env->ReleaseStringUTFChars(jVal, val);
       env->ReleaseStringUTFChars(jParm, parm);
@@ -348,17 +379,12 @@ JNIEXPORT jint JNICALL Java_mona_Mona_cycle(
 
    if (mona != NULL)
    {
-      int    i;
-      jfloat *jsensors = env->GetFloatArrayElements(sensors, NULL);
-      assert(jsensors);
-      vector<float> s;
-      for (i = 0; i < mona->numSensors; i++)
+      vector<float> s(mona->numSensors);
+      if (mona->numSensors > 0)
       {
-         s.push_back(jsensors[i]);
+         env->GetFloatArrayRegion(sensors, 0, mona->numSensors, &s[0]);
       }
-      env->ReleaseFloatArrayElements(sensors, jsensors, 0);
-      i = mona->cycle(s);
-      return(i);
+      return(mona->cycle(s));
    }
    else
    {
@@ -367,6 +393,199 @@ JNIEXPORT jint JNICALL Java_mona_Mona_cycle(
 }
 
 
+// Cycle a batch of monas.
+// Sensors, needs and response potentials are packed by mona in
+// reference order, each mona taking its own number of values.
+// A NaN need is left unchanged; needs and potentials may be NULL.
+// Sizes are in values. Returns false, cycling none, if a reference
+// is invalid or a buffer is too small.
+static bool cycleBatch(jint *references, jsize count,
+                       jfloat *sensors, jlong sensorsSize,
+                       jdouble *needs, jlong needsSize,
+                       jint *responses, jlong responsesSize,
+                       jdouble *potentials, jlong potentialsSize)
+{
+   int   i, j;
+   Mona  *mona;
+   jlong numSensors, numNeeds, numPotentials;
+
+   vector<Mona::SENSOR> s;
+
+   // Validate.
+   numSensors = numNeeds = numPotentials = 0;
+   for (i = 0; i < count; i++)
+   {
+      if ((references[i] < 0) || (references[i] >= (jint)monaList.size()) ||
+          ((mona = monaList[references[i]]) == NULL))
+      {
+         return(false);
+      }
+      numSensors    += mona->numSensors;
+      numNeeds      += mona->numNeeds;
+      numPotentials += mona->numResponses;
+   }
+   if ((sensors == NULL) || (numSensors > sensorsSize) ||
+       ((needs != NULL) && (numNeeds > needsSize)) ||
+       (responses == NULL) || (count > responsesSize) ||
+       ((potentials != NULL) && (numPotentials > potentialsSize)))
+   {
+      return(false);
+   }
+
+   // Cycle.
+   for (i = 0; i < count; i++)
+   {
+      mona = monaList[references[i]];
+      if (needs != NULL)
+      {
+         for (j = 0; j < mona->numNeeds; j++)
+         {
+            // Not NaN.
+            if (needs[j] == needs[j])
+            {
+               mona->setNeed(j, needs[j]);
+            }
+         }
+         needs += mona->numNeeds;
+      }
+      s.assign(sensors, sensors + mona->numSensors);
+      sensors     += mona->numSensors;
+      responses[i] = mona->cycle(s);
+      if (potentials != NULL)
+      {
+         for (j = 0; j < mona->numResponses; j++)
+         {
+            potentials[j] = mona->getResponsePotential(j);
+         }
+         potentials += mona->numResponses;
+      }
+   }
+   return(true);
+}
+
+
+/*
+ * Class:     mona_Mona
+ * Method:    cycleBatchDirect
+ * Signature: ([ILjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;)Z
+ */
+JNIEXPORT jboolean JNICALL Java_mona_Mona_cycleBatchDirect(
+   JNIEnv *env, jclass monaClass, jintArray references, jobject sensors,
+   jobject needs, jobject responses, jobject potentials)
+{
+   jsize   count;
+   jfloat  *jsensors;
+   jdouble *jneeds, *jpotentials;
+   jint    *jresponses;
+   jlong   needsSize, potentialsSize;
+
+   vector<jint> jreferences;
+
+   // Direct buffers are used in place.
+   jsensors   = (jfloat *)env->GetDirectBufferAddress(sensors);
+   jresponses = (jint *)env->GetDirectBufferAddress(responses);
+   if ((jsensors == NULL) || (jresponses == NULL))
+   {
+      return(false);
+   }
+   jneeds      = NULL;
+   jpotentials = NULL;
+   needsSize   = potentialsSize = 0;
+   if (needs != NULL)
+   {
+      if ((jneeds = (jdouble *)env->GetDirectBufferAddress(needs)) == NULL)
+      {
+         return(false);
+      }
+      needsSize = env->GetDirectBufferCapacity(needs) / sizeof(jdouble);
+   }
+   if (potentials != NULL)
+   {
+      if ((jpotentials = (jdouble *)env->GetDirectBufferAddress(potentials)) == NULL)
+      {
+         return(false);
+      }
+      potentialsSize = env->GetDirectBufferCapacity(potentials) / sizeof(jdouble);
+   }
+   count = env->GetArrayLength(references);
+   if (count == 0)
+   {
+      return(true);
+   }
+   jreferences.resize(count);
+   env->GetIntArrayRegion(references, 0, count, &jreferences[0]);
+   return(cycleBatch(&jreferences[0], count,
+                     jsensors, env->GetDirectBufferCapacity(sensors) / sizeof(jfloat),
+                     jneeds, needsSize,
+                     jresponses, env->GetDirectBufferCapacity(responses) / sizeof(jint),
+                     jpotentials, potentialsSize));
+}
+
+
+/*
+ * Class:     mona_Mona
+ * Method:    cycleBatchArrays
+ * Signature: ([I[F[D[I[D)Z
+ */
+JNIEXPORT jboolean JNICALL Java_mona_Mona_cycleBatchArrays(
+   JNIEnv *env, jclass monaClass, jintArray references, jfloatArray sensors,
+   jdoubleArray needs, jintArray responses, jdoubleArray potentials)
+{
+   jsize    count, sensorsSize, needsSize, responsesSize, potentialsSize;
+   jint     *jreferences, *jresponses;
+   jfloat   *jsensors;
+   jdouble  *jneeds, *jpotentials;
+   jboolean ret;
+
+   // Get sizes before entering the critical region,
+   // where no other JNI calls are allowed.
+   count          = env->GetArrayLength(references);
+   sensorsSize    = env->GetArrayLength(sensors);
+   responsesSize  = env->GetArrayLength(responses);
+   needsSize      = (needs != NULL) ? env->GetArrayLength(needs) : 0;
+   potentialsSize = (potentials != NULL) ? env->GetArrayLength(potentials) : 0;
+
+   // Pin the arrays for the batch.
+   jreferences = (jint *)env->GetPrimitiveArrayCritical(references, NULL);
+   jsensors    = (jfloat *)env->GetPrimitiveArrayCritical(sensors, NULL);
+   jresponses  = (jint *)env->GetPrimitiveArrayCritical(responses, NULL);
+   jneeds      = (needs != NULL) ? (jdouble *)env->GetPrimitiveArrayCritical(needs, NULL) : NULL;
+   jpotentials = (potentials != NULL) ? (jdouble *)env->GetPrimitiveArrayCritical(potentials, NULL) : NULL;
+   ret         = false;
+   if ((jreferences != NULL) && (jsensors != NULL) && (jresponses != NULL) &&
+       ((needs == NULL) || (jneeds != NULL)) &&
+       ((potentials == NULL) || (jpotentials != NULL)))
+   {
+      ret = cycleBatch(jreferences, count, jsensors, sensorsSize,
+                       jneeds, needsSize, jresponses, responsesSize,
+                       jpotentials, potentialsSize);
+   }
+
+   // Release in reverse order, copying back only the outputs.
+   if (jpotentials != NULL)
+   {
+      env->ReleasePrimitiveArrayCritical(potentials, jpotentials, ret ? 0 : JNI_ABORT);
+   }
+   if (jneeds != NULL)
+   {
+      env->ReleasePrimitiveArrayCritical(needs, jneeds, JNI_ABORT);
+   }
+   if (jresponses != NULL)
+   {
+      env->ReleasePrimitiveArrayCritical(responses, jresponses, ret ? 0 : JNI_ABORT);
+   }
+   if (jsensors != NULL)
+   {
+      env->ReleasePrimitiveArrayCritical(sensors, jsensors, JNI_ABORT);
+   }
+   if (jreferences != NULL)
+   {
+      env->ReleasePrimitiveArrayCritical(references, jreferences, JNI_ABORT);
+   }
+   return(ret);
+}
+
+
 /*
  * Class:     mona_Mona
  * Method:    addResponse
@@ -0,0 +1,211 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+#include "population.hpp"
+
+// Constructor.
+MonaPopulation::MonaPopulation(Mona *prototype, int numAgents,
+                               RANDOM randomSeed, int numThreads)
+{
+   Mona *agent;
+
+   assert(prototype != NULL);
+   assert(numAgents >= 0);
+   numSensors     = prototype->numSensors;
+   numResponses   = prototype->numResponses;
+   CYCLE_THREADS  = numThreads;
+   cycleSensors   = NULL;
+   cycleResponses = NULL;
+   threadPool     = NULL;
+   configuration  = prototype->clone();
+   assert(configuration != NULL);
+   configuration->setLatencyMetrics(false);
+   setSerial(configuration);
+   agents.reserve(numAgents);
+   for (int i = 0; i < numAgents; i++)
+   {
+      agent = configuration->clone(true);
+      assert(agent != NULL);
+      agent->randomSeed = randomSeed;
+      agent->random.SRAND_PHILOX(randomSeed, (RANDOM)i);
+      agent->setLatencyMetrics(false);
+      setSerial(agent);
+      agents.push_back(agent);
+   }
+}
+
+
+// Destructor.
+MonaPopulation::~MonaPopulation()
+{
+   for (int i = 0; i < (int)agents.size(); i++)
+   {
+      delete agents[i];
+   }
+   agents.clear();
+   delete configuration;
+   configuration = NULL;
+   if (threadPool != NULL)
+   {
+      delete threadPool;
+      threadPool = NULL;
+   }
+}
+
+
+// Add agent, returning its index.
+int
+MonaPopulation::addAgent(Mona *agent)
+{
+   assert(agent != NULL);
+   assert(agent->numSensors == numSensors);
+   assert(agent->numResponses == numResponses);
+   setSerial(agent);
+   agents.push_back(agent);
+   return((int)agents.size() - 1);
+}
+
+
+// Replace agent, deleting the replaced agent.
+void
+MonaPopulation::replaceAgent(int index, Mona *agent)
+{
+   assert(index >= 0 && index < (int)agents.size());
+   assert(agent != NULL);
+   assert(agent->numSensors == numSensors);
+   assert(agent->numResponses == numResponses);
+   if (agents[index] != agent)
+   {
+      delete agents[index];
+      setSerial(agent);
+      agents[index] = agent;
+   }
+}
+
+
+// Set agent to cycle serially.
+// Parallelism is across agents: a thread pool or background
+// learning thread per agent would multiply threads by agents.
+void
+MonaPopulation::setSerial(Mona *agent)
+{
+   agent->finishLearning();
+   agent->LEARN_ASYNC    = false;
+   agent->DRIVE_THREADS  = 1;
+   agent->ENABLE_THREADS = 1;
+   if (agent->threadPool != NULL)
+   {
+      delete agent->threadPool;
+      agent->threadPool = NULL;
+   }
+}
+
+
+// Cycle all agents.
+void
+MonaPopulation::cycleAll(vector<SENSOR>& sensorMatrix, vector<RESPONSE>& responses)
+{
+   assert((int)sensorMatrix.size() == (int)agents.size() * numSensors);
+   responses.resize(agents.size());
+   if (agents.size() > 0)
+   {
+      cycleAll(&sensorMatrix[0], &responses[0]);
+   }
+}
+
+
+void
+MonaPopulation::cycleAll(const SENSOR *sensorMatrix, RESPONSE *responses)
+{
+   int numAgents, numTasks, numWorkers;
+
+   numAgents = (int)agents.size();
+   if (numAgents == 0)
+   {
+      return;
+   }
+   cycleSensors   = sensorMatrix;
+   cycleResponses = responses;
+   numTasks       = (numAgents + CYCLE_TASK_SIZE - 1) / CYCLE_TASK_SIZE;
+   numWorkers     = CYCLE_THREADS;
+   if (numWorkers > numTasks)
+   {
+      numWorkers = numTasks;
+   }
+   if (numWorkers < 1)
+   {
+      numWorkers = 1;
+   }
+   if ((int)workerSensors.size() < numWorkers)
+   {
+      workerSensors.resize(numWorkers);
+   }
+   if (numWorkers > 1)
+   {
+      getThreadPool(numWorkers)->run(cycleTask, this, numTasks, numWorkers);
+   }
+   else
+   {
+      for (int i = 0; i < numTasks; i++)
+      {
+         cycleTask(this, i, 0);
+      }
+   }
+   cycleSensors   = NULL;
+   cycleResponses = NULL;
+}
+
+
+// Cycle a task's agents.
+void
+MonaPopulation::cycleTask(void *population, int task, int worker)
+{
+   int            i, end;
+   MonaPopulation *p = (MonaPopulation *)population;
+
+   vector<SENSOR>& sensors = p->workerSensors[worker];
+   end = (task + 1) * CYCLE_TASK_SIZE;
+   if (end > (int)p->agents.size())
+   {
+      end = (int)p->agents.size();
+   }
+   for (i = task * CYCLE_TASK_SIZE; i < end; i++)
+   {
+      const SENSOR *row = &p->cycleSensors[(size_t)i * (size_t)p->numSensors];
+      sensors.assign(row, row + p->numSensors);
+      p->cycleResponses[i] = p->agents[i]->cycle(sensors);
+   }
+}
+
+
+// Get thread pool having at least the given number of threads.
+ThreadPool *
+MonaPopulation::getThreadPool(int numThreads)
+{
+   if ((threadPool != NULL) && (threadPool->size() < numThreads))
+   {
+      delete threadPool;
+      threadPool = NULL;
+   }
+   if (threadPool == NULL)
+   {
+      threadPool = new ThreadPool(numThreads);
+      assert(threadPool != NULL);
+   }
+   return(threadPool);
+}
+
+
+// Memory usage in bytes.
+unsigned long long
+MonaPopulation::memoryUsage()
+{
+   unsigned long long total;
+
+   total = sizeof(MonaPopulation) + agents.capacity() * sizeof(Mona *) +
+           sizeof(Mona) + configuration->memoryUsage();
+   for (int i = 0; i < (int)agents.size(); i++)
+   {
+      total += sizeof(Mona) + agents[i]->memoryUsage();
+   }
+   return(total);
+}
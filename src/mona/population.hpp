@@ -0,0 +1,84 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona population.
+ * Many agents cloned from a prototype network and cycled together
+ * across a thread pool.
+ */
+
+#ifndef __MONA_POPULATION__
+#define __MONA_POPULATION__
+
+#include "mona.hpp"
+
+// Mona population.
+class PUBLIC_API MonaPopulation
+{
+public:
+
+   // Data types.
+   typedef Mona::SENSOR     SENSOR;
+   typedef Mona::RESPONSE   RESPONSE;
+
+   // Constructor.
+   // Agents are clones of the prototype, each seeded with its own
+   // Philox stream of the random seed: the stream is the agent index.
+   // To keep agents small they share the configuration, a clone of
+   // the prototype holding its sensor modes and effect event interval
+   // tables, and their latency metrics are off; the cycle counts and
+   // activity counters remain. The prototype remains the caller's.
+   MonaPopulation(Mona *prototype, int numAgents,
+                  RANDOM randomSeed = Mona::DEFAULT_RANDOM_SEED,
+                  int numThreads    = 1);
+
+   // Destructor.
+   ~MonaPopulation();
+
+   // Agents.
+   // All agents have the same numbers of sensors and responses.
+   // An added or replaced agent is owned by the population and
+   // is cycled serially, as are the cloned agents. An agent sharing
+   // the configuration cannot load a network or change its sensor
+   // modes: load into a new network and replace the agent instead.
+   int numSensors;
+   int numResponses;
+   Mona           *configuration;
+   vector<Mona *> agents;
+   int size() { return((int)agents.size()); }
+   Mona *getAgent(int index) { return(agents[index]); }
+   int addAgent(Mona *agent);
+   void replaceAgent(int index, Mona *agent);
+
+   // Cycle all agents.
+   // Row i of the sensor matrix, numSensors wide, holds the sensors
+   // of agent i, and its response is returned in responses[i].
+   // With CYCLE_THREADS > 1 agents are claimed CYCLE_TASK_SIZE at a
+   // time by the threads of the pool as each finishes its previous
+   // claim, so threads with cheap agents take on more of them. Each
+   // agent is cycled by one thread, so the responses equal those of
+   // cycling the agents one at a time.
+   // This is a run-time setting.
+   enum { CYCLE_TASK_SIZE=16 };
+   int CYCLE_THREADS;
+   void cycleAll(vector<SENSOR>& sensorMatrix, vector<RESPONSE>& responses);
+   void cycleAll(const SENSOR *sensorMatrix, RESPONSE *responses);
+
+   // Memory usage in bytes, including the configuration.
+   unsigned long long memoryUsage();
+
+private:
+
+   // Cycle work.
+   const SENSOR            *cycleSensors;
+   RESPONSE                *cycleResponses;
+   vector<vector<SENSOR> > workerSensors;
+   static void cycleTask(void *population, int task, int worker);
+
+   // Thread pool.
+   ThreadPool *threadPool;
+   ThreadPool *getThreadPool(int numThreads);
+
+   // Set agent to cycle serially.
+   void setSerial(Mona *agent);
+};
+#endif
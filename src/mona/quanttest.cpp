@@ -0,0 +1,354 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona quantized sensor mode test.
+ *
+ * Usage: mona_quanttest
+ *      [-cycles <number of network cycles>]
+ *      [-directory <scratch directory>]
+ *
+ * Checks the 8 and 16 bit integer distance kernels against a scalar
+ * reference over many vector sizes, including extreme codes. Then runs
+ * networks with quantized sensor modes in lockstep with float mode
+ * networks on sensor values that are multiples of 1/scale: responses
+ * and needs must be identical every cycle, through a clone and a
+ * save and load, and a reloaded network must save byte-identically.
+ * Exits with status 1 on failure.
+ */
+
+#include "mona.hpp"
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_quanttest\n",
+   (char *)"      [-cycles <number of network cycles>]\n",
+   (char *)"      [-directory <scratch directory>]\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+// Network dimensions.
+#define NUM_SENSORS      6
+#define NUM_RESPONSES    3
+#define NUM_NEEDS        2
+
+// Largest kernel test vector: enough 8 bit codes to flush lane sums.
+#define MAX_KERNEL_SIZE    70000
+
+// Check kernels against scalar reference.
+bool checkKernels()
+{
+   int    i, n, t, bits, max, size, x, y;
+   double ref;
+   float  scale;
+
+   unsigned short      *codesA16, *codesB16;
+   Mona::SensorCodes   codesA, codesB;
+   Mona::SENSOR        dist;
+   Random              random(4517);
+
+   for (bits = 8; bits <= 16; bits += 8)
+   {
+      max = (bits == 8) ? 255 : 65535;
+      for (scale = 1.0f; scale <= 2.0f; scale += 1.0f)
+      {
+         for (size = 0; size <= 200; size++)
+         {
+            for (t = 0; t < 10; t++)
+            {
+               n = (size < 200) ? size : MAX_KERNEL_SIZE;
+               codesA.quantization = codesB.quantization = bits;
+               codesA.scale        = codesB.scale = scale;
+               codesA.size         = codesB.size = n;
+               codesA.codes.resize(n * bits / 8);
+               codesB.codes.resize(n * bits / 8);
+               codesA16 = (unsigned short *)&codesA.codes[0];
+               codesB16 = (unsigned short *)&codesB.codes[0];
+               ref      = 0.0;
+               for (i = 0; i < n; i++)
+               {
+                  // First trial uses extreme codes.
+                  if (t == 0)
+                  {
+                     x = ((i % 2) == 0) ? max : 0;
+                     y = max - x;
+                  }
+                  else
+                  {
+                     x = random.RAND_CHOICE(max + 1);
+                     y = random.RAND_CHOICE(max + 1);
+                  }
+                  if (bits == 8)
+                  {
+                     codesA.codes[i] = (unsigned char)x;
+                     codesB.codes[i] = (unsigned char)y;
+                  }
+                  else
+                  {
+                     codesA16[i] = (unsigned short)x;
+                     codesB16[i] = (unsigned short)y;
+                  }
+                  ref += (double)(x - y) * (double)(x - y);
+               }
+               ref  = ref / ((double)scale * (double)scale);
+               dist = Mona::SensorCodes::codeDistance(&codesA, &codesB);
+               if (dist != (Mona::SENSOR)ref)
+               {
+                  fprintf(stderr, "Kernel mismatch: %d bits, scale %f, size %d: %f, expected %f\n",
+                          bits, scale, n, dist, ref);
+                  return(false);
+               }
+            }
+         }
+      }
+   }
+   return(true);
+}
+
+
+// Create network with sensor modes of given quantization.
+Mona *createNetwork(int quantization, Mona::SENSOR scale)
+{
+   int  i, modes[3];
+   Mona *mona;
+
+   mona = new Mona(NUM_SENSORS, NUM_RESPONSES, NUM_NEEDS, 7);
+   assert(mona != NULL);
+   mona->MAX_MEDIATORS = 150;
+   vector<bool> mask(NUM_SENSORS, true);
+   modes[0] = mona->addSensorMode(mask, 0.0f);
+   mask[0]  = mask[1] = false;
+   modes[1] = mona->addSensorMode(mask, 0.0f);
+   mask.assign(NUM_SENSORS, false);
+   mask[0]  = mask[1] = mask[2] = true;
+   modes[2] = mona->addSensorMode(mask, 2.5f);
+   if (quantization != Mona::SensorMode::NO_QUANTIZATION)
+   {
+      for (i = 0; i < 3; i++)
+      {
+         if (!mona->setSensorModeQuantization(modes[i], quantization, scale))
+         {
+            fprintf(stderr, "Cannot set sensor mode quantization\n");
+            exit(1);
+         }
+      }
+   }
+   Random goalRandom(99);
+   vector<Mona::SENSOR> goal(NUM_SENSORS);
+   for (i = 0; i < 20; i++)
+   {
+      for (int j = 0; j < NUM_SENSORS; j++)
+      {
+         goal[j] = (Mona::SENSOR)goalRandom.RAND_CHOICE(3);
+      }
+      mona->addGoal(i % NUM_NEEDS, goal, i % NUM_RESPONSES, 0.2);
+   }
+   return(mona);
+}
+
+
+// Save and reload network.
+Mona *reload(Mona *mona, char *filename)
+{
+   Mona *loaded;
+
+   loaded = new Mona();
+   assert(loaded != NULL);
+   if (!mona->save(filename) || !loaded->load(filename))
+   {
+      fprintf(stderr, "Cannot save and load %s\n", filename);
+      exit(1);
+   }
+   delete mona;
+   return(loaded);
+}
+
+
+// Run quantized network in lockstep with float network.
+bool checkNetworks(int quantization, Mona::SENSOR scale, int cycles, char *directory)
+{
+   int  i, j, response;
+   Mona *floatMona, *quantMona;
+   bool pass;
+   char filename[BUFSIZ];
+
+   floatMona = createNetwork(Mona::SensorMode::NO_QUANTIZATION, 1.0f);
+   quantMona = createNetwork(quantization, scale);
+   Random sensorRandom(5);
+   vector<Mona::SENSOR> sensors(NUM_SENSORS);
+   pass = true;
+   for (i = 0; i < cycles && pass; i++)
+   {
+      // Sensor values are multiples of 1/scale.
+      for (j = 0; j < NUM_SENSORS; j++)
+      {
+         sensors[j] = (Mona::SENSOR)sensorRandom.RAND_CHOICE(4) +
+                      (Mona::SENSOR)sensorRandom.RAND_CHOICE((int)scale) / scale;
+      }
+      if ((i % 30) == 0)
+      {
+         floatMona->setNeed(0, 1.0);
+         floatMona->setNeed(1, 0.8);
+         quantMona->setNeed(0, 1.0);
+         quantMona->setNeed(1, 0.8);
+      }
+      response = floatMona->cycle(sensors);
+      if ((quantMona->cycle(sensors) != response) ||
+          (quantMona->getNeed(0) != floatMona->getNeed(0)) ||
+          (quantMona->getNeed(1) != floatMona->getNeed(1)) ||
+          (quantMona->receptors.size() != floatMona->receptors.size()))
+      {
+         fprintf(stderr, "%d bit scale %f network differs at cycle %d\n",
+                 quantization, scale, i);
+         pass = false;
+      }
+
+      // Continue from a clone, then from a reloaded snapshot.
+      if (i == cycles / 3)
+      {
+         Mona *mona = quantMona->clone();
+         delete quantMona;
+         quantMona = mona;
+      }
+      if (i == 2 * cycles / 3)
+      {
+         sprintf(filename, "%s/quanttest.mona", directory);
+         quantMona = reload(quantMona, filename);
+      }
+   }
+   delete floatMona;
+   delete quantMona;
+   return(pass);
+}
+
+
+// Check that a reloaded quantized network saves identically.
+bool checkSaveLoad(int cycles, char *directory)
+{
+   int  i, j, a, b;
+   Mona *mona;
+   char filenameA[BUFSIZ], filenameB[BUFSIZ];
+   bool pass;
+   FILE *fpA, *fpB;
+
+   mona = createNetwork(Mona::SensorMode::QUANTIZE_8, 2.0f);
+   Random sensorRandom(11);
+   vector<Mona::SENSOR> sensors(NUM_SENSORS);
+   for (i = 0; i < cycles; i++)
+   {
+      for (j = 0; j < NUM_SENSORS; j++)
+      {
+         sensors[j] = (Mona::SENSOR)sensorRandom.RAND_CHOICE(8) / 2.0f;
+      }
+      mona->cycle(sensors);
+   }
+   sprintf(filenameA, "%s/quanttest_a.mona", directory);
+   sprintf(filenameB, "%s/quanttest_b.mona", directory);
+   mona = reload(mona, filenameA);
+   if (!mona->save(filenameB))
+   {
+      fprintf(stderr, "Cannot save %s\n", filenameB);
+      exit(1);
+   }
+   delete mona;
+   pass = false;
+   if (((fpA = fopen(filenameA, "rb")) != NULL) &&
+       ((fpB = fopen(filenameB, "rb")) != NULL))
+   {
+      do
+      {
+         a = fgetc(fpA);
+         b = fgetc(fpB);
+      } while ((a == b) && (a != EOF));
+      pass = (a == b);
+      fclose(fpB);
+   }
+   if (fpA != NULL)
+   {
+      fclose(fpA);
+   }
+   if (!pass)
+   {
+      fprintf(stderr, "Reloaded quantized network saves differently\n");
+   }
+   remove(filenameA);
+   remove(filenameB);
+   return(pass);
+}
+
+
+int main(int argc, char *argv[])
+{
+   int  i, cycles;
+   char *directory;
+   char filename[BUFSIZ];
+   bool pass;
+
+   cycles    = 600;
+   directory = (char *)".";
+   for (i = 1; i < argc; i++)
+   {
+      if ((strcmp(argv[i], "-cycles") == 0) && (i + 1 < argc) &&
+          (atoi(argv[i + 1]) > 0))
+      {
+         i++;
+         cycles = atoi(argv[i]);
+         continue;
+      }
+      if ((strcmp(argv[i], "-directory") == 0) && (i + 1 < argc))
+      {
+         i++;
+         directory = argv[i];
+         continue;
+      }
+      printUsage();
+      exit(1);
+   }
+   pass = true;
+   if (checkKernels())
+   {
+      printf("Kernels match scalar reference\n");
+   }
+   else
+   {
+      pass = false;
+   }
+   if (checkNetworks(Mona::SensorMode::QUANTIZE_8, 1.0f, cycles, directory) &&
+       checkNetworks(Mona::SensorMode::QUANTIZE_16, 2.0f, cycles, directory) &&
+       checkNetworks(Mona::SensorMode::QUANTIZE_8, 2.0f, cycles, directory))
+   {
+      printf("Quantized networks match float networks for %d cycles\n", cycles);
+   }
+   else
+   {
+      pass = false;
+   }
+   sprintf(filename, "%s/quanttest.mona", directory);
+   remove(filename);
+   if (checkSaveLoad(cycles, directory))
+   {
+      printf("Reloaded quantized network saves identically\n");
+   }
+   else
+   {
+      pass = false;
+   }
+   if (pass)
+   {
+      printf("Pass\n");
+      exit(0);
+   }
+   else
+   {
+      printf("Fail\n");
+      exit(1);
+   }
+}
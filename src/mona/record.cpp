@@ -0,0 +1,309 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+#include "mona.hpp"
+
+// Start recording to file.
+bool
+Mona::startRecording(char *filename)
+{
+   FILE *fp;
+
+   if ((fp = FOPEN_WRITE(filename)) == NULL)
+   {
+      fprintf(stderr, "Cannot open recording file %s\n", filename);
+      return(false);
+   }
+   if (!startRecording(fp))
+   {
+      FCLOSE(fp);
+      return(false);
+   }
+   recordFileOwned = true;
+   return(true);
+}
+
+
+// Start recording.
+// The recording begins with the format, a snapshot of the
+// network and the run-time settings that the snapshot omits.
+bool
+Mona::startRecording(FILE *fp)
+{
+   int format;
+
+   stopRecording();
+
+   // Commit background learning.
+   finishLearning();
+
+   // Save format, including searchable string.
+   format = RECORDING_FORMAT;
+   FWRITE_INT(&format, fp);
+   char buf[40] = { 0 };
+   sprintf(buf, "%s(#) Mona recording format %d", "@", FORMAT);
+   FWRITE_STRING(buf, 40, fp);
+
+   // Save network snapshot.
+   format = FORMAT;
+   FWRITE_INT(&format, fp);
+   sprintf(buf, "%s(#) Mona format %d", "@", FORMAT);
+   FWRITE_STRING(buf, 40, fp);
+   if (!saveSections(fp))
+   {
+      return(false);
+   }
+
+   // Save run-time settings.
+   FWRITE_DOUBLE(&DRIVE_MOTIVE_EPSILON, fp);
+   FWRITE_INT(&MAX_DRIVE_EDGES, fp);
+   FWRITE_INT(&DRIVE_THREADS, fp);
+   FWRITE_INT(&ENABLE_THREADS, fp);
+   FWRITE_BOOL(&LEARN_ASYNC, fp);
+   FWRITE_LONG_LONG(&MAX_MEMORY_BYTES, fp);
+   FWRITE_DOUBLE(&maxMotive, fp);
+   if (ferror(fp))
+   {
+      fprintf(stderr, "Cannot write recording\n");
+      return(false);
+   }
+   recordFile      = fp;
+   recordFileOwned = false;
+   return(true);
+}
+
+
+// Stop recording.
+// A file opened by startRecording is closed.
+bool
+Mona::stopRecording()
+{
+   unsigned char type;
+   bool          ret;
+
+   if (recordFile == NULL)
+   {
+      return(true);
+   }
+   type = END_RECORD;
+   FWRITE_CHAR(&type, recordFile);
+   fflush(recordFile);
+   ret = (ferror(recordFile) == 0);
+   if (recordFileOwned)
+   {
+      FCLOSE(recordFile);
+   }
+   recordFile      = NULL;
+   recordFileOwned = false;
+   if (!ret)
+   {
+      fprintf(stderr, "Cannot write recording\n");
+   }
+   return(ret);
+}
+
+
+// Record cycle sensors and response.
+void
+Mona::recordCycle(vector<SENSOR>& sensors)
+{
+   unsigned char type;
+
+   type = CYCLE_RECORD;
+   FWRITE_CHAR(&type, recordFile);
+   FWRITE_BYTES((unsigned char *)&sensors[0], numSensors * sizeof(SENSOR), recordFile);
+   FWRITE_INT(&response, recordFile);
+}
+
+
+// Record need, goal, override or memory input.
+void
+Mona::recordInput(RECORD_TYPE type, int index, int value, double amount)
+{
+   unsigned char t;
+
+   t = (unsigned char)type;
+   FWRITE_CHAR(&t, recordFile);
+   FWRITE_INT(&index, recordFile);
+   FWRITE_INT(&value, recordFile);
+   FWRITE_DOUBLE(&amount, recordFile);
+}
+
+
+// Record goal.
+void
+Mona::recordGoal(int needIndex, vector<SENSOR>& sensors,
+                 SENSOR_MODE sensorMode, RESPONSE response, NEED goalValue)
+{
+   int           n;
+   unsigned char type;
+
+   type = GOAL_RECORD;
+   FWRITE_CHAR(&type, recordFile);
+   FWRITE_INT(&needIndex, recordFile);
+   n = (int)sensors.size();
+   FWRITE_INT(&n, recordFile);
+   FWRITE_BYTES((unsigned char *)&sensors[0], n * sizeof(SENSOR), recordFile);
+   FWRITE_INT(&sensorMode, recordFile);
+   FWRITE_INT(&response, recordFile);
+   FWRITE_DOUBLE(&goalValue, recordFile);
+}
+
+
+// Load network and run-time settings from the start of a recording.
+bool
+Mona::loadRecording(FILE *fp)
+{
+   int format;
+
+   // Check format compatibility.
+   if ((FREAD_INT(&format, fp) != 1) || (format != RECORDING_FORMAT))
+   {
+      fprintf(stderr, "File format %d is incompatible with expected format %d\n", format, RECORDING_FORMAT);
+      return(false);
+   }
+   char buf[40];
+   FREAD_STRING(buf, 40, fp);
+
+   if (!load(fp))
+   {
+      return(false);
+   }
+   FREAD_DOUBLE(&DRIVE_MOTIVE_EPSILON, fp);
+   FREAD_INT(&MAX_DRIVE_EDGES, fp);
+   FREAD_INT(&DRIVE_THREADS, fp);
+   FREAD_INT(&ENABLE_THREADS, fp);
+   FREAD_BOOL(&LEARN_ASYNC, fp);
+   FREAD_LONG_LONG(&MAX_MEMORY_BYTES, fp);
+   if (FREAD_DOUBLE(&maxMotive, fp) != 1)
+   {
+      fprintf(stderr, "Truncated recording\n");
+      return(false);
+   }
+   return(true);
+}
+
+
+// Replay record.
+int
+Mona::replayRecord(FILE *fp, bool& match)
+{
+   int           i, index, value;
+   double        amount;
+   unsigned char type;
+
+   vector<SENSOR> sensors;
+
+   match = true;
+   if (FREAD_CHAR(&type, fp) != 1)
+   {
+      // A recording not stopped ends with its last complete record.
+      return(END_RECORD);
+   }
+   switch (type)
+   {
+   case END_RECORD:
+      return(END_RECORD);
+
+   case CYCLE_RECORD:
+      sensors.resize(numSensors);
+      if ((FREAD_BYTES((unsigned char *)&sensors[0], numSensors * sizeof(SENSOR), fp) != 1) ||
+          (FREAD_INT(&value, fp) != 1))
+      {
+         break;
+      }
+      match = (cycle(sensors) == value);
+      return(type);
+
+   case GOAL_RECORD:
+      if ((FREAD_INT(&index, fp) != 1) || (FREAD_INT(&i, fp) != 1) ||
+          (index < 0) || (index >= numNeeds) || (i != numSensors))
+      {
+         break;
+      }
+      sensors.resize(numSensors);
+      if ((FREAD_BYTES((unsigned char *)&sensors[0], numSensors * sizeof(SENSOR), fp) != 1) ||
+          (FREAD_INT(&i, fp) != 1) || (FREAD_INT(&value, fp) != 1) ||
+          (FREAD_DOUBLE(&amount, fp) != 1) ||
+          (i < 0) || ((i > 0) && (i >= (int)sensorModes.size())) ||
+          (((value < 0) || (value >= numResponses)) && (value != NULL_RESPONSE)))
+      {
+         break;
+      }
+      addGoal(index, sensors, i, value, amount);
+      return(type);
+
+   default:
+      if ((type > CLEAR_LONG_TERM_MEMORY_RECORD) ||
+          (FREAD_INT(&index, fp) != 1) || (FREAD_INT(&value, fp) != 1) ||
+          (FREAD_DOUBLE(&amount, fp) != 1))
+      {
+         break;
+      }
+      if ((type < OVERRIDE_RESPONSE_RECORD) &&
+          ((index < 0) || (index >= numNeeds)))
+      {
+         break;
+      }
+      if (((type == NEED_RECORD) || (type == PERIODIC_NEED_RECORD)) &&
+          ((amount < 0.0) || (amount > 1.0)))
+      {
+         break;
+      }
+      switch (type)
+      {
+      case NEED_RECORD:
+         setNeed(index, amount);
+         break;
+
+      case INFLATE_NEED_RECORD:
+         inflateNeed(index);
+         break;
+
+      case PERIODIC_NEED_RECORD:
+         setPeriodicNeed(index, value, amount);
+         break;
+
+      case CLEAR_PERIODIC_NEED_RECORD:
+         clearPeriodicNeed(index);
+         break;
+
+      case ENABLE_GOAL_RECORD:
+         enableGoal(index, value);
+         break;
+
+      case DISABLE_GOAL_RECORD:
+         disableGoal(index, value);
+         break;
+
+      case REMOVE_GOAL_RECORD:
+         removeGoal(index, value);
+         break;
+
+      case OVERRIDE_RESPONSE_RECORD:
+         if (amount >= 0.0)
+         {
+            overrideResponseConditional(index, amount);
+         }
+         else
+         {
+            overrideResponse(index);
+         }
+         break;
+
+      case CLEAR_RESPONSE_OVERRIDE_RECORD:
+         clearResponseOverride();
+         break;
+
+      case CLEAR_WORKING_MEMORY_RECORD:
+         clearWorkingMemory();
+         break;
+
+      case CLEAR_LONG_TERM_MEMORY_RECORD:
+         clearLongTermMemory();
+         break;
+      }
+      return(type);
+   }
+   fprintf(stderr, "Invalid recording record\n");
+   return(-1);
+}
@@ -0,0 +1,189 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona recording replay.
+ *
+ * Usage: mona_replay
+ *      [-cycles <maximum number of cycles>]
+ *      [-driveThreads <number of drive threads>]
+ *      [-enableThreads <number of enable threads>]
+ *      [-learnAsync (learn in background)]
+ *      [-save <save file name>]
+ *      <recording file name>
+ *
+ * Loads the network from a recording made with Mona::startRecording,
+ * then feeds the recorded inputs through cycle() as fast as possible.
+ * Reports the replay time and the number of cycles whose response
+ * differs from the recorded response, exiting with status 1 if any do.
+ * The replayed network can be saved, for example to pretrain offline.
+ */
+
+#include "mona.hpp"
+#include "../common/gettime.h"
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_replay\n",
+   (char *)"      [-cycles <maximum number of cycles>]\n",
+   (char *)"      [-driveThreads <number of drive threads>]\n",
+   (char *)"      [-enableThreads <number of enable threads>]\n",
+   (char *)"      [-learnAsync (learn in background)]\n",
+   (char *)"      [-save <save file name>]\n",
+   (char *)"      <recording file name>\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+int main(int argc, char *argv[])
+{
+   int  i, type, maxCycles, driveThreads, enableThreads;
+   int  cycles, records, mismatches;
+   bool learnAsync, match;
+   char *recordingFile, *saveFile;
+   FILE *fp;
+   Mona *mona;
+
+   unsigned long long startTime, replayTime;
+
+   maxCycles     = -1;
+   driveThreads  = enableThreads = -1;
+   learnAsync    = false;
+   recordingFile = saveFile = NULL;
+   for (i = 1; i < argc; i++)
+   {
+      if ((strcmp(argv[i], "-cycles") == 0) ||
+          (strcmp(argv[i], "-driveThreads") == 0) ||
+          (strcmp(argv[i], "-enableThreads") == 0))
+      {
+         if ((i + 1 >= argc) || (atoi(argv[i + 1]) <= 0))
+         {
+            printUsage();
+            exit(1);
+         }
+         if (strcmp(argv[i], "-cycles") == 0)
+         {
+            maxCycles = atoi(argv[i + 1]);
+         }
+         else if (strcmp(argv[i], "-driveThreads") == 0)
+         {
+            driveThreads = atoi(argv[i + 1]);
+         }
+         else
+         {
+            enableThreads = atoi(argv[i + 1]);
+         }
+         i++;
+         continue;
+      }
+      if (strcmp(argv[i], "-learnAsync") == 0)
+      {
+         learnAsync = true;
+         continue;
+      }
+      if (strcmp(argv[i], "-save") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         saveFile = argv[i];
+         continue;
+      }
+      if ((argv[i][0] == '-') || (recordingFile != NULL))
+      {
+         printUsage();
+         exit(1);
+      }
+      recordingFile = argv[i];
+   }
+   if (recordingFile == NULL)
+   {
+      printUsage();
+      exit(1);
+   }
+
+   // Load network from recording.
+   if ((fp = FOPEN_READ(recordingFile)) == NULL)
+   {
+      fprintf(stderr, "Cannot open recording file %s\n", recordingFile);
+      exit(1);
+   }
+   mona = new Mona();
+   assert(mona != NULL);
+   if (!mona->loadRecording(fp))
+   {
+      fprintf(stderr, "Cannot load recording file %s\n", recordingFile);
+      exit(1);
+   }
+   if (driveThreads != -1)
+   {
+      mona->DRIVE_THREADS = driveThreads;
+   }
+   if (enableThreads != -1)
+   {
+      mona->ENABLE_THREADS = enableThreads;
+   }
+   if (learnAsync)
+   {
+      mona->LEARN_ASYNC = true;
+   }
+
+   // Replay.
+   cycles    = records = mismatches = 0;
+   type      = Mona::END_RECORD;
+   startTime = gettime();
+   while (cycles != maxCycles)
+   {
+      if ((type = mona->replayRecord(fp, match)) <= Mona::END_RECORD)
+      {
+         break;
+      }
+      records++;
+      if (type == Mona::CYCLE_RECORD)
+      {
+         cycles++;
+         if (!match)
+         {
+            mismatches++;
+         }
+      }
+   }
+   replayTime = gettime() - startTime;
+   FCLOSE(fp);
+   printf("Cycles: %d\n", cycles);
+   printf("Records: %d\n", records);
+   printf("Response mismatches: %d\n", mismatches);
+   printf("Replay time: %llu ms", replayTime);
+   if (replayTime > 0)
+   {
+      printf(" (%.1f cycles/second)", (double)cycles * 1000.0 / (double)replayTime);
+   }
+   printf("\n");
+   if (type == -1)
+   {
+      exit(1);
+   }
+
+   // Save?
+   if ((saveFile != NULL) && !mona->save(saveFile))
+   {
+      fprintf(stderr, "Cannot save to file %s\n", saveFile);
+      exit(1);
+   }
+   delete mona;
+   if (mismatches > 0)
+   {
+      exit(1);
+   }
+   return(0);
+}
@@ -116,7 +116,7 @@ Mona::respond()
       motor = motors[i];
       if (motor->response == response)
       {
-         motor->firingStrength = 1.0;
+         motor->setFiringStrength(1.0);
 
 #ifdef MONA_TRACE
          if (traceRespond)
@@ -127,10 +127,11 @@ Mona::respond()
 #ifdef MONA_TRACKING
          motor->tracker.fire = true;
 #endif
+         traceEvent(FIRE_EVENT, MOTOR, motor->id, 1.0);
       }
       else
       {
-         motor->firingStrength = 0.0;
+         motor->setFiringStrength(0.0);
       }
    }
 
@@ -184,6 +185,10 @@ Mona::RESPONSE_POTENTIAL Mona::getResponsePotential(RESPONSE response)
 // Auto-cleared each cycle.
 bool Mona::overrideResponse(RESPONSE responseOverride)
 {
+   if (recordFile != NULL)
+   {
+      recordInput(OVERRIDE_RESPONSE_RECORD, responseOverride, 0, -1.0);
+   }
    if ((responseOverride >= 0) && (responseOverride < numResponses))
    {
       this->responseOverride    = responseOverride;
@@ -202,6 +207,11 @@ bool Mona::overrideResponse(RESPONSE responseOverride)
 bool Mona::overrideResponseConditional(RESPONSE           responseOverride,
                                        RESPONSE_POTENTIAL responseOverridePotential)
 {
+   if (recordFile != NULL)
+   {
+      recordInput(OVERRIDE_RESPONSE_RECORD, responseOverride, 0,
+                  responseOverridePotential);
+   }
    if ((responseOverride >= 0) && (responseOverride < numResponses))
    {
       this->responseOverride          = responseOverride;
@@ -218,6 +228,10 @@ bool Mona::overrideResponseConditional(RESPONSE           responseOverride,
 // Clear response override.
 void Mona::clearResponseOverride()
 {
+   if (recordFile != NULL)
+   {
+      recordInput(CLEAR_RESPONSE_OVERRIDE_RECORD, 0);
+   }
    responseOverride          = NULL_RESPONSE;
    responseOverridePotential = -1.0;
 }
@@ -0,0 +1,212 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona asynchronous save test.
+ *
+ * Usage: mona_savetest
+ *      [-cycles <number of training cycles>]
+ *      [-directory <scratch directory>]
+ *
+ * Trains a network on random sensors, then at the same cycle saves it
+ * with saveAsync and with save, and goes on cycling while the forked
+ * child writes. The two snapshots must be byte-identical. Then, with
+ * SIGCHLD ignored so that the system reaps the child, polling done()
+ * on another asynchronous save must complete. Exits with status 1 on
+ * failure.
+ */
+
+#include "mona.hpp"
+#include "../common/gettime.h"
+#ifndef WIN32
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_savetest\n",
+   (char *)"      [-cycles <number of training cycles>]\n",
+   (char *)"      [-directory <scratch directory>]\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+// Network dimensions.
+#define NUM_SENSORS      8
+#define NUM_RESPONSES    3
+#define NUM_NEEDS        1
+
+// Seconds to poll a save for completion.
+#define POLL_SECONDS     60
+
+// Cycle network on random sensors.
+void train(Mona *mona, Random& random, int cycles)
+{
+   vector<Mona::SENSOR> sensors(NUM_SENSORS);
+
+   for (int i = 0; i < cycles; i++)
+   {
+      for (int j = 0; j < NUM_SENSORS; j++)
+      {
+         sensors[j] = (Mona::SENSOR)random.RAND_CHOICE(2);
+      }
+      if ((mona->eventClock % 40) == 0)
+      {
+         mona->setNeed(0, 1.0);
+      }
+      mona->cycle(sensors);
+   }
+}
+
+
+// Read file.
+bool readFile(char *filename, vector<unsigned char>& bytes)
+{
+   FILE *fp;
+   int  c;
+
+   bytes.clear();
+   if ((fp = fopen(filename, "rb")) == NULL)
+   {
+      return(false);
+   }
+   while ((c = fgetc(fp)) != EOF)
+   {
+      bytes.push_back((unsigned char)c);
+   }
+   fclose(fp);
+   return(true);
+}
+
+
+// Poll save for completion.
+bool pollSave(Mona::SaveHandle *handle)
+{
+   TIME start = gettime();
+
+   while (!handle->done())
+   {
+      if (gettime() - start > POLL_SECONDS * 1000)
+      {
+         return(false);
+      }
+#ifndef WIN32
+      usleep(1000);
+#endif
+   }
+   return(true);
+}
+
+
+int main(int argc, char *argv[])
+{
+   int    i, cycles;
+   char   *directory;
+   char   asyncFile[BUFSIZ], syncFile[BUFSIZ];
+   bool   pass;
+   Mona   *mona;
+   Random random(4517);
+
+   Mona::SaveHandle      *handle;
+   vector<unsigned char> asyncBytes, syncBytes;
+
+   cycles    = 1000;
+   directory = (char *)".";
+   for (i = 1; i < argc; i++)
+   {
+      if ((strcmp(argv[i], "-cycles") == 0) && (i + 1 < argc) &&
+          (atoi(argv[i + 1]) > 0))
+      {
+         i++;
+         cycles = atoi(argv[i]);
+         continue;
+      }
+      if ((strcmp(argv[i], "-directory") == 0) && (i + 1 < argc))
+      {
+         i++;
+         directory = argv[i];
+         continue;
+      }
+      printUsage();
+      exit(1);
+   }
+   sprintf(asyncFile, "%s/savetest_async.mona", directory);
+   sprintf(syncFile, "%s/savetest_sync.mona", directory);
+
+   // Train network.
+   mona = new Mona(NUM_SENSORS, NUM_RESPONSES, NUM_NEEDS);
+   assert(mona != NULL);
+   vector<Mona::SENSOR> goal(NUM_SENSORS, 1.0f);
+   mona->addGoal(0, goal, 0, 0.5);
+   train(mona, random, cycles);
+
+   // Save both ways at the same cycle, then cycle while the child writes.
+   pass   = true;
+   handle = mona->saveAsync(asyncFile);
+   if (!mona->save(syncFile))
+   {
+      fprintf(stderr, "Cannot save %s\n", syncFile);
+      pass = false;
+   }
+   train(mona, random, 100);
+   if (!pollSave(handle) || !handle->succeeded)
+   {
+      fprintf(stderr, "Asynchronous save failed\n");
+      pass = false;
+   }
+   delete handle;
+   if (!readFile(asyncFile, asyncBytes) || !readFile(syncFile, syncBytes))
+   {
+      fprintf(stderr, "Cannot read snapshots\n");
+      pass = false;
+   }
+   else if (asyncBytes != syncBytes)
+   {
+      fprintf(stderr, "Snapshots differ: %d and %d bytes\n",
+              (int)asyncBytes.size(), (int)syncBytes.size());
+      pass = false;
+   }
+   else
+   {
+      printf("Snapshots identical: %d bytes at cycle %d\n", (int)syncBytes.size(), cycles);
+   }
+
+#ifndef WIN32
+   // With the child reaped by the system, polling must still complete.
+   signal(SIGCHLD, SIG_IGN);
+   handle = mona->saveAsync(asyncFile);
+   if (!pollSave(handle))
+   {
+      fprintf(stderr, "Polling a save with SIGCHLD ignored did not complete\n");
+      pass = false;
+   }
+   else
+   {
+      printf("Polling with SIGCHLD ignored completed\n");
+   }
+   delete handle;
+   signal(SIGCHLD, SIG_DFL);
+#endif
+
+   remove(asyncFile);
+   remove(syncFile);
+   delete mona;
+   if (pass)
+   {
+      printf("Pass\n");
+      exit(0);
+   }
+   else
+   {
+      printf("Fail\n");
+      exit(1);
+   }
+}
@@ -1,6 +1,9 @@
 // For conditions of distribution and use, see copyright notice in mona.hpp
 
 #include "mona.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 // Sense environment.
 void
@@ -9,11 +12,11 @@ Mona::sense()
    int         i, j;
    SENSOR_MODE sensorMode;
 
-   vector<SENSOR>     sensorsWork;
    Receptor           *receptor;
    SENSOR             distance;
    bool               addReceptor;
    vector<Receptor *> oldReceptorSet, newReceptorSet;
+   COUNTER            distances;
 
 #ifdef MONA_TRACE
    if (traceSense)
@@ -28,38 +31,74 @@ Mona::sense()
    }
 #endif
 
-   // Update need based on sensors.
-   for (i = 0; i < numNeeds; i++)
-   {
-      homeostats[i]->sensorsUpdate();
-   }
-
    // Clear receptor firings.
    for (i = 0; i < (int)receptors.size(); i++)
    {
       receptor = receptors[i];
-      receptor->firingStrength = 0.0;
+      receptor->setFiringStrength(0.0);
    }
 
-   // Add base sensor mode?
+   // Add base sensor mode, or take the shared sensor modes after clearing?
    if (sensorModes.size() == 0)
    {
-      vector<bool> mask;
-      for (i = 0; i < numSensors; i++)
+      if (configuration != NULL)
       {
-         mask.push_back(true);
+         sensorModes = configuration->sensorModes;
+         assert(sensorModes.size() > 0);
+         for (i = (int)sensorCentroids.size(); i < (int)sensorModes.size(); i++)
+         {
+            sensorCentroids.push_back(newCentroidTree(i));
+         }
+         centroidsDirty = true;
+         compileSensorModes();
+      }
+      else
+      {
+         vector<bool> mask;
+         for (i = 0; i < numSensors; i++)
+         {
+            mask.push_back(true);
+         }
+         addSensorMode(mask);
+      }
+   }
+
+   // Find receptors matching sensor modes.
+   distances = 0;
+   for (i = 0; i < (int)sensorCentroids.size(); i++)
+   {
+      distances += sensorCentroids[i]->distanceCount;
+   }
+
+   // Gather the sensors into the sensor mode views in one pass.
+   if (sensorModeViews.size() != sensorModes.size())
+   {
+      compileSensorModes();
+   }
+   for (i = 0; i < numSensors; i++)
+   {
+      vector<SENSOR_MODE>& modes = sensorMemberModes[i];
+      for (j = 0; j < (int)modes.size(); j++)
+      {
+         sensorModeViews[modes[j]][i] = sensors[i];
       }
-      addSensorMode(mask);
    }
 
-   // Fire receptors matching sensor modes.
+   // Look up the closest receptors for all modes.
+   senseReceptors.resize(sensorModes.size());
+   senseDistances.resize(sensorModes.size());
    for (sensorMode = 0; sensorMode < (int)sensorModes.size(); sensorMode++)
    {
-      // Apply sensor mode to sensors.
-      applySensorMode(sensors, sensorsWork, sensorMode);
+      senseReceptors[sensorMode] = getCentroidReceptor(sensorModeViews[sensorMode], sensorMode,
+                                                       senseDistances[sensorMode]);
+   }
 
-      // Get firing receptor based on sensor vector and mode.
-      receptor = getCentroidReceptor(sensorsWork, sensorMode, distance);
+   // Create receptors for novel stimuli and link them by sensor mode.
+   for (sensorMode = 0; sensorMode < (int)sensorModes.size(); sensorMode++)
+   {
+      receptor = senseReceptors[sensorMode];
+      distance = senseDistances[sensorMode];
+      vector<char>& relations = sensorModes[sensorMode]->relations;
 
       // Create a receptor that matches sensor vector?
       addReceptor = false;
@@ -67,8 +106,9 @@ Mona::sense()
                                  (distance > sensorModes[sensorMode]->resolution) &&
                                  (distance > NEARLY_ZERO)))
       {
-         receptor    = newReceptor(sensorsWork, sensorMode);
+         receptor    = newReceptor(sensorModeViews[sensorMode], sensorMode);
          addReceptor = true;
+         senseReceptors[sensorMode] = receptor;
       }
 
       // Incorporate into sensor mode sets.
@@ -76,53 +116,37 @@ Mona::sense()
       {
          for (i = 0; i < (int)oldReceptorSet.size(); i++)
          {
-            for (j = 0; j < (int)sensorModes[sensorMode]->subsets.size(); j++)
-            {
-               if (oldReceptorSet[i]->sensorMode == sensorModes[sensorMode]->subsets[j])
-               {
-                  receptor->subSensorModes.push_back(oldReceptorSet[i]);
-                  oldReceptorSet[i]->superSensorModes.push_back(receptor);
-                  break;
-               }
-            }
-            if (j < (int)sensorModes[sensorMode]->subsets.size())
-            {
-               continue;
-            }
-            for (j = 0; j < (int)sensorModes[sensorMode]->supersets.size(); j++)
+            switch (relations[oldReceptorSet[i]->sensorMode])
             {
-               if (oldReceptorSet[i]->sensorMode == sensorModes[sensorMode]->supersets[j])
-               {
-                  receptor->superSensorModes.push_back(oldReceptorSet[i]);
-                  oldReceptorSet[i]->subSensorModes.push_back(receptor);
-                  break;
-               }
+            case SensorMode::SUBSET_MODE:
+               receptor->subSensorModes.push_back(oldReceptorSet[i]);
+               oldReceptorSet[i]->superSensorModes.push_back(receptor);
+               oldReceptorSet[i]->dirty = true;
+               break;
+
+            case SensorMode::SUPERSET_MODE:
+               receptor->superSensorModes.push_back(oldReceptorSet[i]);
+               oldReceptorSet[i]->subSensorModes.push_back(receptor);
+               oldReceptorSet[i]->dirty = true;
+               break;
             }
          }
       }
       for (i = 0; i < (int)newReceptorSet.size(); i++)
       {
-         for (j = 0; j < (int)sensorModes[sensorMode]->subsets.size(); j++)
+         switch (relations[newReceptorSet[i]->sensorMode])
          {
-            if (newReceptorSet[i]->sensorMode == sensorModes[sensorMode]->subsets[j])
-            {
-               receptor->subSensorModes.push_back(newReceptorSet[i]);
-               newReceptorSet[i]->superSensorModes.push_back(receptor);
-               break;
-            }
-         }
-         if (j < (int)sensorModes[sensorMode]->subsets.size())
-         {
-            continue;
-         }
-         for (j = 0; j < (int)sensorModes[sensorMode]->supersets.size(); j++)
-         {
-            if (newReceptorSet[i]->sensorMode == sensorModes[sensorMode]->supersets[j])
-            {
-               receptor->superSensorModes.push_back(newReceptorSet[i]);
-               newReceptorSet[i]->subSensorModes.push_back(receptor);
-               break;
-            }
+         case SensorMode::SUBSET_MODE:
+            receptor->subSensorModes.push_back(newReceptorSet[i]);
+            newReceptorSet[i]->superSensorModes.push_back(receptor);
+            receptor->dirty = true;
+            break;
+
+         case SensorMode::SUPERSET_MODE:
+            receptor->superSensorModes.push_back(newReceptorSet[i]);
+            newReceptorSet[i]->subSensorModes.push_back(receptor);
+            receptor->dirty = true;
+            break;
          }
       }
 
@@ -134,9 +158,22 @@ Mona::sense()
       {
          oldReceptorSet.push_back(receptor);
       }
+   }
 
-      // Fire receptor.
-      receptor->firingStrength = 1.0;
+   // Update need based on sensors and receptors.
+   for (i = 0; i < numNeeds; i++)
+   {
+      homeostats[i]->sensorsUpdate();
+   }
+
+   // Fire receptors.
+   for (sensorMode = 0; sensorMode < (int)sensorModes.size(); sensorMode++)
+   {
+      if ((receptor = senseReceptors[sensorMode]) == NULL)
+      {
+         continue;
+      }
+      receptor->setFiringStrength(1.0);
 
       // Update receptor goal value.
       receptor->updateGoalValue();
@@ -155,7 +192,15 @@ Mona::sense()
 #ifdef MONA_TRACKING
       receptor->tracker.fire = true;
 #endif
+      traceEvent(FIRE_EVENT, RECEPTOR, receptor->id, 1.0);
+   }
+
+   // Count centroid distance evaluations.
+   for (i = 0; i < (int)sensorCentroids.size(); i++)
+   {
+      centroidDistances += sensorCentroids[i]->distanceCount;
    }
+   centroidDistances -= distances;
 }
 
 
@@ -177,16 +222,18 @@ void Mona::applySensorMode(vector<SENSOR>& sensorsIn,
       addSensorMode(mask);
    }
 
-   sensorsOut.clear();
-   for (i = 0; i < (int)sensorsIn.size(); i++)
+   // Gather the unmasked sensors.
+   if (sensorModeViews.size() != sensorModes.size())
    {
-      if (sensorModes[sensorMode]->mask[i])
-      {
-         sensorsOut.push_back(sensorsIn[i]);
-      }
-      else
+      compileSensorModes();
+   }
+   vector<int>& indices = sensorModes[sensorMode]->indices;
+   sensorsOut.assign(sensorsIn.size(), 0.0f);
+   for (i = 0; i < (int)indices.size(); i++)
+   {
+      if (indices[i] < (int)sensorsIn.size())
       {
-         sensorsOut.push_back(0.0f);
+         sensorsOut[indices[i]] = sensorsIn[indices[i]];
       }
    }
 }
@@ -203,6 +250,24 @@ void Mona::applySensorMode(vector<SENSOR>& sensors, SENSOR_MODE sensorMode)
 }
 
 
+// Get distance from pattern to sensors with sensor mode applied,
+// without building the masked sensor vector.
+Mona::SENSOR Mona::sensorModeDistance(vector<SENSOR>& pattern,
+                                      vector<SENSOR>& sensors, SENSOR_MODE sensorMode)
+{
+   SENSOR       d;
+   SENSOR       dist  = 0.0f;
+   vector<bool> &mask = sensorModes[sensorMode]->mask;
+
+   for (int i = 0; i < (int)pattern.size(); i++)
+   {
+      d     = pattern[i] - (mask[i] ? sensors[i] : 0.0f);
+      dist += (d * d);
+   }
+   return(dist);
+}
+
+
 // Find the receptor containing the centroid closest to
 // the sensor vector for the current sensor mode.
 // Also return the centroid-vector distance.
@@ -210,7 +275,14 @@ Mona::Receptor *
 Mona::getCentroidReceptor(vector<SENSOR>& sensors,
                           SENSOR_MODE sensorMode, SENSOR& distance)
 {
-   RDtree::RDsearch *result = sensorCentroids[sensorMode]->search((void *)&sensors, 1);
+   void *pattern = (void *)&sensors;
+
+   if (sensorModes[sensorMode]->quantization != SensorMode::NO_QUANTIZATION)
+   {
+      sensorModes[sensorMode]->quantize(sensors, searchCodes);
+      pattern = (void *)&searchCodes;
+   }
+   RDtree::RDsearch *result = sensorCentroids[sensorMode]->search(pattern, 1);
 
    if (result != NULL)
    {
@@ -307,6 +379,172 @@ void Mona::Receptor::deletePattern(void *pattern)
 }
 
 
+// Squared distance between 8 bit code vectors.
+static unsigned long long codeDistance8(unsigned char *codesA,
+                                        unsigned char *codesB, int size)
+{
+   int                i, n;
+   unsigned long long dist = 0;
+
+   i = 0;
+#ifdef __SSE2__
+   __m128i zero = _mm_setzero_si128();
+   int     lanes[4];
+   while (i + 16 <= size)
+   {
+      // Flush the 32 bit lane sums before they can overflow.
+      __m128i sum = zero;
+      for (n = 0; i + 16 <= size && n < 4096; i += 16, n++)
+      {
+         __m128i a = _mm_loadu_si128((__m128i *)(codesA + i));
+         __m128i b = _mm_loadu_si128((__m128i *)(codesB + i));
+         __m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+         __m128i lo = _mm_unpacklo_epi8(d, zero);
+         __m128i hi = _mm_unpackhi_epi8(d, zero);
+         sum = _mm_add_epi32(sum, _mm_madd_epi16(lo, lo));
+         sum = _mm_add_epi32(sum, _mm_madd_epi16(hi, hi));
+      }
+      _mm_storeu_si128((__m128i *)lanes, sum);
+      dist += (unsigned long long)(unsigned int)lanes[0] + (unsigned int)lanes[1] +
+              (unsigned int)lanes[2] + (unsigned int)lanes[3];
+   }
+#endif
+   for ( ; i < size; i++)
+   {
+      n     = (int)codesA[i] - (int)codesB[i];
+      dist += (unsigned long long)(n * n);
+   }
+   return(dist);
+}
+
+
+// Squared distance between 16 bit code vectors.
+static unsigned long long codeDistance16(unsigned short *codesA,
+                                         unsigned short *codesB, int size)
+{
+   int                i;
+   long long          d;
+   unsigned long long dist = 0;
+
+   i = 0;
+#ifdef __SSE2__
+   __m128i            zero = _mm_setzero_si128();
+   __m128i            sum  = zero;
+   unsigned long long lanes[2];
+   for ( ; i + 8 <= size; i += 8)
+   {
+      __m128i a  = _mm_loadu_si128((__m128i *)(codesA + i));
+      __m128i b  = _mm_loadu_si128((__m128i *)(codesB + i));
+      __m128i d  = _mm_or_si128(_mm_subs_epu16(a, b), _mm_subs_epu16(b, a));
+      __m128i lo = _mm_mullo_epi16(d, d);
+      __m128i hi = _mm_mulhi_epu16(d, d);
+      __m128i p0 = _mm_unpacklo_epi16(lo, hi);
+      __m128i p1 = _mm_unpackhi_epi16(lo, hi);
+      sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(p0, zero));
+      sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(p0, zero));
+      sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(p1, zero));
+      sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(p1, zero));
+   }
+   _mm_storeu_si128((__m128i *)lanes, sum);
+   dist = lanes[0] + lanes[1];
+#endif
+   for ( ; i < size; i++)
+   {
+      d     = (long long)codesA[i] - (long long)codesB[i];
+      dist += (unsigned long long)(d * d);
+   }
+   return(dist);
+}
+
+
+// Get distance between code vectors.
+Mona::SENSOR Mona::SensorCodes::codeDistance(SensorCodes *codesA,
+                                             SensorCodes *codesB)
+{
+   unsigned long long dist;
+
+   if (codesA->size == 0)
+   {
+      return(0.0f);
+   }
+   if (codesA->quantization == SensorMode::QUANTIZE_8)
+   {
+      dist = codeDistance8(&codesA->codes[0], &codesB->codes[0], codesA->size);
+   }
+   else
+   {
+      dist = codeDistance16((unsigned short *)&codesA->codes[0],
+                            (unsigned short *)&codesB->codes[0], codesA->size);
+   }
+   return((SENSOR)((double)dist / ((double)codesA->scale * (double)codesA->scale)));
+}
+
+
+// RDtree code vector search.
+Mona::SENSOR Mona::SensorCodes::patternDistance(void *codesA, void *codesB)
+{
+   return(codeDistance((SensorCodes *)codesA, (SensorCodes *)codesB));
+}
+
+
+void Mona::SensorCodes::deletePattern(void *pattern)
+{
+   delete (SensorCodes *)pattern;
+}
+
+
+// Create centroid search tree for sensor mode.
+RDtree *Mona::newCentroidTree(SENSOR_MODE sensorMode)
+{
+   RDtree *rdTree;
+
+   if ((sensorMode < (int)sensorModes.size()) &&
+       (sensorModes[sensorMode]->quantization != SensorMode::NO_QUANTIZATION))
+   {
+      rdTree = new RDtree(Mona::SensorCodes::patternDistance,
+                          Mona::SensorCodes::deletePattern);
+   }
+   else
+   {
+      rdTree = new RDtree(Mona::Receptor::patternDistance,
+                          Mona::Receptor::deletePattern);
+   }
+   assert(rdTree != NULL);
+   return(rdTree);
+}
+
+
+// Create centroid search tree pattern.
+void *Mona::newCentroidPattern(vector<SENSOR>& centroid, SENSOR_MODE sensorMode)
+{
+   if (sensorModes[sensorMode]->quantization != SensorMode::NO_QUANTIZATION)
+   {
+      SensorCodes *codes = new SensorCodes();
+      assert(codes != NULL);
+      sensorModes[sensorMode]->quantize(centroid, *codes);
+      return((void *)codes);
+   }
+   vector<SENSOR> *sensors = new vector<SENSOR>(centroid);
+   assert(sensors != NULL);
+   return((void *)sensors);
+}
+
+
+// Copy centroid search tree pattern.
+void *Mona::copyCentroidPattern(void *pattern, SENSOR_MODE sensorMode)
+{
+   if (sensorModes[sensorMode]->quantization != SensorMode::NO_QUANTIZATION)
+   {
+      SensorCodes *codes = new SensorCodes(*(SensorCodes *)pattern);
+      assert(codes != NULL);
+      return((void *)codes);
+   }
+   vector<SENSOR> *sensors = new vector<SENSOR>(*(vector<SENSOR> *)pattern);
+   assert(sensors != NULL);
+   return((void *)sensors);
+}
+
+
 // Set sensor resolution.
 bool Mona::setSensorResolution(SENSOR sensorResolution)
 {
@@ -325,8 +563,8 @@ bool Mona::setSensorResolution(SENSOR sensorResolution)
 // Add sensor mode.
 int Mona::addSensorMode(vector<bool>& sensorMask, SENSOR sensorResolution)
 {
-   // Must add modes before cycling.
-   if ((int)receptors.size() > 0)
+   // Must add modes before cycling, and not to a shared configuration.
+   if (((int)receptors.size() > 0) || (configuration != NULL))
    {
       return(-1);
    }
@@ -358,21 +596,86 @@ int Mona::addSensorMode(vector<bool>& sensorMask, SENSOR sensorResolution)
    s->init(sensorMask, sensorResolution, &sensorModes);
 
    // Create associated centroid search tree.
-   RDtree *t = new RDtree(Mona::Receptor::patternDistance,
-                          Mona::Receptor::deletePattern);
-   assert(t != NULL);
-   sensorCentroids.push_back(t);
+   sensorCentroids.push_back(newCentroidTree(s->mode));
+   centroidsDirty = true;
+
+   // Compile modes with the new subset/superset relations.
+   compileSensorModes();
 
    return(s->mode);
 }
 
 
+// Compile sensor modes for sensing.
+void Mona::compileSensorModes()
+{
+   int         i, j;
+   SensorMode  *sensorMode;
+   SENSOR_MODE mode;
+
+   // A shared configuration is compiled.
+   sensorModeViews.assign(sensorModes.size(), vector<SENSOR>(numSensors, 0.0f));
+   if (configuration != NULL)
+   {
+      return;
+   }
+   sensorMemberModes.assign(numSensors, vector<SENSOR_MODE>());
+   for (mode = 0; mode < (int)sensorModes.size(); mode++)
+   {
+      sensorMode = sensorModes[mode];
+      sensorMode->compile(&sensorModes);
+      for (i = 0; i < (int)sensorMode->indices.size(); i++)
+      {
+         if ((j = sensorMode->indices[i]) < numSensors)
+         {
+            sensorMemberModes[j].push_back(mode);
+         }
+      }
+   }
+}
+
+
 int Mona::addSensorMode(vector<bool>& sensorMask)
 {
    return(addSensorMode(sensorMask, SENSOR_RESOLUTION));
 }
 
 
+// Set sensor mode quantization.
+// Must set before cycling.
+bool Mona::setSensorModeQuantization(SENSOR_MODE sensorMode, int quantization,
+                                     SENSOR quantizationScale)
+{
+   if (((int)receptors.size() > 0) || (configuration != NULL) ||
+       (sensorMode < 0) || (sensorMode >= (int)sensorModes.size()))
+   {
+      return(false);
+   }
+   if ((quantization != SensorMode::NO_QUANTIZATION) &&
+       (quantization != SensorMode::QUANTIZE_8) &&
+       (quantization != SensorMode::QUANTIZE_16))
+   {
+      return(false);
+   }
+   if (quantization == SensorMode::NO_QUANTIZATION)
+   {
+      quantizationScale = 1.0f;
+   }
+   else if (quantizationScale <= 0.0f)
+   {
+      return(false);
+   }
+   sensorModes[sensorMode]->quantization      = quantization;
+   sensorModes[sensorMode]->quantizationScale = quantizationScale;
+
+   // Replace the search tree with one for the new patterns.
+   delete sensorCentroids[sensorMode];
+   sensorCentroids[sensorMode] = newCentroidTree(sensorMode);
+   centroidsDirty = true;
+   return(true);
+}
+
+
 // Update goal value.
 void Mona::Receptor::updateGoalValue()
 {
@@ -0,0 +1,1155 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona server.
+ *
+ * Usage: mona_server
+ *      [-port <TCP port on localhost> | -socket <Unix socket path>]
+ *      [-threads <number of worker threads>]
+ *      [-memory <session memory budget (megabytes)>]
+ *      [-directory <data directory>]
+ *
+ * Hosts many named Mona sessions in one process, in place of running
+ * socker with a mona process per connection. Connections are served by
+ * an epoll event loop, and the requests read in each pass of the loop
+ * are run across a pool of worker threads, one session per task, so a
+ * session's requests run in arrival order while different sessions run
+ * in parallel. Each request is answered, and the replies on a connection
+ * are in the order of its requests, so requests can be pipelined and any
+ * number of connections can share any number of sessions.
+ *
+ * When the memory of the networks in memory, by their running memory
+ * estimates, exceeds the budget the least recently used sessions are
+ * evicted: saved to the data directory as <session name>.session and
+ * deleted. An evicted session is loaded again by its next request. On
+ * SIGINT or SIGTERM all sessions are saved this way, so a session
+ * persists until destroyed. Load and save names may not end in
+ * .session, leaving those files to the sessions.
+ *
+ * Requests are binary frames, as those of the mona driver's binary mode,
+ * in native byte order: the frame length in bytes, not counting the length
+ * itself, as a 32-bit unsigned integer, then a frame type byte, the session
+ * name length byte, the session name (letters, digits, '_', '-' and '.',
+ * not starting with '.'), and the fields of the type:
+ * 1 (cycleN): needs flag byte, cycle count (32-bit integer), then for
+ *   each cycle its need values as 64-bit floats if flagged (NaN leaves
+ *   a need unchanged) and its sensor values as 32-bit floats.
+ * 2 (need): need number (32-bit integer), need value (64-bit float).
+ * 3 (response): override response (32-bit integer), 2147483647 for null.
+ * 4 (create): number of sensors, responses and needs, and random seed
+ *   (32-bit integers).
+ * 5 (load): file name, relative to the data directory.
+ * 6 (save): file name, relative to the data directory.
+ * 7 (evict): save the session to the data directory and free its memory.
+ * 8 (destroy): delete the session.
+ * 9 (goal): need number, sensor mode and response (32-bit integers,
+ *   2147483647 for a null response), goal value (64-bit float), then the
+ *   sensor values as 32-bit floats.
+ * Replies are the frame length, the request type byte and a status byte,
+ * 0 for success, followed for a successful cycleN by the cycle count and
+ * the responses as 32-bit integers, and for a failure by an error message.
+ * A malformed frame closes its connection.
+ *
+ * Linux only.
+ */
+
+#include "mona.hpp"
+#include <set>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Frame types.
+#define CYCLE_FRAME             1
+#define NEED_FRAME              2
+#define RESPONSE_FRAME          3
+#define CREATE_FRAME            4
+#define LOAD_FRAME              5
+#define SAVE_FRAME              6
+#define EVICT_FRAME             7
+#define DESTROY_FRAME           8
+#define GOAL_FRAME              9
+
+// Maximum frame size.
+#define MAX_FRAME_SIZE          (1 << 28)
+
+// Maximum size of a network's cycle, its need and sensor values, and of
+// its responses, bounding the network a create frame can request so that
+// at least 256 cycles fit in a frame.
+#define MAX_CYCLE_SIZE          (MAX_FRAME_SIZE / 256)
+
+// Input read from a connection per pass of the event loop.
+#define MAX_READ_SIZE           (1 << 20)
+
+// Pending output above which a connection is not read.
+#define MAX_OUTPUT_SIZE         (1 << 24)
+
+// Maximum events per pass of the event loop.
+#define MAX_EVENTS              256
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_server\n",
+   (char *)"      [-port <TCP port on localhost> | -socket <Unix socket path>]\n",
+   (char *)"      [-threads <number of worker threads>]\n",
+   (char *)"      [-memory <session memory budget (megabytes)>]\n",
+   (char *)"      [-directory <data directory>]\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+class Request;
+
+// Session.
+class Session
+{
+public:
+
+   string             name;
+   Mona               *mona;
+   bool               evicted;
+
+   // Memory accounted to the session, and measured after its requests.
+   unsigned long long memory;
+   unsigned long long usage;
+
+   // Requests of the current pass.
+   vector<Request *> requests;
+
+   // Position in least recently used order.
+   list<Session *>::iterator lru;
+   bool                      inMemory;
+
+   Session(string& name)
+   {
+      this->name = name;
+      mona       = NULL;
+      evicted    = false;
+      memory     = 0;
+      usage      = 0;
+      inMemory   = false;
+   }
+
+
+   ~Session()
+   {
+      if (mona != NULL)
+      {
+         delete mona;
+      }
+   }
+};
+
+// Connection.
+class Connection
+{
+public:
+
+   int                   fd;
+   unsigned long long    id;
+   vector<unsigned char> input;
+   size_t                inputStart;
+   vector<unsigned char> output;
+   size_t                outputStart;
+   unsigned int          events;
+
+   // Input ended; output failed.
+   bool closed;
+   bool failed;
+
+   Connection(int fd, unsigned long long id)
+   {
+      this->fd    = fd;
+      this->id    = id;
+      inputStart  = 0;
+      outputStart = 0;
+      events      = 0;
+      closed      = false;
+      failed      = false;
+   }
+
+
+   ~Connection()
+   {
+      close(fd);
+   }
+};
+
+// Request.
+class Request
+{
+public:
+
+   unsigned long long    connection;
+   Session               *session;
+   int                   type;
+   vector<unsigned char> fields;
+   ByteBuffer            reply;
+};
+
+// Server state.
+int                   listener = -1;
+int                   epollfd  = -1;
+char                  *socketPath;
+string                directory;
+unsigned long long    memoryBudget, memoryUsed;
+map<string, Session *> sessions;
+list<Session *>       lruSessions;
+map<unsigned long long, Connection *> connections;
+unsigned long long    nextConnection;
+vector<Request *>     requests;
+vector<Session *>     activeSessions;
+ThreadPool            *threadPool;
+int                   numThreads;
+volatile sig_atomic_t quit = 0;
+
+// Signal handler.
+void handleSignal(int)
+{
+   quit = 1;
+}
+
+
+// Fatal error.
+void die(char *msg)
+{
+   perror(msg);
+   if ((socketPath != NULL) && (listener != -1))
+   {
+      unlink(socketPath);
+   }
+   exit(1);
+}
+
+
+// Valid session name?
+bool validName(string& name)
+{
+   if ((name.size() == 0) || (name[0] == '.'))
+   {
+      return(false);
+   }
+   for (int i = 0; i < (int)name.size(); i++)
+   {
+      if (!isalnum((unsigned char)name[i]) && (name[i] != '_') &&
+          (name[i] != '-') && (name[i] != '.'))
+      {
+         return(false);
+      }
+   }
+   return(true);
+}
+
+
+// Get data directory path of file name, or empty if invalid.
+// Names are relative, may not leave the directory, and may not
+// be session eviction files.
+string dataPath(string name)
+{
+   const string sessionSuffix = ".session";
+
+   if ((name.size() == 0) || (name[0] == '/') ||
+       ((name.size() >= sessionSuffix.size()) &&
+        (name.compare(name.size() - sessionSuffix.size(), sessionSuffix.size(), sessionSuffix) == 0)) ||
+       (name.find('\0') != string::npos) ||
+       (name == "..") || (name.compare(0, 3, "../") == 0) ||
+       (name.find("/../") != string::npos) ||
+       ((name.size() >= 3) && (name.compare(name.size() - 3, 3, "/..") == 0)))
+   {
+      return("");
+   }
+   return(directory + "/" + name);
+}
+
+
+// Session eviction file path.
+string sessionPath(Session *session)
+{
+   return(directory + "/" + session->name + ".session");
+}
+
+
+// Reply to request.
+void reply(Request *request, int status, const char *message = NULL)
+{
+   request->reply.clear();
+   request->reply.put((unsigned int)0);
+   request->reply.put((unsigned char)request->type);
+   request->reply.put((unsigned char)status);
+   if (message != NULL)
+   {
+      request->reply.put(message, strlen(message));
+   }
+}
+
+
+// Finish reply, setting its length.
+void finishReply(Request *request)
+{
+   unsigned int size = (unsigned int)(request->reply.size() - sizeof(unsigned int));
+
+   memcpy(&request->reply.bytes[0], &size, sizeof(size));
+}
+
+
+// Make session network resident, loading it if evicted.
+bool residentSession(Session *session)
+{
+   Mona *mona;
+
+   if (session->mona != NULL)
+   {
+      return(true);
+   }
+   if (!session->evicted)
+   {
+      return(false);
+   }
+   mona = new Mona();
+   assert(mona != NULL);
+   string path = sessionPath(session);
+   if (!mona->load((char *)path.c_str()))
+   {
+      delete mona;
+      return(false);
+   }
+   mona->setLatencyMetrics(false);
+   session->mona = mona;
+   return(true);
+}
+
+
+// Evict session, saving it to the data directory.
+bool evictSession(Session *session)
+{
+   if (session->mona == NULL)
+   {
+      return(true);
+   }
+   string path = sessionPath(session);
+   if (!session->mona->save((char *)path.c_str()))
+   {
+      return(false);
+   }
+   delete session->mona;
+   session->mona    = NULL;
+   session->evicted = true;
+   return(true);
+}
+
+
+// Run request.
+void runRequest(Request *request)
+{
+   int           i, j, count, response, mode;
+   int           numSensors, numResponses, numNeeds, seed;
+   unsigned char needsFlag;
+   size_t        cycleSize;
+   Mona::NEED    need;
+   Mona          *mona;
+   ByteBuffer    buffer;
+   Session       *session = request->session;
+
+   vector<Mona::SENSOR> sensors;
+
+   if (request->fields.size() > 0)
+   {
+      buffer.wrap(&request->fields[0], request->fields.size());
+   }
+   reply(request, 0);
+   switch (request->type)
+   {
+   case CREATE_FRAME:
+      numSensors   = buffer.get<int>();
+      numResponses = buffer.get<int>();
+      numNeeds     = buffer.get<int>();
+      seed         = buffer.get<int>();
+      if (buffer.failed || (buffer.position != buffer.size()) ||
+          (numSensors <= 0) || (numResponses <= 0) || (numNeeds <= 0) ||
+          ((size_t)numSensors * sizeof(float) + (size_t)numNeeds * sizeof(double) > MAX_CYCLE_SIZE) ||
+          ((size_t)numResponses * sizeof(int) > MAX_CYCLE_SIZE))
+      {
+         reply(request, 1, "Invalid create frame");
+         return;
+      }
+      if ((session->mona != NULL) || session->evicted)
+      {
+         reply(request, 1, "Session exists");
+         return;
+      }
+      mona = new Mona(numSensors, numResponses, numNeeds, (RANDOM)seed);
+      assert(mona != NULL);
+      mona->setLatencyMetrics(false);
+      session->mona = mona;
+      return;
+
+   case LOAD_FRAME:
+   {
+      string path = dataPath(string(request->fields.begin(), request->fields.end()));
+      if (path.size() == 0)
+      {
+         reply(request, 1, "Invalid file name");
+         return;
+      }
+      mona = new Mona();
+      assert(mona != NULL);
+      if (!mona->load((char *)path.c_str()))
+      {
+         delete mona;
+         reply(request, 1, "Cannot load file");
+         return;
+      }
+      mona->setLatencyMetrics(false);
+      if (session->mona != NULL)
+      {
+         delete session->mona;
+      }
+      session->mona = mona;
+      return;
+   }
+
+   case DESTROY_FRAME:
+      if ((session->mona == NULL) && !session->evicted)
+      {
+         reply(request, 1, "No such session");
+         return;
+      }
+      if (session->mona != NULL)
+      {
+         delete session->mona;
+         session->mona = NULL;
+      }
+      if (session->evicted)
+      {
+         unlink(sessionPath(session).c_str());
+         session->evicted = false;
+      }
+      return;
+
+   case EVICT_FRAME:
+      if ((session->mona == NULL) && !session->evicted)
+      {
+         reply(request, 1, "No such session");
+      }
+      else if (!evictSession(session))
+      {
+         reply(request, 1, "Cannot save session");
+      }
+      return;
+   }
+
+   // Remaining requests use the network.
+   if (!residentSession(session))
+   {
+      if (session->evicted)
+      {
+         reply(request, 1, "Cannot load session");
+      }
+      else
+      {
+         reply(request, 1, "No such session");
+      }
+      return;
+   }
+   mona = session->mona;
+   switch (request->type)
+   {
+   case CYCLE_FRAME:
+      needsFlag = buffer.get<unsigned char>();
+      cycleSize = mona->numSensors * sizeof(float);
+      if (needsFlag)
+      {
+         cycleSize += mona->numNeeds * sizeof(double);
+      }
+      count = buffer.getCount(cycleSize);
+      if (buffer.failed || (buffer.position + (size_t)count * cycleSize != buffer.size()))
+      {
+         reply(request, 1, "Invalid cycleN frame");
+         return;
+      }
+      request->reply.put(count);
+      sensors.resize(mona->numSensors);
+      for (i = 0; i < count; i++)
+      {
+         if (needsFlag)
+         {
+            for (j = 0; j < mona->numNeeds; j++)
+            {
+               need = buffer.get<double>();
+
+               // Not NaN.
+               if (need == need)
+               {
+                  mona->setNeed(j, need);
+               }
+            }
+         }
+         for (j = 0; j < mona->numSensors; j++)
+         {
+            sensors[j] = buffer.get<float>();
+         }
+         response = mona->cycle(sensors);
+         if (mona->responseOverride != Mona::NULL_RESPONSE)
+         {
+            mona->clearResponseOverride();
+         }
+         request->reply.put(response);
+      }
+      return;
+
+   case NEED_FRAME:
+      i    = buffer.get<int>();
+      need = buffer.get<double>();
+      if (buffer.failed || (buffer.position != buffer.size()) ||
+          (i < 0) || (i >= mona->numNeeds))
+      {
+         reply(request, 1, "Invalid need frame");
+         return;
+      }
+      mona->setNeed(i, need);
+      return;
+
+   case RESPONSE_FRAME:
+      response = buffer.get<int>();
+      if (buffer.failed || (buffer.position != buffer.size()) ||
+          (response < 0) ||
+          ((response >= mona->numResponses) && (response != Mona::NULL_RESPONSE)))
+      {
+         reply(request, 1, "Invalid response frame");
+         return;
+      }
+      if (response == Mona::NULL_RESPONSE)
+      {
+         mona->clearResponseOverride();
+      }
+      else
+      {
+         mona->overrideResponse(response);
+      }
+      return;
+
+   case SAVE_FRAME:
+   {
+      string path = dataPath(string(request->fields.begin(), request->fields.end()));
+      if (path.size() == 0)
+      {
+         reply(request, 1, "Invalid file name");
+      }
+      else if (!mona->save((char *)path.c_str()))
+      {
+         reply(request, 1, "Cannot save file");
+      }
+      return;
+   }
+
+   case GOAL_FRAME:
+      i        = buffer.get<int>();
+      mode     = buffer.get<int>();
+      response = buffer.get<int>();
+      need     = buffer.get<double>();
+      if (buffer.failed ||
+          (buffer.position + mona->numSensors * sizeof(float) != buffer.size()) ||
+          !mona->isGoalValid(i, mode, response))
+      {
+         reply(request, 1, "Invalid goal frame");
+         return;
+      }
+      sensors.resize(mona->numSensors);
+      for (j = 0; j < mona->numSensors; j++)
+      {
+         sensors[j] = buffer.get<float>();
+      }
+      if (mona->addGoal(i, sensors, mode, response, need) < 0)
+      {
+         reply(request, 1, "Cannot add goal");
+      }
+      return;
+
+   default:
+      reply(request, 1, "Invalid frame type");
+      return;
+   }
+}
+
+
+// Run a session's requests.
+void runSession(void *, int index, int)
+{
+   Session *session = activeSessions[index];
+
+   for (int i = 0; i < (int)session->requests.size(); i++)
+   {
+      runRequest(session->requests[i]);
+      finishReply(session->requests[i]);
+   }
+   if (session->mona != NULL)
+   {
+      session->usage = session->mona->memoryEstimate;
+   }
+   else
+   {
+      session->usage = 0;
+   }
+}
+
+
+// Evict a session in a task.
+void evictTask(void *, int index, int)
+{
+   Session *session = activeSessions[index];
+
+   if (!evictSession(session))
+   {
+      fprintf(stderr, "Cannot evict session %s\n", session->name.c_str());
+   }
+}
+
+
+// Update session's memory accounting and recency after its requests.
+void touchSession(Session *session)
+{
+   if (session->inMemory)
+   {
+      lruSessions.erase(session->lru);
+      session->inMemory = false;
+   }
+   if (session->mona != NULL)
+   {
+      lruSessions.push_front(session);
+      session->lru      = lruSessions.begin();
+      session->inMemory = true;
+   }
+}
+
+
+// Evict least recently used sessions to within the memory budget.
+void enforceBudget()
+{
+   unsigned long long used;
+
+   list<Session *>::reverse_iterator itr;
+
+   if (memoryBudget == 0)
+   {
+      return;
+   }
+   activeSessions.clear();
+   used = memoryUsed;
+   for (itr = lruSessions.rbegin(); itr != lruSessions.rend() && used > memoryBudget; itr++)
+   {
+      activeSessions.push_back(*itr);
+      used -= (*itr)->memory;
+   }
+   if (activeSessions.size() == 0)
+   {
+      return;
+   }
+   threadPool->run(evictTask, NULL, (int)activeSessions.size(), numThreads);
+   for (int i = 0; i < (int)activeSessions.size(); i++)
+   {
+      Session *session = activeSessions[i];
+      if (session->mona == NULL)
+      {
+         memoryUsed     -= session->memory;
+         session->memory = 0;
+         session->usage  = 0;
+         touchSession(session);
+      }
+   }
+   activeSessions.clear();
+}
+
+
+// Get session, adding it if new.
+// A new session is evicted if the data directory holds its file.
+Session *getSession(string& name)
+{
+   map<string, Session *>::iterator itr = sessions.find(name);
+   if (itr != sessions.end())
+   {
+      return(itr->second);
+   }
+   Session *session = new Session(name);
+   assert(session != NULL);
+   if (access(sessionPath(session).c_str(), R_OK) == 0)
+   {
+      session->evicted = true;
+   }
+   sessions[name] = session;
+   return(session);
+}
+
+
+// Set connection's epoll events.
+void setEvents(Connection *connection)
+{
+   struct epoll_event event;
+   unsigned int       events = 0;
+
+   if (!connection->closed &&
+       (connection->output.size() - connection->outputStart < MAX_OUTPUT_SIZE))
+   {
+      events |= EPOLLIN;
+   }
+   if (connection->outputStart < connection->output.size())
+   {
+      events |= EPOLLOUT;
+   }
+   if (events != connection->events)
+   {
+      memset(&event, 0, sizeof(event));
+      event.events   = events;
+      event.data.u64 = connection->id;
+      epoll_ctl(epollfd, EPOLL_CTL_MOD, connection->fd, &event);
+      connection->events = events;
+   }
+}
+
+
+// Close connection.
+void closeConnection(Connection *connection)
+{
+   epoll_ctl(epollfd, EPOLL_CTL_DEL, connection->fd, NULL);
+   connections.erase(connection->id);
+   delete connection;
+}
+
+
+// Accept connections.
+void acceptConnections()
+{
+   int                fd, one = 1;
+   struct epoll_event event;
+   Connection         *connection;
+
+   while ((fd = accept(listener, NULL, NULL)) != -1)
+   {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+      if (socketPath == NULL)
+      {
+         setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      }
+      connection = new Connection(fd, nextConnection++);
+      assert(connection != NULL);
+      connections[connection->id] = connection;
+      memset(&event, 0, sizeof(event));
+      event.events       = EPOLLIN;
+      event.data.u64     = connection->id;
+      connection->events = EPOLLIN;
+      if (epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event) == -1)
+      {
+         closeConnection(connection);
+      }
+   }
+}
+
+
+// Read connection input into requests.
+// Returns false on a malformed frame.
+bool readConnection(Connection *connection)
+{
+   size_t        n, size;
+   ssize_t       r;
+   unsigned int  frameSize;
+   unsigned char nameSize;
+   Request       *request;
+   Session       *session;
+
+   for (n = 0; n < MAX_READ_SIZE; n += r)
+   {
+      size = connection->input.size();
+      connection->input.resize(size + 65536);
+      r = read(connection->fd, &connection->input[size], 65536);
+      connection->input.resize(size + (r > 0 ? r : 0));
+      if (r <= 0)
+      {
+         if ((r == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)))
+         {
+            connection->closed = true;
+         }
+         break;
+      }
+   }
+
+   // Parse complete frames.
+   vector<unsigned char>& input = connection->input;
+   while (input.size() - connection->inputStart >= sizeof(frameSize))
+   {
+      memcpy(&frameSize, &input[connection->inputStart], sizeof(frameSize));
+      if ((frameSize < 2) || (frameSize > MAX_FRAME_SIZE))
+      {
+         return(false);
+      }
+      if (input.size() - connection->inputStart - sizeof(frameSize) < frameSize)
+      {
+         break;
+      }
+      unsigned char *frame = &input[connection->inputStart + sizeof(frameSize)];
+      nameSize = frame[1];
+      if ((size_t)nameSize + 2 > frameSize)
+      {
+         return(false);
+      }
+      string name((char *)&frame[2], nameSize);
+      if (!validName(name))
+      {
+         return(false);
+      }
+      session = getSession(name);
+      request = new Request();
+      assert(request != NULL);
+      request->connection = connection->id;
+      request->session    = session;
+      request->type       = frame[0];
+      request->fields.assign(frame + 2 + nameSize, frame + frameSize);
+      requests.push_back(request);
+      if (session->requests.size() == 0)
+      {
+         activeSessions.push_back(session);
+      }
+      session->requests.push_back(request);
+      connection->inputStart += sizeof(frameSize) + frameSize;
+   }
+   if (connection->inputStart > 0)
+   {
+      input.erase(input.begin(), input.begin() + connection->inputStart);
+      connection->inputStart = 0;
+   }
+   return(true);
+}
+
+
+// Write connection output.
+void writeConnection(Connection *connection)
+{
+   ssize_t r;
+
+   while (connection->outputStart < connection->output.size())
+   {
+      r = write(connection->fd, &connection->output[connection->outputStart],
+                connection->output.size() - connection->outputStart);
+      if (r <= 0)
+      {
+         if ((r < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+         {
+            connection->failed = true;
+            connection->output.clear();
+            connection->outputStart = 0;
+         }
+         break;
+      }
+      connection->outputStart += r;
+   }
+   if (connection->outputStart == connection->output.size())
+   {
+      connection->output.clear();
+      connection->outputStart = 0;
+   }
+}
+
+
+
+
+// Run the requests read in a pass of the event loop.
+// Sessions run in parallel, each running its requests in order.
+void runRequests(set<unsigned long long>& touched)
+{
+   int        i;
+   Request    *request;
+   Session    *session;
+   Connection *connection;
+
+   map<unsigned long long, Connection *>::iterator connectionItr;
+
+   if (requests.size() == 0)
+   {
+      return;
+   }
+   threadPool->run(runSession, NULL, (int)activeSessions.size(), numThreads);
+
+   // Reply in request order.
+   for (i = 0; i < (int)requests.size(); i++)
+   {
+      request       = requests[i];
+      connectionItr = connections.find(request->connection);
+      if (connectionItr != connections.end())
+      {
+         connection = connectionItr->second;
+         if (!connection->failed)
+         {
+            connection->output.insert(connection->output.end(),
+                                      request->reply.bytes.begin(),
+                                      request->reply.bytes.end());
+            touched.insert(connection->id);
+         }
+      }
+      delete request;
+   }
+   requests.clear();
+
+   // Account memory and recency, forgetting sessions without networks.
+   for (i = 0; i < (int)activeSessions.size(); i++)
+   {
+      session = activeSessions[i];
+      session->requests.clear();
+      memoryUsed     += session->usage;
+      memoryUsed     -= session->memory;
+      session->memory = session->usage;
+      touchSession(session);
+      if ((session->mona == NULL) && !session->evicted)
+      {
+         sessions.erase(session->name);
+         delete session;
+      }
+   }
+   activeSessions.clear();
+}
+
+
+int main(int argc, char *argv[])
+{
+   int                i, n, port, one = 1;
+   struct epoll_event events[MAX_EVENTS], event;
+   struct sockaddr_in address;
+   struct sockaddr_un unixAddress;
+   struct sigaction   action;
+   Connection         *connection;
+
+   set<unsigned long long>           touched;
+   set<unsigned long long>::iterator touchedItr;
+
+   map<unsigned long long, Connection *>::iterator connectionItr;
+   map<string, Session *>::iterator                sessionItr;
+
+   port         = -1;
+   socketPath   = NULL;
+   numThreads   = 1;
+   memoryBudget = 0;
+   directory    = ".";
+   for (i = 1; i < argc; i++)
+   {
+      if ((strcmp(argv[i], "-port") == 0) ||
+          (strcmp(argv[i], "-threads") == 0) ||
+          (strcmp(argv[i], "-memory") == 0))
+      {
+         if ((i + 1 >= argc) || (atoi(argv[i + 1]) <= 0))
+         {
+            printUsage();
+            exit(1);
+         }
+         if (strcmp(argv[i], "-port") == 0)
+         {
+            port = atoi(argv[i + 1]);
+         }
+         else if (strcmp(argv[i], "-threads") == 0)
+         {
+            numThreads = atoi(argv[i + 1]);
+         }
+         else
+         {
+            memoryBudget = (unsigned long long)atoi(argv[i + 1]) << 20;
+         }
+         i++;
+         continue;
+      }
+      if ((strcmp(argv[i], "-socket") == 0) ||
+          (strcmp(argv[i], "-directory") == 0))
+      {
+         if (i + 1 >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         if (strcmp(argv[i], "-socket") == 0)
+         {
+            socketPath = argv[i + 1];
+         }
+         else
+         {
+            directory = argv[i + 1];
+         }
+         i++;
+         continue;
+      }
+      printUsage();
+      exit(1);
+   }
+   if ((port == -1) == (socketPath == NULL))
+   {
+      printUsage();
+      exit(1);
+   }
+
+   // Listen.
+   if (socketPath != NULL)
+   {
+      if (strlen(socketPath) >= sizeof(unixAddress.sun_path))
+      {
+         fprintf(stderr, "Socket path too long\n");
+         exit(1);
+      }
+      if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+      {
+         die((char *)"socket");
+      }
+      unlink(socketPath);
+      memset(&unixAddress, 0, sizeof(unixAddress));
+      unixAddress.sun_family = AF_UNIX;
+      strcpy(unixAddress.sun_path, socketPath);
+      if (bind(listener, (struct sockaddr *)&unixAddress, sizeof(unixAddress)))
+      {
+         die((char *)"bind");
+      }
+   }
+   else
+   {
+      if ((listener = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+      {
+         die((char *)"socket");
+      }
+      setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      memset(&address, 0, sizeof(address));
+      address.sin_family      = AF_INET;
+      address.sin_port        = htons(port);
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (bind(listener, (struct sockaddr *)&address, sizeof(address)))
+      {
+         die((char *)"bind");
+      }
+   }
+   if (listen(listener, SOMAXCONN))
+   {
+      die((char *)"listen");
+   }
+   fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+   if ((epollfd = epoll_create1(0)) == -1)
+   {
+      die((char *)"epoll_create1");
+   }
+   memset(&event, 0, sizeof(event));
+   event.events   = EPOLLIN;
+   event.data.u64 = 0;
+   if (epoll_ctl(epollfd, EPOLL_CTL_ADD, listener, &event) == -1)
+   {
+      die((char *)"epoll_ctl");
+   }
+   nextConnection = 1;
+
+   // Quit on SIGINT or SIGTERM, interrupting the event loop.
+   memset(&action, 0, sizeof(action));
+   action.sa_handler = handleSignal;
+   sigemptyset(&action.sa_mask);
+   sigaction(SIGINT, &action, NULL);
+   sigaction(SIGTERM, &action, NULL);
+   signal(SIGPIPE, SIG_IGN);
+
+   threadPool = new ThreadPool(numThreads);
+   assert(threadPool != NULL);
+   memoryUsed = 0;
+
+   // Event loop.
+   while (!quit)
+   {
+      if ((n = epoll_wait(epollfd, events, MAX_EVENTS, -1)) == -1)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+         die((char *)"epoll_wait");
+      }
+      touched.clear();
+      for (i = 0; i < n; i++)
+      {
+         if (events[i].data.u64 == 0)
+         {
+            acceptConnections();
+            continue;
+         }
+         connectionItr = connections.find(events[i].data.u64);
+         if (connectionItr == connections.end())
+         {
+            continue;
+         }
+         connection = connectionItr->second;
+         touched.insert(connection->id);
+         if (events[i].events & EPOLLOUT)
+         {
+            writeConnection(connection);
+         }
+         if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !connection->closed &&
+             !readConnection(connection))
+         {
+            fprintf(stderr, "Invalid frame: closing connection\n");
+            connection->closed = connection->failed = true;
+         }
+      }
+      runRequests(touched);
+      enforceBudget();
+      for (touchedItr = touched.begin(); touchedItr != touched.end(); touchedItr++)
+      {
+         connectionItr = connections.find(*touchedItr);
+         if (connectionItr == connections.end())
+         {
+            continue;
+         }
+         connection = connectionItr->second;
+         if (!connection->failed)
+         {
+            writeConnection(connection);
+         }
+         if (connection->failed ||
+             (connection->closed && (connection->output.size() == 0)))
+         {
+            closeConnection(connection);
+         }
+         else
+         {
+            setEvents(connection);
+         }
+      }
+   }
+
+   // Save sessions.
+   for (sessionItr = sessions.begin(); sessionItr != sessions.end(); sessionItr++)
+   {
+      if (sessionItr->second->mona != NULL)
+      {
+         activeSessions.push_back(sessionItr->second);
+      }
+   }
+   threadPool->run(evictTask, NULL, (int)activeSessions.size(), numThreads);
+   activeSessions.clear();
+   for (sessionItr = sessions.begin(); sessionItr != sessions.end(); sessionItr++)
+   {
+      delete sessionItr->second;
+   }
+   sessions.clear();
+   while (connections.size() > 0)
+   {
+      closeConnection(connections.begin()->second);
+   }
+   delete threadPool;
+   close(epollfd);
+   close(listener);
+   if (socketPath != NULL)
+   {
+      unlink(socketPath);
+   }
+   return(0);
+}
@@ -0,0 +1,375 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona server test.
+ *
+ * Usage: mona_servertest
+ *      -server <mona_server executable>
+ *      [-port <TCP port on localhost>]
+ *      [-directory <scratch directory>]
+ *
+ * Runs the server on localhost and sends it goal frames having a need,
+ * sensor mode or response that does not exist, for a created session
+ * without sensor modes and for a loaded session with sensor modes. Each
+ * must be answered "Invalid goal frame" while valid goals are added,
+ * and all sessions must go on cycling. Exits with status 1 on failure.
+ *
+ * Linux only.
+ */
+
+#include "mona.hpp"
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_servertest\n",
+   (char *)"      -server <mona_server executable>\n",
+   (char *)"      [-port <TCP port on localhost>]\n",
+   (char *)"      [-directory <scratch directory>]\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+// Frame types.
+#define CYCLE_FRAME      1
+#define CREATE_FRAME     4
+#define LOAD_FRAME       5
+#define DESTROY_FRAME    8
+#define GOAL_FRAME       9
+
+// Network dimensions.
+#define NUM_SENSORS      4
+#define NUM_RESPONSES    2
+#define NUM_NEEDS        1
+
+// Seconds to wait for the server to listen.
+#define CONNECT_SECONDS  10
+
+// Server connection.
+int server;
+
+// Write all bytes.
+bool writeBytes(const void *data, size_t size)
+{
+   const unsigned char *p = (const unsigned char *)data;
+   ssize_t             n;
+
+   while (size > 0)
+   {
+      if ((n = write(server, p, size)) <= 0)
+      {
+         return(false);
+      }
+      p    += n;
+      size -= (size_t)n;
+   }
+   return(true);
+}
+
+
+// Read all bytes.
+bool readBytes(void *data, size_t size)
+{
+   unsigned char *p = (unsigned char *)data;
+   ssize_t       n;
+
+   while (size > 0)
+   {
+      if ((n = read(server, p, size)) <= 0)
+      {
+         return(false);
+      }
+      p    += n;
+      size -= (size_t)n;
+   }
+   return(true);
+}
+
+
+// Send request and read its reply.
+// Returns the reply status, or -1 on a connection failure.
+int request(int type, const char *name, ByteBuffer& fields, ByteBuffer& reply)
+{
+   unsigned int  size;
+   unsigned char c;
+
+   ByteBuffer frame;
+
+   frame.put((unsigned int)0);
+   frame.put((unsigned char)type);
+   frame.put((unsigned char)strlen(name));
+   frame.put(name, strlen(name));
+   frame.put(&fields.bytes[0], fields.bytes.size());
+   size = (unsigned int)(frame.size() - sizeof(size));
+   memcpy(&frame.bytes[0], &size, sizeof(size));
+   reply.clear();
+   if (!writeBytes(&frame.bytes[0], frame.size()) ||
+       !readBytes(&size, sizeof(size)) || (size < 2))
+   {
+      return(-1);
+   }
+   reply.bytes.resize(size);
+   if (!readBytes(&reply.bytes[0], size))
+   {
+      return(-1);
+   }
+   c = reply.get<unsigned char>();
+   if (c != type)
+   {
+      return(-1);
+   }
+   return((int)reply.get<unsigned char>());
+}
+
+
+// Send request expecting status and, on failure, message.
+bool expect(int type, const char *name, ByteBuffer& fields,
+            int status, const char *message, const char *what)
+{
+   int        s;
+   string     text;
+   ByteBuffer reply;
+
+   s = request(type, name, fields, reply);
+   if (s == 1)
+   {
+      text = string(reply.bytes.begin() + reply.position, reply.bytes.end());
+   }
+   if ((s != status) || ((message != NULL) && (text != message)))
+   {
+      fprintf(stderr, "%s: status %d \"%s\", expected %d\n", what, s, text.c_str(), status);
+      return(false);
+   }
+   return(true);
+}
+
+
+// Send goal frame.
+bool goal(const char *name, int need, int mode, int response,
+          int status, const char *what)
+{
+   ByteBuffer fields;
+
+   fields.put(need);
+   fields.put(mode);
+   fields.put(response);
+   fields.put((double)0.5);
+   for (int i = 0; i < NUM_SENSORS; i++)
+   {
+      fields.put((float)(i % 2));
+   }
+   return(expect(GOAL_FRAME, name, fields, status,
+                 status == 1 ? "Invalid goal frame" : NULL, what));
+}
+
+
+// Send cycles.
+bool cycle(const char *name, int cycles)
+{
+   int        i, j;
+   ByteBuffer fields, reply;
+
+   fields.put((unsigned char)0);
+   fields.put(cycles);
+   for (i = 0; i < cycles; i++)
+   {
+      for (j = 0; j < NUM_SENSORS; j++)
+      {
+         fields.put((float)((i + j) % 2));
+      }
+   }
+   if ((request(CYCLE_FRAME, name, fields, reply) != 0) ||
+       (reply.get<int>() != cycles) ||
+       (reply.size() != reply.position + cycles * sizeof(int)))
+   {
+      fprintf(stderr, "Cannot cycle session %s\n", name);
+      return(false);
+   }
+   return(true);
+}
+
+
+// Connect to server, while it runs.
+bool connectServer(int port, pid_t pid)
+{
+   int                status;
+   struct sockaddr_in address;
+
+   memset(&address, 0, sizeof(address));
+   address.sin_family      = AF_INET;
+   address.sin_port        = htons(port);
+   address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   for (int i = 0; i < CONNECT_SECONDS * 100; i++)
+   {
+      if ((server = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+      {
+         return(false);
+      }
+      if (connect(server, (struct sockaddr *)&address, sizeof(address)) == 0)
+      {
+         return(true);
+      }
+      close(server);
+      if (waitpid(pid, &status, WNOHANG) == pid)
+      {
+         return(false);
+      }
+      usleep(10000);
+   }
+   return(false);
+}
+
+
+int main(int argc, char *argv[])
+{
+   int   i, port, status;
+   char  *serverExec, *directory;
+   char  portArg[20], filename[BUFSIZ], sessionFile[BUFSIZ];
+   bool  pass;
+   pid_t pid;
+   Mona  *mona;
+
+   ByteBuffer fields;
+
+   serverExec = NULL;
+   directory  = (char *)".";
+   port       = 20000 + (int)(getpid() % 20000);
+   for (i = 1; i < argc; i++)
+   {
+      if ((strcmp(argv[i], "-port") == 0) && (i + 1 < argc) &&
+          (atoi(argv[i + 1]) > 0))
+      {
+         i++;
+         port = atoi(argv[i]);
+         continue;
+      }
+      if (((strcmp(argv[i], "-server") == 0) ||
+           (strcmp(argv[i], "-directory") == 0)) && (i + 1 < argc))
+      {
+         if (strcmp(argv[i], "-server") == 0)
+         {
+            serverExec = argv[i + 1];
+         }
+         else
+         {
+            directory = argv[i + 1];
+         }
+         i++;
+         continue;
+      }
+      printUsage();
+      exit(1);
+   }
+   if (serverExec == NULL)
+   {
+      printUsage();
+      exit(1);
+   }
+
+   // Save a network with sensor modes for loading.
+   sprintf(sessionFile, "servertest_%d.mona", (int)getpid());
+   sprintf(filename, "%s/%s", directory, sessionFile);
+   mona = new Mona(NUM_SENSORS, NUM_RESPONSES, NUM_NEEDS, 7);
+   assert(mona != NULL);
+   vector<bool> mask(NUM_SENSORS, true);
+   mona->addSensorMode(mask);
+   mask[0] = false;
+   mona->addSensorMode(mask);
+   if (!mona->save(filename))
+   {
+      fprintf(stderr, "Cannot save %s\n", filename);
+      exit(1);
+   }
+   delete mona;
+
+   // Run server; a failed write is reported, not fatal.
+   signal(SIGPIPE, SIG_IGN);
+   sprintf(portArg, "%d", port);
+   if ((pid = fork()) == -1)
+   {
+      fprintf(stderr, "Cannot fork\n");
+      exit(1);
+   }
+   if (pid == 0)
+   {
+      execl(serverExec, serverExec, "-port", portArg, "-directory", directory, (char *)NULL);
+      fprintf(stderr, "Cannot run %s\n", serverExec);
+      _exit(1);
+   }
+   if (!connectServer(port, pid))
+   {
+      fprintf(stderr, "Cannot connect to server on port %d\n", port);
+      kill(pid, SIGKILL);
+      waitpid(pid, &status, 0);
+      remove(filename);
+      exit(1);
+   }
+
+   // Created sessions have no sensor modes; a loaded one has two.
+   pass = true;
+   fields.put(NUM_SENSORS);
+   fields.put(NUM_RESPONSES);
+   fields.put(NUM_NEEDS);
+   fields.put(4517);
+   pass &= expect(CREATE_FRAME, "a", fields, 0, NULL, "Create a");
+   pass &= expect(CREATE_FRAME, "b", fields, 0, NULL, "Create b");
+   fields.clear();
+   fields.put(sessionFile, strlen(sessionFile));
+   pass &= expect(LOAD_FRAME, "c", fields, 0, NULL, "Load c");
+
+   // Malformed goals are refused; valid ones are added.
+   pass &= goal("a", 0, 5, 0, 1, "Sensor mode 5 without modes");
+   pass &= goal("a", 0, 1, 0, 1, "Sensor mode 1 without modes");
+   pass &= goal("a", 0, -1, 0, 1, "Sensor mode -1");
+   pass &= goal("a", 0, 0, 9, 1, "Response 9");
+   pass &= goal("a", 0, 0, -1, 1, "Response -1");
+   pass &= goal("a", 1, 0, 0, 1, "Need 1");
+   pass &= goal("a", 0, 0, 1, 0, "Valid goal without modes");
+   pass &= goal("a", 0, 0, Mona::NULL_RESPONSE, 0, "Valid null response goal");
+   pass &= goal("c", 0, 2, 0, 1, "Sensor mode 2 with two modes");
+   pass &= goal("c", 0, 5, 0, 1, "Sensor mode 5 with two modes");
+   pass &= goal("c", 0, 1, 0, 0, "Valid goal with modes");
+
+   // Every session goes on cycling.
+   pass &= cycle("a", 20);
+   pass &= cycle("b", 20);
+   pass &= cycle("c", 20);
+
+   // Destroy sessions so that nothing is saved on quitting.
+   fields.clear();
+   pass &= expect(DESTROY_FRAME, "a", fields, 0, NULL, "Destroy a");
+   pass &= expect(DESTROY_FRAME, "b", fields, 0, NULL, "Destroy b");
+   pass &= expect(DESTROY_FRAME, "c", fields, 0, NULL, "Destroy c");
+   close(server);
+   kill(pid, SIGTERM);
+   if ((waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) ||
+       (WEXITSTATUS(status) != 0))
+   {
+      fprintf(stderr, "Server did not exit cleanly\n");
+      pass = false;
+   }
+   remove(filename);
+   if (pass)
+   {
+      printf("Pass\n");
+      exit(0);
+   }
+   else
+   {
+      printf("Fail\n");
+      exit(1);
+   }
+}
@@ -0,0 +1,223 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona threaded cycle test.
+ *
+ * Usage: mona_threadtest
+ *      [-cycles <number of network cycles>]
+ *      [-threads <number of threads>]
+ *
+ * Cycles a serial network in lockstep with copies using threaded drive,
+ * threaded enablement and both, with response overrides and need changes along the way. Responses,
+ * response potentials, needs and network sizes must be identical every
+ * cycle. Exits with status 1 on failure.
+ */
+
+#include "mona.hpp"
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_threadtest\n",
+   (char *)"      [-cycles <number of network cycles>]\n",
+   (char *)"      [-threads <number of threads>]\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+// Network dimensions.
+#define NUM_SENSORS      11
+#define NUM_RESPONSES    6
+#define NUM_NEEDS        2
+#define MEDIATOR_LIMIT   400
+
+// World states.
+#define NUM_STATES       12
+
+// Set sensors for world state.
+void sense(int state, vector<Mona::SENSOR>& sensors)
+{
+   int i;
+
+   for (i = 0; i < 3; i++)
+   {
+      sensors[i] = (Mona::SENSOR)((state >> i) & 1);
+   }
+   for ( ; i < 6; i++)
+   {
+      sensors[i] = (((state + i) % 4) == 0) ? 1.0f : 0.0f;
+   }
+   for ( ; i < NUM_SENSORS; i++)
+   {
+      sensors[i] = (((state * 7 + i) % 5) < 2) ? 1.0f : 0.0f;
+   }
+}
+
+
+// Create network.
+Mona *createNetwork(int driveThreads, int enableThreads)
+{
+   int  i;
+   Mona *mona;
+
+   mona = new Mona();
+   assert(mona != NULL);
+   mona->MAX_MEDIATORS  = MEDIATOR_LIMIT;
+   mona->DRIVE_THREADS  = driveThreads;
+   mona->ENABLE_THREADS = enableThreads;
+   mona->initNet(NUM_SENSORS, NUM_RESPONSES, NUM_NEEDS, 4517);
+   vector<bool> mask(NUM_SENSORS, true);
+   mona->addSensorMode(mask);
+   for (i = 0; i < NUM_SENSORS; i++)
+   {
+      mask[i] = (i < 3);
+   }
+   mona->addSensorMode(mask);
+   for (i = 0; i < NUM_SENSORS; i++)
+   {
+      mask[i] = (i >= 3);
+   }
+   mona->addSensorMode(mask);
+   vector<Mona::SENSOR> goal(NUM_SENSORS);
+   sense(3, goal);
+   mona->addGoal(0, goal, 0, 0.5);
+   sense(7, goal);
+   mona->addGoal(1, goal, 2, 0.5);
+   sense(10, goal);
+   mona->addGoal(1, goal, 1, -0.2);
+   mona->setNeed(0, 1.0);
+   mona->setNeed(1, 1.0);
+   return(mona);
+}
+
+
+// Cycle serial and threaded networks in lockstep.
+bool checkThreads(int driveThreads, int enableThreads, int cycles)
+{
+   int    i, j, state, response;
+   bool   pass;
+   Mona   *serialMona, *threadMona;
+   Random random(4517);
+
+   serialMona = createNetwork(1, 1);
+   threadMona = createNetwork(driveThreads, enableThreads);
+   vector<Mona::SENSOR> sensors(NUM_SENSORS);
+   pass  = true;
+   state = 0;
+   for (i = 0; i < cycles && pass; i++)
+   {
+      // Responses move the world.
+      state = (state + (serialMona->response % 3) +
+               (random.RAND_CHOICE(4) == 0 ? random.RAND_CHOICE(5) : 0)) % NUM_STATES;
+      sense(state, sensors);
+      if ((i % 97) == 0)
+      {
+         serialMona->setNeed(0, 1.0);
+         threadMona->setNeed(0, 1.0);
+      }
+      if ((i % 131) == 0)
+      {
+         serialMona->setNeed(1, 1.0);
+         threadMona->setNeed(1, 1.0);
+      }
+      if ((i % 13) == 5)
+      {
+         response = random.RAND_CHOICE(NUM_RESPONSES);
+         serialMona->overrideResponse(response);
+         threadMona->overrideResponse(response);
+      }
+      if ((threadMona->cycle(sensors) != serialMona->cycle(sensors)) ||
+          (threadMona->mediators.size() != serialMona->mediators.size()) ||
+          (threadMona->receptors.size() != serialMona->receptors.size()))
+      {
+         pass = false;
+      }
+      for (j = 0; j < NUM_RESPONSES; j++)
+      {
+         if (threadMona->responsePotentials[j] != serialMona->responsePotentials[j])
+         {
+            pass = false;
+         }
+      }
+      for (j = 0; j < NUM_NEEDS; j++)
+      {
+         if (threadMona->getNeed(j) != serialMona->getNeed(j))
+         {
+            pass = false;
+         }
+      }
+      if (!pass)
+      {
+         fprintf(stderr, "Drive threads %d, enable threads %d network differs at cycle %d\n",
+                 driveThreads, enableThreads, i);
+      }
+   }
+   if (pass)
+   {
+      printf("Drive threads %d, enable threads %d match serial for %d cycles, %d mediators\n",
+             driveThreads, enableThreads, cycles, (int)serialMona->mediators.size());
+   }
+   delete serialMona;
+   delete threadMona;
+   return(pass);
+}
+
+
+int main(int argc, char *argv[])
+{
+   int  i, cycles, threads;
+   bool pass;
+
+   cycles  = 2000;
+   threads = 4;
+   for (i = 1; i < argc; i++)
+   {
+      if (((strcmp(argv[i], "-cycles") == 0) ||
+           (strcmp(argv[i], "-threads") == 0)) &&
+          (i + 1 < argc) && (atoi(argv[i + 1]) > 0))
+      {
+         if (strcmp(argv[i], "-cycles") == 0)
+         {
+            cycles = atoi(argv[i + 1]);
+         }
+         else
+         {
+            threads = atoi(argv[i + 1]);
+         }
+         i++;
+         continue;
+      }
+      printUsage();
+      exit(1);
+   }
+   pass = true;
+   if (!checkThreads(threads, 1, cycles))
+   {
+      pass = false;
+   }
+   if (!checkThreads(1, threads, cycles))
+   {
+      pass = false;
+   }
+   if (!checkThreads(threads, threads, cycles))
+   {
+      pass = false;
+   }
+   if (pass)
+   {
+      printf("Pass\n");
+      exit(0);
+   }
+   else
+   {
+      printf("Fail\n");
+      exit(1);
+   }
+}
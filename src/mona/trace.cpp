@@ -0,0 +1,251 @@
+// For conditions of distribution and use, see copyright notice in mona.hpp
+
+/*
+ * Mona event trace decoder.
+ *
+ * Usage: mona_trace [-summary] <trace file name>
+ *
+ * Prints the events in a trace dumped with Mona::dumpEventTrace,
+ * oldest first, with times in microseconds from the first event.
+ * The summary instead prints event counts and phase durations.
+ */
+
+#include "mona.hpp"
+
+char *Usage[] =
+{
+   (char *)"Usage: mona_trace\n",
+   (char *)"      [-summary (print event counts and phase durations)]\n",
+   (char *)"      <trace file name>\n",
+   NULL
+};
+
+void printUsage()
+{
+   for (int i = 0; Usage[i] != NULL; i++)
+   {
+      fprintf(stderr, "%s", Usage[i]);
+   }
+}
+
+
+// Event and phase names.
+#define NUM_EVENT_TYPES    7
+const char *EventNames[NUM_EVENT_TYPES] =
+{
+   "phase_begin",
+   "phase_end",
+   "fire",
+   "enable",
+   "create",
+   "delete",
+   "drive"
+};
+
+#define NUM_PHASES    6
+const char *PhaseNames[NUM_PHASES] =
+{
+   "sense",
+   "enable",
+   "learn",
+   "drive",
+   "respond",
+   "commit_learning"
+};
+
+const char *NeuronTypeNames[3] =
+{
+   "receptor",
+   "motor",
+   "mediator"
+};
+
+const char *EventTypeNames[3] =
+{
+   "cause",
+   "response",
+   "effect"
+};
+
+int main(int argc, char *argv[])
+{
+   int                i, n, format;
+   bool               summary;
+   char               *traceFile;
+   unsigned long long dropped, startTime, duration;
+   FILE               *fp;
+
+   vector<EventRing::Event> events;
+   unsigned long long       eventCounts[NUM_EVENT_TYPES];
+   unsigned long long       phaseCounts[NUM_PHASES];
+   unsigned long long       phaseTimes[NUM_PHASES];
+   unsigned long long       phaseMaxTimes[NUM_PHASES];
+   unsigned long long       phaseBegins[NUM_PHASES];
+
+   summary   = false;
+   traceFile = NULL;
+   for (i = 1; i < argc; i++)
+   {
+      if (strcmp(argv[i], "-summary") == 0)
+      {
+         summary = true;
+         continue;
+      }
+      if ((argv[i][0] == '-') || (traceFile != NULL))
+      {
+         printUsage();
+         exit(1);
+      }
+      traceFile = argv[i];
+   }
+   if (traceFile == NULL)
+   {
+      printUsage();
+      exit(1);
+   }
+
+   // Load events.
+   if ((fp = FOPEN_READ(traceFile)) == NULL)
+   {
+      fprintf(stderr, "Cannot open trace file %s\n", traceFile);
+      exit(1);
+   }
+   if ((FREAD_INT(&format, fp) != 1) || (format != Mona::TRACE_FORMAT))
+   {
+      fprintf(stderr, "File format %d is incompatible with expected format %d\n", format, Mona::TRACE_FORMAT);
+      exit(1);
+   }
+   char buf[40];
+   FREAD_STRING(buf, 40, fp);
+   if ((FREAD_INT(&n, fp) != 1) || (n < 0) ||
+       (FREAD_LONG_LONG(&dropped, fp) != 1))
+   {
+      fprintf(stderr, "Invalid trace file %s\n", traceFile);
+      exit(1);
+   }
+   events.resize(n);
+   for (i = 0; i < n; i++)
+   {
+      EventRing::Event& e = events[i];
+      FREAD_LONG_LONG(&e.sequence, fp);
+      FREAD_LONG_LONG(&e.time, fp);
+      FREAD_LONG_LONG(&e.clock, fp);
+      FREAD_LONG_LONG(&e.id, fp);
+      FREAD_DOUBLE(&e.value, fp);
+      FREAD_INT(&e.type, fp);
+      if ((FREAD_INT(&e.arg, fp) != 1) ||
+          (e.type < 0) || (e.type >= NUM_EVENT_TYPES))
+      {
+         fprintf(stderr, "Invalid trace file %s\n", traceFile);
+         exit(1);
+      }
+   }
+   FCLOSE(fp);
+
+   // Print events.
+   if (!summary)
+   {
+      printf("Events: %d (%llu overwritten)\n", n, dropped);
+      startTime = (n > 0) ? events[0].time : 0;
+      for (i = 0; i < n; i++)
+      {
+         EventRing::Event& e = events[i];
+         printf("%llu %.3f clock=%llu %s", e.sequence,
+                (double)(e.time - startTime) / 1000.0, e.clock, EventNames[e.type]);
+         switch (e.type)
+         {
+         case Mona::PHASE_BEGIN_EVENT:
+         case Mona::PHASE_END_EVENT:
+            if ((e.arg >= 0) && (e.arg < NUM_PHASES))
+            {
+               printf(" %s", PhaseNames[e.arg]);
+            }
+            if ((e.type == Mona::PHASE_END_EVENT) && (e.arg == Mona::RESPOND_PHASE))
+            {
+               printf(" response=%d", (int)e.value);
+            }
+            break;
+
+         case Mona::FIRE_EVENT:
+            if ((e.arg >= 0) && (e.arg < 3))
+            {
+               printf(" %s", NeuronTypeNames[e.arg]);
+            }
+            printf(" id=%llu strength=%f", e.id, e.value);
+            break;
+
+         case Mona::ENABLE_EVENT:
+            printf(" mediator=%llu", e.id);
+            if ((e.arg >= 0) && (e.arg < 3))
+            {
+               printf(" %s", EventTypeNames[e.arg]);
+            }
+            printf(" enablement=%f", e.value);
+            break;
+
+         case Mona::MEDIATOR_CREATE_EVENT:
+         case Mona::MEDIATOR_DELETE_EVENT:
+            printf(" mediator=%llu level=%d enablement=%f", e.id, e.arg, e.value);
+            break;
+
+         case Mona::DRIVE_EVENT:
+            printf(" %s=%llu motive=%f", e.arg ? "cause" : "neuron", e.id, e.value);
+            break;
+         }
+         printf("\n");
+      }
+      return(0);
+   }
+
+   // Summarize events and phases.
+   for (i = 0; i < NUM_EVENT_TYPES; i++)
+   {
+      eventCounts[i] = 0;
+   }
+   for (i = 0; i < NUM_PHASES; i++)
+   {
+      phaseCounts[i] = phaseTimes[i] = phaseMaxTimes[i] = 0;
+      phaseBegins[i] = INVALID_TIME;
+   }
+   for (i = 0; i < n; i++)
+   {
+      EventRing::Event& e = events[i];
+      eventCounts[e.type]++;
+      if ((e.arg < 0) || (e.arg >= NUM_PHASES))
+      {
+         continue;
+      }
+      if (e.type == Mona::PHASE_BEGIN_EVENT)
+      {
+         phaseBegins[e.arg] = e.time;
+      }
+      else if ((e.type == Mona::PHASE_END_EVENT) &&
+               (phaseBegins[e.arg] != INVALID_TIME))
+      {
+         duration = e.time - phaseBegins[e.arg];
+         phaseCounts[e.arg]++;
+         phaseTimes[e.arg] += duration;
+         if (duration > phaseMaxTimes[e.arg])
+         {
+            phaseMaxTimes[e.arg] = duration;
+         }
+         phaseBegins[e.arg] = INVALID_TIME;
+      }
+   }
+   printf("Events: %d (%llu overwritten)\n", n, dropped);
+   for (i = 0; i < NUM_EVENT_TYPES; i++)
+   {
+      printf("  %s: %llu\n", EventNames[i], eventCounts[i]);
+   }
+   printf("Phases (microseconds):\n");
+   for (i = 0; i < NUM_PHASES; i++)
+   {
+      if (phaseCounts[i] > 0)
+      {
+         printf("  %s: count=%llu mean=%.3f max=%.3f\n", PhaseNames[i], phaseCounts[i],
+                (double)phaseTimes[i] / (double)phaseCounts[i] / 1000.0,
+                (double)phaseMaxTimes[i] / 1000.0);
+      }
+   }
+   return(0);
+}
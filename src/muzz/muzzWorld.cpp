@@ -43,6 +43,7 @@ char *Usage[] =
    (char *)"      [-numPools <number of pools>]\n",
    (char *)"      [-load <load file name>]\n",
    (char *)"      [-save <save file name>]\n",
+   (char *)"      [-record <recording file prefix> (record muzz brains to <prefix>.<muzz number>)]\n",
    (char *)"      [-randomSeed <random seed>]\n",
    (char *)"      [-objectSeed <object placement seed>]\n",
    (char *)"      [-TmazeTerrain (create T-maze terrain)]\n",
@@ -90,6 +91,7 @@ RANDOM TerrainSeed = INVALID_RANDOM;
 // Files.
 char *SaveFile = NULL;
 char *LoadFile = NULL;
+char *RecordFile = NULL;
 
 // Graphics window dimensions.
 #define WINDOW_WIDTH     850
@@ -373,9 +375,9 @@ void runMuzzes()
          if (ManualResponse != INVALID_RESPONSE)
          {
             // Override muzz with manual response.
-            Muzzes[CurrentMuzz]->brain->responseOverride = ManualResponse;
+            Muzzes[CurrentMuzz]->brain->overrideResponse(ManualResponse);
             runMuzz(CurrentMuzz);
-            Muzzes[CurrentMuzz]->brain->responseOverride = Mona::NULL_RESPONSE;
+            Muzzes[CurrentMuzz]->brain->clearResponseOverride();
 
             // Wait for next manual response.
             ManualResponse = INVALID_RESPONSE;
@@ -446,13 +448,13 @@ void runMuzzes()
          if ((ResponseIdx >= 0) && (ResponseIdx <
                                     (int)ForcedResponseSequence.size()))
          {
-            Muzzes[i]->brain->responseOverride =
-               ForcedResponseSequence[ResponseIdx].response;
+            Muzzes[i]->brain->overrideResponse(
+               ForcedResponseSequence[ResponseIdx].response);
             ResponseIdx++;
          }
          else
          {
-            Muzzes[i]->brain->responseOverride = Mona::NULL_RESPONSE;
+            Muzzes[i]->brain->clearResponseOverride();
          }
       }
 
@@ -518,7 +520,7 @@ void resetMuzzWorld()
 
    for (i = 0; i < NUM_MUZZES; i++)
    {
-      Muzzes[i]->brain->responseOverride = Mona::NULL_RESPONSE;
+      Muzzes[i]->brain->clearResponseOverride();
       Muzzes[i]->reset();
       if (NUM_MUSHROOMS == 0)
       {
@@ -3077,6 +3079,23 @@ void initMuzzWorld()
       fp = NULL;
    }
 
+   // Record muzz brains?
+   if (RecordFile != NULL)
+   {
+      char *recordFile = new char[strlen(RecordFile) + 16];
+      assert(recordFile != NULL);
+      for (i = 0; i < NUM_MUZZES; i++)
+      {
+         sprintf(recordFile, "%s.%d", RecordFile, i);
+         if (!Muzzes[i]->brain->startRecording(recordFile))
+         {
+            fprintf(stderr, "Cannot record to file %s\n", recordFile);
+            exit(1);
+         }
+      }
+      delete [] recordFile;
+   }
+
    if (Graphics)
    {
       // Initialize camera.
@@ -3851,6 +3870,18 @@ int main(int argc, char *argv[])
          continue;
       }
 
+      if (strcmp(argv[i], "-record") == 0)
+      {
+         i++;
+         if (i >= argc)
+         {
+            printUsage();
+            exit(1);
+         }
+         RecordFile = argv[i];
+         continue;
+      }
+
       if (strcmp(argv[i], "-randomSeed") == 0)
       {
          i++;
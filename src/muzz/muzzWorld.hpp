@@ -86,6 +86,7 @@ extern RANDOM TerrainSeed;
 // Files.
 extern char *SaveFile;
 extern char *LoadFile;
+extern char *RecordFile;
 
 // Show graphics.
 extern bool Graphics;